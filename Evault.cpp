@@ -19,15 +19,19 @@ static int _h_fix = 0;
 #include <gdiplus.h>
 #include <iomanip>
 #include <map>
+#include <memory>
 #include <objbase.h>
 #include <objidl.h>
 #include <sstream>
 #include <string>
 #include <vector>
 
-extern "C" {
-#include "sqlite3.h"
-}
+#include "core/AccountDirectory.h"
+#include "core/Indicators.h"
+#include "core/Market.h"
+#include "core/MarketSim.h"
+#include "core/Portfolio.h"
+#include "core/VaultDB.h"
 
 #pragma comment(lib, "gdiplus.lib")
 #pragma comment(lib, "comctl32.lib")
@@ -59,6 +63,14 @@ inline wstring FromUTF8(const string &str) {
   return wstr;
 }
 
+// Amount typed into an edit box; anything unparsable reads as zero.
+inline Core::Money ParseAmount(const WCHAR *text) {
+  Core::Money m;
+  if (!Core::Money::Parse(ToUTF8(text), &m))
+    return Core::Money();
+  return m;
+}
+
 // ==========================================
 // PREMIUM DESIGN SYSTEM
 // ==========================================
@@ -73,282 +85,6 @@ const Color TextDim(255, 150, 150, 160);
 const Color GridLines(40, 255, 255, 255);
 } // namespace Theme
 
-// ==========================================
-// CORE DATA
-// ==========================================
-namespace Core {
-struct Account {
-  wstring accNum, name, pin;
-  double balance;
-};
-struct Stock {
-  wstring symbol, name;
-  double price;
-  vector<float> history;
-};
-
-class VaultDB {
-private:
-  sqlite3 *db;
-  bool useNewSchema = true;
-
-public:
-  VaultDB() : db(nullptr) {}
-  ~VaultDB() {
-    if (db)
-      sqlite3_close(db);
-  }
-
-  bool Init() {
-    if (sqlite3_open("evault.db", &db) != SQLITE_OK)
-      return false;
-
-    // Check which schema we are using
-    sqlite3_stmt *stmt;
-    if (sqlite3_prepare_v2(db, "SELECT account_number FROM accounts LIMIT 1;",
-                           -1, &stmt, 0) != SQLITE_OK) {
-      useNewSchema = false;
-    } else {
-      sqlite3_finalize(stmt);
-      useNewSchema = true;
-    }
-
-    if (useNewSchema) {
-      sqlite3_exec(db,
-                   "CREATE TABLE IF NOT EXISTS accounts (account_number TEXT "
-                   "PRIMARY KEY, holder_name TEXT, pin TEXT, balance REAL, "
-                   "created_at DATETIME DEFAULT CURRENT_TIMESTAMP);",
-                   0, 0, 0);
-      sqlite3_exec(db,
-                   "CREATE TABLE IF NOT EXISTS portfolio (account_number TEXT, "
-                   "symbol TEXT, quantity INTEGER, avg_price REAL, PRIMARY "
-                   "KEY(account_number, symbol));",
-                   0, 0, 0);
-    } else {
-      sqlite3_exec(db,
-                   "CREATE TABLE IF NOT EXISTS accounts (acc_num TEXT PRIMARY "
-                   "KEY, name TEXT, pin TEXT, balance REAL);",
-                   0, 0, 0);
-      sqlite3_exec(
-          db,
-          "CREATE TABLE IF NOT EXISTS portfolio (acc_num TEXT, symbol TEXT, "
-          "quantity INTEGER, avg_price REAL, PRIMARY KEY(acc_num, symbol));",
-          0, 0, 0);
-    }
-
-    sqlite3_stmt *check;
-    if (sqlite3_prepare_v2(db, "SELECT COUNT(*) FROM accounts;", -1, &check,
-                           0) == SQLITE_OK) {
-      if (sqlite3_step(check) == SQLITE_ROW &&
-          sqlite3_column_int(check, 0) == 0) {
-        sqlite3_finalize(check);
-        CreateAccount(L"77367438", L"jashwanth oggu", L"1985", 100000);
-        CreateAccount(L"48528372", L"chinni jaswanth", L"4066", 75000);
-        CreateAccount(L"57422441", L"muni charan teja", L"1028", 50000);
-      } else
-        sqlite3_finalize(check);
-    }
-    return true;
-  }
-
-  bool CreateAccount(wstring num, wstring name, wstring pin, double bal) {
-    sqlite3_stmt *s;
-    string sql = useNewSchema ? "INSERT INTO accounts (account_number, "
-                                "holder_name, pin, balance) VALUES(?,?,?,?);"
-                              : "INSERT INTO accounts (acc_num, name, pin, "
-                                "balance) VALUES(?,?,?,?);";
-
-    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &s, 0) != SQLITE_OK)
-      return false;
-    string sNum = ToUTF8(num), sName = ToUTF8(name), sPin = ToUTF8(pin);
-    sqlite3_bind_text(s, 1, sNum.c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(s, 2, sName.c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(s, 3, sPin.c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_double(s, 4, bal);
-    bool ok = (sqlite3_step(s) == SQLITE_DONE);
-    sqlite3_finalize(s);
-    return ok;
-  }
-
-  vector<Account> LoadAccounts() {
-    vector<Account> list;
-    sqlite3_stmt *s = nullptr;
-    string sql =
-        useNewSchema
-            ? "SELECT account_number, holder_name, pin, balance FROM accounts;"
-            : "SELECT acc_num, name, pin, balance FROM accounts;";
-
-    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &s, 0) == SQLITE_OK) {
-      while (sqlite3_step(s) == SQLITE_ROW) {
-        const char *n = (const char *)sqlite3_column_text(s, 0);
-        const char *m = (const char *)sqlite3_column_text(s, 1);
-        const char *p = (const char *)sqlite3_column_text(s, 2);
-        list.push_back({FromUTF8(n ? n : ""), FromUTF8(m ? m : ""),
-                        FromUTF8(p ? p : ""), sqlite3_column_double(s, 3)});
-      }
-      sqlite3_finalize(s);
-    }
-    return list;
-  }
-
-  bool UpdateBalance(wstring num, double newBal) {
-    sqlite3_stmt *s;
-    string sql = useNewSchema
-                     ? "UPDATE accounts SET balance=? WHERE account_number=?;"
-                     : "UPDATE accounts SET balance=? WHERE acc_num=?;";
-
-    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &s, 0) != SQLITE_OK)
-      return false;
-    string sNum = ToUTF8(num);
-    sqlite3_bind_double(s, 1, newBal);
-    sqlite3_bind_text(s, 2, sNum.c_str(), -1, SQLITE_TRANSIENT);
-    bool ok = (sqlite3_step(s) == SQLITE_DONE);
-    sqlite3_finalize(s);
-    return ok;
-  }
-
-  int Transfer(wstring from, wstring toName, double amount) {
-    if (amount <= 0)
-      return 5;
-    string sFrom = ToUTF8(from), sToName = ToUTF8(toName);
-    sqlite3_stmt *find;
-    string targetID;
-
-    string findSql =
-        useNewSchema
-            ? "SELECT account_number FROM accounts WHERE holder_name = ? "
-              "COLLATE NOCASE;"
-            : "SELECT acc_num FROM accounts WHERE name = ? COLLATE NOCASE;";
-
-    if (sqlite3_prepare_v2(db, findSql.c_str(), -1, &find, 0) != SQLITE_OK)
-      return 6;
-    sqlite3_bind_text(find, 1, sToName.c_str(), -1, SQLITE_TRANSIENT);
-    if (sqlite3_step(find) == SQLITE_ROW) {
-      const char *tid = (const char *)sqlite3_column_text(find, 0);
-      if (tid)
-        targetID = tid;
-    }
-    sqlite3_finalize(find);
-    if (targetID.empty())
-      return 4;
-    if (targetID == sFrom)
-      return 2;
-
-    sqlite3_exec(db, "BEGIN TRANSACTION;", 0, 0, 0);
-    sqlite3_stmt *s1, *s2;
-
-    // Debiting sender
-    string updateSender = useNewSchema
-                              ? "UPDATE accounts SET balance = balance - ? "
-                                "WHERE account_number = ? AND balance >= ?;"
-                              : "UPDATE accounts SET balance = balance - ? "
-                                "WHERE acc_num = ? AND balance >= ?;";
-
-    if (sqlite3_prepare_v2(db, updateSender.c_str(), -1, &s1, 0) != SQLITE_OK) {
-      sqlite3_exec(db, "ROLLBACK;", 0, 0, 0);
-      return 6;
-    }
-    sqlite3_bind_double(s1, 1, amount);
-    sqlite3_bind_text(s1, 2, sFrom.c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_double(s1, 3, amount);
-    bool dOk = (sqlite3_step(s1) == SQLITE_DONE && sqlite3_changes(db) > 0);
-    sqlite3_finalize(s1);
-    if (!dOk) {
-      sqlite3_exec(db, "ROLLBACK;", 0, 0, 0);
-      return 3;
-    }
-
-    // Crediting receiver
-    string updateReceiver =
-        useNewSchema
-            ? "UPDATE accounts SET balance = balance + ? WHERE account_number "
-              "= ?;"
-            : "UPDATE accounts SET balance = balance + ? WHERE acc_num = ?;";
-
-    if (sqlite3_prepare_v2(db, updateReceiver.c_str(), -1, &s2, 0) !=
-        SQLITE_OK) {
-      sqlite3_exec(db, "ROLLBACK;", 0, 0, 0);
-      return 6;
-    }
-    sqlite3_bind_double(s2, 1, amount);
-    sqlite3_bind_text(s2, 2, targetID.c_str(), -1, SQLITE_TRANSIENT);
-    bool cOk = (sqlite3_step(s2) == SQLITE_DONE && sqlite3_changes(db) > 0);
-    sqlite3_finalize(s2);
-    if (!cOk) {
-      sqlite3_exec(db, "ROLLBACK;", 0, 0, 0);
-      return 4;
-    }
-
-    sqlite3_exec(db, "COMMIT;", 0, 0, 0);
-    return 0;
-  }
-
-  int GetOwnedStocks(wstring accNum, wstring symbol,
-                     double *avgPrice = nullptr) {
-    sqlite3_stmt *s;
-    string sNum = ToUTF8(accNum), sSym = ToUTF8(symbol);
-    string sql = useNewSchema ? "SELECT quantity, avg_price FROM portfolio "
-                                "WHERE account_number=? AND symbol=?;"
-                              : "SELECT quantity, avg_price FROM portfolio "
-                                "WHERE acc_num=? AND symbol=?;";
-
-    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &s, 0) != SQLITE_OK)
-      return 0;
-    sqlite3_bind_text(s, 1, sNum.c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(s, 2, sSym.c_str(), -1, SQLITE_TRANSIENT);
-    int qty = 0;
-    if (sqlite3_step(s) == SQLITE_ROW) {
-      qty = sqlite3_column_int(s, 0);
-      if (avgPrice)
-        *avgPrice = sqlite3_column_double(s, 1);
-    }
-    sqlite3_finalize(s);
-    return qty;
-  }
-
-  bool UpdateStocks(wstring accNum, wstring symbol, int delta, double price) {
-    double currentAvg = 0;
-    int currentQty = GetOwnedStocks(accNum, symbol, &currentAvg);
-    int nextQty = currentQty + delta;
-    if (nextQty < 0)
-      return false;
-    double nextAvg = currentAvg;
-    if (delta > 0 && nextQty > 0)
-      nextAvg = ((currentAvg * currentQty) + (price * delta)) / nextQty;
-    sqlite3_stmt *s;
-    string sNum = ToUTF8(accNum), sSym = ToUTF8(symbol);
-    if (currentQty == 0 && delta > 0) {
-      string sql = useNewSchema
-                       ? "INSERT INTO portfolio (account_number, symbol, "
-                         "quantity, avg_price) VALUES(?,?,?,?);"
-                       : "INSERT INTO portfolio (acc_num, symbol, quantity, "
-                         "avg_price) VALUES(?,?,?,?);";
-      if (sqlite3_prepare_v2(db, sql.c_str(), -1, &s, 0) != SQLITE_OK)
-        return false;
-      sqlite3_bind_text(s, 1, sNum.c_str(), -1, SQLITE_TRANSIENT);
-      sqlite3_bind_text(s, 2, sSym.c_str(), -1, SQLITE_TRANSIENT);
-      sqlite3_bind_int(s, 3, nextQty);
-      sqlite3_bind_double(s, 4, nextAvg);
-    } else {
-      string sql = useNewSchema
-                       ? "UPDATE portfolio SET quantity=?, avg_price=? WHERE "
-                         "account_number=? AND symbol=?;"
-                       : "UPDATE portfolio SET quantity=?, avg_price=? WHERE "
-                         "acc_num=? AND symbol=?;";
-      if (sqlite3_prepare_v2(db, sql.c_str(), -1, &s, 0) != SQLITE_OK)
-        return false;
-      sqlite3_bind_int(s, 1, nextQty);
-      sqlite3_bind_double(s, 2, nextAvg);
-      sqlite3_bind_text(s, 3, sNum.c_str(), -1, SQLITE_TRANSIENT);
-      sqlite3_bind_text(s, 4, sSym.c_str(), -1, SQLITE_TRANSIENT);
-    }
-    bool ok = (sqlite3_step(s) == SQLITE_DONE);
-    sqlite3_finalize(s);
-    return ok;
-  }
-};
-} // namespace Core
-
 // ==========================================
 // STATE
 // ==========================================
@@ -367,20 +103,18 @@ HWND hMain, hSide, hCont;
 ULONG_PTR gdiplusToken;
 vector<HWND> controls;
 wstring uName, uID, uPIN;
-double uBal = 0, pendingAmt = 0;
-wstring pendingTarget;
+Core::Money uBal, pendingAmt;
+wstring pendingTarget; // recipient account number
+wstring peerID, peerName; // last peer clicked in the banking list
 int preloadPct = 0, stockSelIdx = 0, pendingAction = 0;
 Core::VaultDB dbInstance;
+Core::AccountDirectory accountDirectory(dbInstance);
 
-vector<Core::Stock> marketStocks = {
-    {L"NVDA", L"NVIDIA Corp", 880.50, {850, 860, 875, 870, 890, 885, 880}},
-    {L"AAPL", L"Apple Inc", 172.10, {170, 171, 175, 173, 174, 172, 172}},
-    {L"TSLA", L"Tesla Inc", 165.40, {180, 175, 170, 168, 160, 162, 165}},
-    {L"BTC",
-     L"Bitcoin",
-     65400.0,
-     {62000, 63000, 66000, 64000, 68000, 67000, 65400}},
-    {L"ETH", L"Ethereum", 3500.2, {3200, 3300, 3600, 3400, 3700, 3600, 3500}}};
+vector<Core::Stock> marketStocks = Core::DefaultMarket();
+Core::MarketSim marketSim;
+uint64_t marketTick = 0; // last tick copied into marketStocks
+Core::IndicatorUniverse marketIndicators(marketStocks.size());
+Core::PortfolioSnapshot portfolio; // the signed-in account's, for drawing
 
 // ==========================================
 // UI HELPERS
@@ -409,6 +143,42 @@ void DrawGlass(Graphics &g, RectF r) {
   g.FillRectangle(&shine, r);
 }
 
+// Quantity typed next to stock row i; 0 if empty or out of range.
+int OrderQuantity(int i) {
+  WCHAR q[16];
+  GetWindowTextW(GetDlgItem(hCont, 8100 + i), q, 16);
+  long n = wcstol(q, nullptr, 10);
+  return n > 0 && n <= 1000000 ? (int)n : 0;
+}
+
+// Brings the stock portal's holdings up to date: a query only after a trade
+// or a change of account, then P&L at current prices. Painting only reads
+// the snapshot.
+void RefreshPortfolio() {
+  portfolio.Refresh(dbInstance, ToUTF8(uID));
+  portfolio.Mark(marketStocks);
+}
+
+// The account directory as the UI draws it: the shared snapshot plus every
+// holder's name already widened, both replaced only when the directory
+// reloads.
+struct AccountView {
+  shared_ptr<const Core::AccountList> list;
+  vector<wstring> names; // parallel to list->accounts
+};
+AccountView accountView;
+
+const AccountView &Accounts() {
+  shared_ptr<const Core::AccountList> snap = accountDirectory.Snapshot();
+  if (snap != accountView.list) {
+    accountView.names.clear();
+    for (auto &a : snap->accounts)
+      accountView.names.push_back(FromUTF8(a.name));
+    accountView.list = snap;
+  }
+  return accountView;
+}
+
 void RepositionControls() {
   RECT rc;
   GetClientRect(hCont, &rc);
@@ -439,6 +209,7 @@ void RepositionControls() {
     for (int i = 0; i < 5; i++) {
       MoveWindow(GetDlgItem(hCont, 8000 + i), 520, 200 + i * 85, 80, 35, TRUE);
       MoveWindow(GetDlgItem(hCont, 9000 + i), 610, 200 + i * 85, 80, 35, TRUE);
+      MoveWindow(GetDlgItem(hCont, 8100 + i), 700, 200 + i * 85, 50, 35, TRUE);
     }
     MoveWindow(GetDlgItem(hCont, 4000), w - 180, 30, 150, 40, TRUE);
   } else if (activeView == PIN_CONFIRM) {
@@ -450,6 +221,8 @@ void RepositionControls() {
 
 void RequestView(ViewID vid) {
   activeView = vid;
+  if (vid == STOCKS)
+    RefreshPortfolio();
   for (auto c : controls) {
     ShowWindow(c, SW_HIDE);
     DestroyWindow(c);
@@ -533,6 +306,10 @@ void RequestView(ViewID vid) {
       controls.push_back(CreateWindowW(
           L"BUTTON", L"SELL", WS_VISIBLE | WS_CHILD, 610, 200 + i * 85, 80, 35,
           hCont, (HMENU)(9000 + i), hInst, NULL));
+      // Shares per BUY/SELL click.
+      controls.push_back(CreateWindowExW(
+          0, L"EDIT", L"1", WS_VISIBLE | WS_CHILD | WS_BORDER | ES_NUMBER,
+          700, 200 + i * 85, 50, 35, hCont, (HMENU)(8100 + i), hInst, NULL));
     }
     controls.push_back(CreateWindowW(L"BUTTON", L"SWITCH PORTAL",
                                      WS_VISIBLE | WS_CHILD, cw - 180, 30, 150,
@@ -591,22 +368,23 @@ LRESULT CALLBACK ContentProc(HWND hwnd, UINT msg, WPARAM wp, LPARAM lp) {
     } else if (activeView == ACCOUNTS) {
       g.DrawString(L"Select Secure Profile", -1, &fT,
                    PointF(rc.right / 2.0f - 140, 60), &w);
-      auto accs = dbInstance.LoadAccounts();
-      if (accs.empty()) {
+      const AccountView &accs = Accounts();
+      if (accs.names.empty()) {
         g.DrawString(L"NO PROFILES DETECTED. CREATE ONE BELOW.", -1, &fS,
                      PointF(rc.right / 2.0f - 150, rc.bottom / 2.0f), &d);
       }
-      for (int i = 0; i < (int)accs.size(); i++) {
+      for (int i = 0; i < (int)accs.names.size(); i++) {
         int col = i % 3, row = i / 3;
         RectF card(rc.right / 2.0f - 400 + col * 280, 140 + row * 240, 240,
                    180);
         DrawGlass(g, card);
-        g.DrawString(accs[i].name.substr(0, 1).c_str(), 1, &fT,
+        const wstring &name = accs.names[i];
+        g.DrawString(name.substr(0, 1).c_str(), 1, &fT,
                      PointF(card.X + 100, card.Y + 40), &a);
         RectF nr(card.X, card.Y + 110, 240, 30);
         StringFormat sf;
         sf.SetAlignment(StringAlignmentCenter);
-        g.DrawString(accs[i].name.c_str(), -1, &fS, nr, &sf, &w);
+        g.DrawString(name.c_str(), -1, &fS, nr, &sf, &w);
       }
     } else if (activeView == PORTALS) {
       // Advanced Premium Dashboard Header
@@ -644,7 +422,7 @@ LRESULT CALLBACK ContentProc(HWND hwnd, UINT msg, WPARAM wp, LPARAM lp) {
       DrawGlass(g, balRect);
       g.DrawString(L"TOTAL LIQUIDITY", -1, &fS, PointF(70, 130), &d);
       wstringstream ss;
-      ss << L"Rs. " << fixed << setprecision(2) << uBal;
+      ss << L"Rs. " << FromUTF8(uBal.ToString());
       g.DrawString(ss.str().c_str(), -1, &fT, PointF(70, 165), &a);
 
       // Peer List Section
@@ -653,13 +431,14 @@ LRESULT CALLBACK ContentProc(HWND hwnd, UINT msg, WPARAM wp, LPARAM lp) {
       g.DrawString(L"REGISTERED NETWORK PEERS", -1, &fS,
                    PointF(peerRect.X + 30, peerRect.Y + 25), &d);
 
-      auto list = dbInstance.LoadAccounts();
+      const AccountView &peers = Accounts();
+      string sID = ToUTF8(uID);
       int k = 0;
-      for (auto &ac : list) {
-        if (ac.accNum != uID) {
+      for (size_t i = 0; i < peers.names.size(); i++) {
+        if (peers.list->accounts[i].accNum != sID) {
           RectF itemR(peerRect.X + 20, peerRect.Y + 70 + k * 45, 340, 40);
           DrawPremiumRect(g, itemR, 8, Color(20, 255, 255, 255), false);
-          g.DrawString(ac.name.c_str(), -1, &fS,
+          g.DrawString(peers.names[i].c_str(), -1, &fS,
                        PointF(itemR.X + 15, itemR.Y + 12), &w);
           k++;
         }
@@ -667,7 +446,8 @@ LRESULT CALLBACK ContentProc(HWND hwnd, UINT msg, WPARAM wp, LPARAM lp) {
 
       // Input Field Labels
       g.DrawString(L"TRANSACTION AMOUNT", -1, &fS, PointF(70, 455), &d);
-      g.DrawString(L"TARGET RECIPIENT NAME", -1, &fS, PointF(350, 455), &d);
+      g.DrawString(L"RECIPIENT NAME OR ACCOUNT NO.", -1, &fS,
+                   PointF(350, 455), &d);
     } else if (activeView == PIN_CONFIRM) {
       g.DrawString(L"VERIFY IDENTITY", -1, &fT,
                    PointF(rc.right / 2.0f - 100, rc.bottom / 2.0f - 120), &w);
@@ -679,7 +459,7 @@ LRESULT CALLBACK ContentProc(HWND hwnd, UINT msg, WPARAM wp, LPARAM lp) {
       RectF balBox(40, 90, 320, 70);
       DrawGlass(g, balBox);
       wstringstream bss;
-      bss << L"LIQUID: Rs. " << fixed << setprecision(2) << uBal;
+      bss << L"LIQUID: Rs. " << FromUTF8(uBal.ToString());
       g.DrawString(bss.str().c_str(), -1, &fP,
                    PointF(balBox.X + 20, balBox.Y + 22), &a);
       for (int i = 0; i < 5; i++) {
@@ -689,12 +469,12 @@ LRESULT CALLBACK ContentProc(HWND hwnd, UINT msg, WPARAM wp, LPARAM lp) {
           Pen sp(Theme::Accent, 1.5f);
           g.DrawRectangle(&sp, row);
         }
-        g.DrawString(marketStocks[i].symbol.c_str(), -1, &fP,
+        g.DrawString(FromUTF8(marketStocks[i].symbol).c_str(), -1, &fP,
                      PointF(row.X + 30, row.Y + 25), &w);
 
-        double avg = 0;
-        int qty = dbInstance.GetOwnedStocks(uID, marketStocks[i].symbol, &avg);
-        float pnl = (float)((marketStocks[i].price - avg) * qty);
+        Core::PortfolioRow held = portfolio.Row(i);
+        int qty = held.quantity;
+        float pnl = (float)held.pnl;
 
         wstringstream ps;
         ps << L"Rs." << fixed << setprecision(2) << marketStocks[i].price
@@ -720,6 +500,15 @@ LRESULT CALLBACK ContentProc(HWND hwnd, UINT msg, WPARAM wp, LPARAM lp) {
       DrawGlass(g, gBox);
       g.DrawString(L"REAL-TIME TELEMETRY", -1, &fS,
                    PointF(gBox.X + 25, gBox.Y + 20), &d);
+      if (marketIndicators.Ticks()) {
+        Core::IndicatorValues iv = marketIndicators.Values(stockSelIdx);
+        wstringstream is;
+        is << fixed << setprecision(2) << L"SMA " << iv.sma << L" | EMA "
+           << iv.ema << L" | BB " << iv.lower << L"-" << iv.upper
+           << setprecision(1) << L" | RSI " << iv.rsi;
+        g.DrawString(is.str().c_str(), -1, &fS,
+                     PointF(gBox.X + 220, gBox.Y + 20), &d);
+      }
       Pen gridP(Theme::GridLines, 1);
       for (int i = 0; i < 5; i++) {
         float gy = gBox.Y + 40 + i * (gBox.Height - 80) / 4;
@@ -730,24 +519,23 @@ LRESULT CALLBACK ContentProc(HWND hwnd, UINT msg, WPARAM wp, LPARAM lp) {
         g.DrawLine(&gridP, gx, gBox.Y + 40, gx, gBox.Y + gBox.Height - 40);
       }
       auto &h = marketStocks[stockSelIdx].history;
-      if (h.size() > 1) {
-        float minP = h[0], maxP = h[0];
-        for (float v : h) {
-          minP = min(minP, v);
-          maxP = max(maxP, v);
-        }
-        float r = max(maxP - minP, 1.0f);
+      if (h.Size() > 1) {
+        // The buffer keeps its own min/max, and its two runs are read in
+        // place; the whole line is one DrawLines call.
+        float minP = h.Min(), r = max(h.Max() - minP, 1.0f);
+        float dx = (gBox.Width - 80) / (h.Size() - 1);
+        Core::RingBuffer<float>::Span runs[2];
+        h.Spans(&runs[0], &runs[1]);
+        vector<PointF> pts;
+        pts.reserve(h.Size());
+        for (auto &run : runs)
+          for (size_t i = 0; i < run.size; i++)
+            pts.push_back(PointF(gBox.X + 40 + pts.size() * dx,
+                                 gBox.Y + gBox.Height - 40 -
+                                     (run.data[i] - minP) *
+                                         (gBox.Height - 80) / r));
         Pen p(Theme::Accent, 2.5f);
-        for (size_t i = 0; i < h.size() - 1; i++) {
-          float x1 = gBox.X + 40 + (i * (gBox.Width - 80) / (h.size() - 1)),
-                y1 = gBox.Y + gBox.Height - 40 -
-                     ((h[i] - minP) * (gBox.Height - 80) / r);
-          float x2 = gBox.X + 40 +
-                     ((i + 1) * (gBox.Width - 80) / (h.size() - 1)),
-                y2 = gBox.Y + gBox.Height - 40 -
-                     ((h[i + 1] - minP) * (gBox.Height - 80) / r);
-          g.DrawLine(&p, x1, y1, x2, y2);
-        }
+        g.DrawLines(&p, pts.data(), (INT)pts.size());
       }
     }
     BitBlt(hdc, 0, 0, rc.right, rc.bottom, mdc, 0, 0, SRCCOPY);
@@ -761,15 +549,17 @@ LRESULT CALLBACK ContentProc(HWND hwnd, UINT msg, WPARAM wp, LPARAM lp) {
     RECT rc;
     GetClientRect(hwnd, &rc);
     if (activeView == ACCOUNTS) {
-      auto accs = dbInstance.LoadAccounts();
+      // Held until the handler returns, whatever the views do meanwhile.
+      shared_ptr<const Core::AccountList> snap = accountDirectory.Snapshot();
+      const vector<Core::Account> &accs = snap->accounts;
       for (int i = 0; i < (int)accs.size(); i++) {
         int col = i % 3, row = i / 3;
         if (x > rc.right / 2 - 400 + col * 280 &&
             x < rc.right / 2 - 400 + col * 280 + 240 && y > 140 + row * 240 &&
             y < 140 + row * 240 + 180) {
-          uName = accs[i].name;
-          uID = accs[i].accNum;
-          uPIN = accs[i].pin;
+          uName = FromUTF8(accs[i].name);
+          uID = FromUTF8(accs[i].accNum);
+          uPIN = FromUTF8(accs[i].pin);
           uBal = accs[i].balance;
           RequestView(LOGIN);
           break;
@@ -783,13 +573,17 @@ LRESULT CALLBACK ContentProc(HWND hwnd, UINT msg, WPARAM wp, LPARAM lp) {
           break;
         }
     } else if (activeView == BANKING && x > rc.right - 420.0f) {
-      auto list = dbInstance.LoadAccounts();
+      shared_ptr<const Core::AccountList> snap = accountDirectory.Snapshot();
+      const vector<Core::Account> &list = snap->accounts;
+      string sID = ToUTF8(uID);
       int k = 0;
       float startY = 170.0f; // Adjusted for Peer List card
       for (auto &ac : list) {
-        if (ac.accNum != uID) {
+        if (ac.accNum != sID) {
           if (y > startY + k * 45 && y < startY + k * 45 + 40) {
-            SetWindowTextW(GetDlgItem(hCont, 3002), ac.name.c_str());
+            peerID = FromUTF8(ac.accNum);
+            peerName = FromUTF8(ac.name);
+            SetWindowTextW(GetDlgItem(hCont, 3002), peerName.c_str());
             break;
           }
           k++;
@@ -836,8 +630,12 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wp, LPARAM lp) {
     CreateWindowW(L"BUTTON", L"STOCKS", WS_VISIBLE | WS_CHILD | BS_OWNERDRAW,
                   10, 180, 220, 50, hSide, (HMENU)102, NULL, NULL);
     dbInstance.Init();
+    // Prices move on the simulator's own thread, a trading day per tick;
+    // timer 2 only picks up what it has published.
+    marketSim.AddMarket(marketStocks, 0.08, 0.45);
+    marketSim.Start(2000);
     SetTimer(hwnd, 1, 50, NULL);
-    SetTimer(hwnd, 2, 2000, NULL);
+    SetTimer(hwnd, 2, 250, NULL);
     break;
   case WM_TIMER:
     if (wp == 1) {
@@ -848,15 +646,20 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wp, LPARAM lp) {
       }
       InvalidateRect(hCont, NULL, TRUE);
     }
-    if (wp == 2 && activeView == STOCKS) {
-      for (auto &s : marketStocks) {
-        float dev = ((rand() % 20) - 10) / 100.0f;
-        s.price *= (1.0f + dev);
-        s.history.push_back(s.price);
-        if (s.history.size() > 15)
-          s.history.erase(s.history.begin());
+    if (wp == 2 && marketSim.Ticks() != marketTick) {
+      vector<double> prices;
+      marketTick = marketSim.Snapshot(&prices);
+      for (size_t i = 0; i < marketStocks.size() && i < prices.size(); i++) {
+        Core::Stock &st = marketStocks[i];
+        st.price = prices[i];
+        st.history.Push((float)prices[i]);
+      }
+      if (prices.size() == marketIndicators.Symbols())
+        marketIndicators.Tick(prices.data());
+      if (activeView == STOCKS) {
+        RefreshPortfolio();
+        InvalidateRect(hCont, NULL, TRUE);
       }
-      InvalidateRect(hCont, NULL, TRUE);
     }
     break;
   case WM_DRAWITEM: {
@@ -907,10 +710,9 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wp, LPARAM lp) {
     } else if (id == 3003) {
       WCHAR a[32];
       GetWindowTextW(GetDlgItem(hCont, 3001), a, 32);
-      double amt = wcstod(a, NULL);
-      if (amt > 0) {
-        uBal += amt;
-        dbInstance.UpdateBalance(uID, uBal);
+      Core::Money amt = ParseAmount(a);
+      if (amt.IsPositive() && dbInstance.Deposit(ToUTF8(uID), amt)) {
+        dbInstance.GetBalance(ToUTF8(uID), &uBal);
         SetWindowTextW(GetDlgItem(hCont, 3001), L"0");
         InvalidateRect(hCont, NULL, TRUE);
         MessageBoxW(hwnd, L"DEPOSIT SUCCESSFUL", L"SEC", MB_OK);
@@ -918,8 +720,8 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wp, LPARAM lp) {
     } else if (id == 3004) {
       WCHAR a[32];
       GetWindowTextW(GetDlgItem(hCont, 3001), a, 32);
-      double amt = wcstod(a, NULL);
-      if (amt > 0 && amt <= uBal) {
+      Core::Money amt = ParseAmount(a);
+      if (amt.IsPositive() && amt <= uBal) {
         pendingAmt = amt;
         pendingAction = 1;
         RequestView(PIN_CONFIRM);
@@ -929,14 +731,34 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wp, LPARAM lp) {
       WCHAR a[32], t[32];
       GetWindowTextW(GetDlgItem(hCont, 3001), a, 32);
       GetWindowTextW(GetDlgItem(hCont, 3002), t, 32);
-      double amt = wcstod(a, NULL);
-      if (amt > 0 && amt <= uBal) {
+      Core::Money amt = ParseAmount(a);
+      if (amt.IsPositive() && amt <= uBal) {
         if (wcslen(t) < 1) {
           MessageBoxW(hwnd, L"SELECT A RECIPIENT", L"SEC", MB_ICONERROR);
           return 0;
         }
+        // A clicked peer or a typed account number is used as is; a typed
+        // name must match exactly one account.
+        wstring target = t;
+        if (!peerID.empty() && target == peerName)
+          pendingTarget = peerID;
+        else if (target.size() == 8 &&
+                 target.find_first_not_of(L"0123456789") == wstring::npos)
+          pendingTarget = target;
+        else {
+          auto matches = dbInstance.FindAccountsByName(ToUTF8(target));
+          if (matches.size() != 1) {
+            MessageBoxW(hwnd,
+                        matches.empty()
+                            ? L"RECIPIENT NOT FOUND"
+                            : L"NAME MATCHES SEVERAL ACCOUNTS: PICK A PEER "
+                              L"OR ENTER THE ACCOUNT NUMBER",
+                        L"SEC", MB_ICONERROR);
+            return 0;
+          }
+          pendingTarget = FromUTF8(matches[0].accNum);
+        }
         pendingAmt = amt;
-        pendingTarget = t;
         pendingAction = 2;
         RequestView(PIN_CONFIRM);
       } else
@@ -946,12 +768,18 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wp, LPARAM lp) {
       GetWindowTextW(GetDlgItem(hCont, 5005), p, 16);
       if (wstring(p) == uPIN) {
         if (pendingAction == 1) {
-          uBal -= pendingAmt;
-          dbInstance.UpdateBalance(uID, uBal);
+          if (!dbInstance.Withdraw(ToUTF8(uID), pendingAmt)) {
+            MessageBoxW(hwnd, L"WITHDRAWAL FAILED: INSUFFICIENT BALANCE",
+                        L"SEC", MB_ICONERROR);
+            RequestView(BANKING);
+            return 0;
+          }
+          dbInstance.GetBalance(ToUTF8(uID), &uBal);
         } else if (pendingAction == 2) {
-          int res = dbInstance.Transfer(uID, pendingTarget, pendingAmt);
+          int res = dbInstance.Transfer(ToUTF8(uID), ToUTF8(pendingTarget),
+                                        pendingAmt);
           if (res == 0)
-            uBal -= pendingAmt;
+            dbInstance.GetBalance(ToUTF8(uID), &uBal);
           else {
             wstringstream ws;
             ws << L"TRANSFER FAILED: ";
@@ -970,18 +798,24 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wp, LPARAM lp) {
         }
         SetWindowTextW(GetDlgItem(hCont, 3001), L"0");
         SetWindowTextW(GetDlgItem(hCont, 3002), L"");
+        peerID.clear();
+        peerName.clear();
         InvalidateRect(hCont, NULL, TRUE);
         MessageBoxW(hwnd, L"AUTHORIZATION GRANTED", L"SEC", MB_OK);
         RequestView(BANKING);
       } else
         MessageBoxW(hwnd, L"INVALID PIN", L"SEC", MB_ICONERROR);
     } else if (id >= 8000 && id < 8005) {
-      int i = id - 8000;
-      if (uBal >= marketStocks[i].price) {
-        if (dbInstance.UpdateStocks(uID, marketStocks[i].symbol, 1,
-                                    marketStocks[i].price)) {
-          uBal -= marketStocks[i].price;
-          dbInstance.UpdateBalance(uID, uBal);
+      int i = id - 8000, qty = OrderQuantity(i);
+      Core::Money price, cost;
+      Core::Money::FromRupees(marketStocks[i].price, &price);
+      if (qty <= 0)
+        MessageBoxW(hwnd, L"ENTER A QUANTITY", L"MARKET", MB_ICONERROR);
+      else if (price.Mul(qty, &cost) && uBal >= cost) {
+        if (dbInstance.Trade(ToUTF8(uID), marketStocks[i].symbol, qty,
+                             marketStocks[i].price) == 0) {
+          dbInstance.GetBalance(ToUTF8(uID), &uBal);
+          RefreshPortfolio();
           InvalidateRect(hCont, NULL, TRUE);
           MessageBoxW(hwnd, L"TRADE EXECUTED", L"MARKET", MB_OK);
         } else
@@ -990,15 +824,17 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wp, LPARAM lp) {
         MessageBoxW(hwnd, L"MARGIN CALL: INSUFFICIENT FUNDS", L"MARKET",
                     MB_ICONERROR);
     } else if (id >= 9000 && id < 9005) {
-      int i = id - 9000;
-      if (dbInstance.UpdateStocks(uID, marketStocks[i].symbol, -1,
-                                  marketStocks[i].price)) {
-        uBal += marketStocks[i].price;
-        dbInstance.UpdateBalance(uID, uBal);
+      int i = id - 9000, qty = OrderQuantity(i);
+      if (qty <= 0)
+        MessageBoxW(hwnd, L"ENTER A QUANTITY", L"MARKET", MB_ICONERROR);
+      else if (dbInstance.Trade(ToUTF8(uID), marketStocks[i].symbol, -qty,
+                                marketStocks[i].price) == 0) {
+        dbInstance.GetBalance(ToUTF8(uID), &uBal);
+        RefreshPortfolio();
         InvalidateRect(hCont, NULL, TRUE);
         MessageBoxW(hwnd, L"TRADE EXECUTED", L"MARKET", MB_OK);
       } else
-        MessageBoxW(hwnd, L"NO POSITION TO LIQUIDATE", L"MARKET", MB_ICONERROR);
+        MessageBoxW(hwnd, L"NOT ENOUGH SHARES", L"MARKET", MB_ICONERROR);
     } else if (id == 7005) {
       WCHAR n[64], p[16], d[16];
       GetWindowTextW(GetDlgItem(hCont, 7002), n, 64);
@@ -1013,7 +849,8 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wp, LPARAM lp) {
       wstringstream ac;
       for (int i = 0; i < 8; i++)
         ac << rand() % 10;
-      if (dbInstance.CreateAccount(ac.str(), n, p, wcstod(d, NULL)))
+      if (dbInstance.CreateAccount(ToUTF8(ac.str()), ToUTF8(n), ToUTF8(p),
+                                   ParseAmount(d)))
         RequestView(ACCOUNTS);
       else
         MessageBoxW(hwnd, L"VAULT CREATION FAILED", L"REG", MB_ICONERROR);
@@ -1027,6 +864,7 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wp, LPARAM lp) {
     RepositionControls();
   } break;
   case WM_DESTROY:
+    marketSim.Stop();
     PostQuitMessage(0);
     break;
   default:
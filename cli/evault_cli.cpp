@@ -0,0 +1,2141 @@
+// Headless driver for the Evault core: runs single operations against a
+// database file and replays synthetic banking/trading workloads so the engine
+// can be profiled without the Win32 front end.
+
+#include "AccountDirectory.h"
+#include "AccountEngine.h"
+#include "Backend.h"
+#include "Candles.h"
+#include "Exchange.h"
+#include "Indicators.h"
+#include "Market.h"
+#include "MarketSim.h"
+#include "Portfolio.h"
+#include "Risk.h"
+#include "Valuation.h"
+#include "VaultDB.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <future>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+const char *kUsage =
+    "usage: evault_cli [--db PATH] COMMAND [ARGS]\n"
+    "\n"
+    "commands:\n"
+    "  accounts                         list accounts and balances\n"
+    "  total                            sum of all balances\n"
+    "  create NUM NAME PIN BALANCE      open an account\n"
+    "  deposit NUM AMOUNT\n"
+    "  withdraw NUM AMOUNT\n"
+    "  transfer FROM TO_NUM AMOUNT\n"
+    "  find NAME                        accounts with this holder name\n"
+    "  trade NUM SYMBOL QTY             buy (QTY > 0) or sell (QTY < 0)\n"
+    "  basket NUM SYM:QTY...            buy and sell several symbols in one\n"
+    "                                   all-or-nothing order\n"
+    "  fills NUM [LIMIT]                recent trades, newest first\n"
+    "                                   create, deposit, withdraw, transfer,\n"
+    "                                   trade and basket take --key K: a\n"
+    "                                   repeated key returns the first result\n"
+    "  settle FILE                      apply a settlement file of\n"
+    "                                   \"FROM TO_NUM AMOUNT [KEY]\" lines as\n"
+    "                                   one batch\n"
+    "  verify [--threads N]             recompute balances from the ledger\n"
+    "  bench [--ops N] [--accounts N] [--seed N] [--mix LIST]\n"
+    "        [--group-ops N] [--group-us N]\n"
+    "                                   replay a random workload; LIST is a\n"
+    "                                   comma list of deposit, withdraw,\n"
+    "                                   transfer, trade, lookup (default:\n"
+    "                                   all);\n"
+    "                                   --group-* turn on group commit\n"
+    "  cachebench [--accounts N] [--lookups N] [--seed N]\n"
+    "                                   in-memory account cache: flat table\n"
+    "                                   vs std::map (no database access)\n"
+    "  refreshbench [--accounts N] [--rounds N] [--changes N] [--seed N]\n"
+    "                                   account cache: full reload vs\n"
+    "                                   incremental refresh after another\n"
+    "                                   connection changes N accounts\n"
+    "  historybench [--rows N] [--page N]\n"
+    "                                   first-page, deep-page and full\n"
+    "                                   history reads for an account with\n"
+    "                                   N more transactions\n"
+    "  queuebench [--producers N] [--ops N] [--accounts N] [--batch N]\n"
+    "             [--seed N]\n"
+    "                                   deposits, withdrawals and transfers\n"
+    "                                   submitted from N threads to one\n"
+    "                                   batching writer thread\n"
+    "  settlebench [--transfers N] [--accounts N] [--seed N]\n"
+    "                                   N transfers one at a time vs one\n"
+    "                                   netted TransferBatch\n"
+    "  enginebench [--threads N] [--transfers N] [--accounts N]\n"
+    "              [--shards N] [--seed N]\n"
+    "                                   concurrent transfers through the\n"
+    "                                   sharded in-memory AccountEngine\n"
+    "  keybench [--ops N] [--accounts N] [--seed N]\n"
+    "                                   transfers without keys, with fresh\n"
+    "                                   keys, and retried with the same keys\n"
+    "  casbench [--threads N] [--trades N] [--seed N]\n"
+    "                                   N connections trading one position;\n"
+    "                                   checks no update is lost\n"
+    "  basketbench [--accounts N] [--seed N]\n"
+    "                                   rebalance every account across all\n"
+    "                                   symbols: one trade per leg vs one\n"
+    "                                   basket\n"
+    "  directorybench [--accounts N] [--paints N] [--every N]\n"
+    "                                   account list per paint: LoadAccounts\n"
+    "                                   vs AccountDirectory snapshots, with a\n"
+    "                                   deposit every N paints\n"
+    "  portfoliobench [--repaints N]\n"
+    "                                   stock portal repaint: a position\n"
+    "                                   query per row vs a PortfolioSnapshot,\n"
+    "                                   idle and after a trade\n"
+    "  bookbench [--ops N] [--depth N] [--settled N] [--accounts N]\n"
+    "            [--seed N]\n"
+    "                                   order book add/cancel/match latency,\n"
+    "                                   then N orders matched and settled\n"
+    "                                   through the exchange\n"
+    "  marketbench [--symbols N] [--ticks N] [--seed N]\n"
+    "                                   vectorized GBM price simulation\n"
+    "                                   (no database access)\n"
+    "  ringbench [--depth N] [--pushes N] [--seed N]\n"
+    "                                   price history: vector with erase and\n"
+    "                                   min/max scan vs ring buffer\n"
+    "  candlebench [--symbols N] [--ticks N] [--tick-ms N] [--depth N]\n"
+    "              [--seed N] [--store PATH]\n"
+    "                                   1s/1m/5m/1h OHLC bars from simulated\n"
+    "                                   ticks and chart window queries; with\n"
+    "                                   --store, logging to the file and\n"
+    "                                   replaying it\n"
+    "  indicatorbench [--symbols N] [--ticks N] [--window N] [--seed N]\n"
+    "                                   SMA/EMA/VWAP/Bollinger/RSI/channel:\n"
+    "                                   batch over all symbols vs per symbol\n"
+    "                                   vs rescanning the window\n"
+    "  valuebench [--accounts N] [--symbols N] [--positions N] [--ticks N]\n"
+    "             [--changed F] [--seed N]\n"
+    "                                   mark every account to market per\n"
+    "                                   tick: per-position gather vs full\n"
+    "                                   columnar pass vs incremental, with\n"
+    "                                   fraction F of symbols moving each\n"
+    "                                   tick\n"
+    "  value [--top N]                  equity and unrealized P&L of every\n"
+    "                                   account at the default market prices\n"
+    "  riskbench [--accounts N] [--symbols N] [--positions N]\n"
+    "            [--scenarios N] [--threads N] [--correlation R] [--seed N]\n"
+    "                                   Monte Carlo VaR/ES of a synthetic\n"
+    "                                   book on all threads vs one, checking\n"
+    "                                   they agree\n"
+    "  risk [--scenarios N] [--confidence P] [--vol V] [--correlation R]\n"
+    "       [--threads N] [--seed N] [--top N]\n"
+    "                                   1-day VaR and expected shortfall of\n"
+    "                                   every account at the default market\n";
+
+typedef chrono::steady_clock Clock;
+
+struct OpStats {
+  vector<double> micros;
+  size_t failed = 0;
+
+  void Add(double us, bool ok) {
+    micros.push_back(us);
+    if (!ok)
+      failed++;
+  }
+
+  void Print(const char *name) {
+    if (micros.empty())
+      return;
+    sort(micros.begin(), micros.end());
+    double total = 0;
+    for (double m : micros)
+      total += m;
+    printf("%-10s %9zu ops %7zu failed %11.0f ops/s  p50 %8.1f us  "
+           "p99 %8.1f us\n",
+           name, micros.size(), failed, micros.size() / (total / 1e6),
+           micros[micros.size() / 2], micros[micros.size() * 99 / 100]);
+  }
+};
+
+bool FlagValue(vector<string> &args, const char *flag, string *out) {
+  for (size_t i = 0; i + 1 < args.size(); i++)
+    if (args[i] == flag) {
+      *out = args[i + 1];
+      args.erase(args.begin() + i, args.begin() + i + 2);
+      return true;
+    }
+  return false;
+}
+
+long FlagLong(vector<string> &args, const char *flag, long def) {
+  string v;
+  return FlagValue(args, flag, &v) ? strtol(v.c_str(), nullptr, 10) : def;
+}
+
+int FindStock(const vector<Core::Stock> &market, const string &symbol) {
+  for (size_t i = 0; i < market.size(); i++)
+    if (market[i].symbol == symbol)
+      return (int)i;
+  return -1;
+}
+
+bool ParseMoney(const string &text, Core::Money *out) {
+  if (Core::Money::Parse(text, out))
+    return true;
+  fprintf(stderr, "invalid amount %s\n", text.c_str());
+  return false;
+}
+
+// Same call the stock portal makes.
+bool Trade(Core::VaultDB &db, const string &acc, const Core::Stock &s,
+           int qty, const string &key = "") {
+  return db.Trade(acc, s.symbol, qty, s.price, nullptr, key) == 0;
+}
+
+int CmdAccounts(Core::VaultDB &db) {
+  for (auto &a : db.LoadAccounts())
+    printf("%s  %-24s %14s\n", a.accNum.c_str(), a.name.c_str(),
+           a.balance.ToString().c_str());
+  return 0;
+}
+
+int CmdTotal(Core::VaultDB &db) {
+  vector<Core::Account> accs = db.LoadAccounts();
+  vector<Core::Money> balances;
+  balances.reserve(accs.size());
+  for (auto &a : accs)
+    balances.push_back(a.balance);
+  Core::Money total;
+  if (!Core::SumMoney(balances.data(), balances.size(), &total)) {
+    fprintf(stderr, "total out of range\n");
+    return 1;
+  }
+  printf("%zu accounts, total %s\n", accs.size(), total.ToString().c_str());
+  return 0;
+}
+
+// Bench accounts live in their own 9xxxxxxx range with unique names so
+// each lookup resolves to exactly one row.
+void SetupBenchAccounts(Core::VaultDB &db, long n, vector<string> *nums,
+                        vector<string> *names) {
+  map<string, bool> existing;
+  for (auto &a : db.LoadAccounts())
+    existing[a.accNum] = true;
+  Core::Money opening;
+  Core::Money::FromRupees(1000000, &opening);
+  Clock::time_point t0 = Clock::now();
+  for (long i = 0; i < n; i++) {
+    char num[24], name[32];
+    snprintf(num, sizeof num, "%08ld", 90000000 + i);
+    snprintf(name, sizeof name, "bench-%06ld", i);
+    nums->push_back(num);
+    names->push_back(name);
+    if (!existing.count(num))
+      db.CreateAccount(num, name, "0000", opening);
+  }
+  printf("setup      %ld accounts in %.1f ms\n", n,
+         chrono::duration<double, milli>(Clock::now() - t0).count());
+}
+
+bool BenchTotal(Core::VaultDB &db, const vector<string> &nums,
+                Core::Money *total) {
+  vector<Core::Money> balances(nums.size());
+  for (size_t i = 0; i < nums.size(); i++)
+    if (!db.GetBalance(nums[i], &balances[i]))
+      return false;
+  return Core::SumMoney(balances.data(), balances.size(), total);
+}
+
+int CmdSettle(Core::VaultDB &db, const string &path) {
+  FILE *f = fopen(path.c_str(), "r");
+  if (!f) {
+    fprintf(stderr, "cannot open %s\n", path.c_str());
+    return 1;
+  }
+  // Blank lines and lines starting with '#' are skipped; anything else that
+  // does not parse goes through with a zero amount and fails with code 5.
+  vector<Core::TransferRequest> requests;
+  vector<int> lineNo;
+  char line[256];
+  for (int n = 1; fgets(line, sizeof line, f); n++) {
+    char from[64], to[64], amount[64], key[128];
+    if (line[0] == '#' || sscanf(line, "%63s", from) != 1)
+      continue;
+    Core::TransferRequest r;
+    int fields = sscanf(line, "%63s %63s %63s %127s", from, to, amount, key);
+    if (fields >= 3) {
+      r.from = from;
+      r.to = to;
+      Core::Money::Parse(amount, &r.amount);
+    }
+    if (fields == 4)
+      r.key = key;
+    requests.push_back(r);
+    lineNo.push_back(n);
+  }
+  fclose(f);
+
+  Clock::time_point t0 = Clock::now();
+  vector<int> results;
+  bool ok = db.TransferBatch(requests, &results);
+  double ms = chrono::duration<double, milli>(Clock::now() - t0).count();
+  size_t failed = 0;
+  for (size_t i = 0; i < results.size(); i++)
+    if (results[i] != 0) {
+      failed++;
+      printf("line %-6d code %d\n", lineNo[i], results[i]);
+    }
+  printf("settled    %zu of %zu transfers in %.1f ms\n",
+         requests.size() - failed, requests.size(), ms);
+  if (!ok)
+    fprintf(stderr, "batch not written\n");
+  return ok ? 0 : 1;
+}
+
+int CmdVerify(Core::VaultDB &db, vector<string> args) {
+  long threads = FlagLong(args, "--threads", thread::hardware_concurrency());
+  Clock::time_point t0 = Clock::now();
+  Core::LedgerReport r;
+  if (threads < 0 || !db.VerifyLedger((unsigned)threads, &r)) {
+    fprintf(stderr, "cannot read the ledger\n");
+    return 1;
+  }
+  printf("ledger     %zu entries, %zu postings, %zu accounts in %.1f ms "
+         "(%ld threads)\n",
+         r.entries, r.postings, r.accounts,
+         chrono::duration<double, milli>(Clock::now() - t0).count(), threads);
+  printf("unbalanced %zu entries\n", r.unbalancedEntries);
+  for (auto &acc : r.mismatched)
+    printf("mismatch   %s\n", acc.c_str());
+  return r.Ok() ? 0 : 1;
+}
+
+int CmdBench(Core::VaultDB &db, vector<string> args) {
+  long ops = FlagLong(args, "--ops", 10000);
+  long nAccounts = FlagLong(args, "--accounts", 1000);
+  long seed = FlagLong(args, "--seed", 1);
+  string mix = "deposit,withdraw,transfer,trade,lookup";
+  FlagValue(args, "--mix", &mix);
+  Core::GroupCommitConfig gc;
+  gc.maxOps = (size_t)FlagLong(args, "--group-ops", 0);
+  gc.maxMicros = (uint32_t)FlagLong(args, "--group-us", 2000);
+
+  enum Kind { DEPOSIT, WITHDRAW, TRANSFER, TRADE, LOOKUP, KIND_COUNT };
+  static const char *kNames[] = {"deposit", "withdraw", "transfer", "trade",
+                                 "lookup"};
+  vector<Kind> kinds;
+  for (int k = 0; k < KIND_COUNT; k++)
+    if (mix.find(kNames[k]) != string::npos)
+      kinds.push_back((Kind)k);
+  if (kinds.empty() || ops <= 0 || nAccounts < 2) {
+    fputs(kUsage, stderr);
+    return 2;
+  }
+
+  vector<string> nums, names;
+  SetupBenchAccounts(db, nAccounts, &nums, &names);
+
+  mt19937_64 rng(seed);
+  uniform_int_distribution<long> pickAcc(0, nAccounts - 1);
+  uniform_int_distribution<int> pickAmt(1, 100);
+  vector<Core::Stock> market = Core::DefaultMarket();
+  uniform_int_distribution<size_t> pickStock(0, market.size() - 1);
+  OpStats stats[KIND_COUNT];
+  // With group commit on, the latency above is time to return; this counts
+  // when operations actually became durable.
+  size_t durable = 0, lost = 0;
+  auto onDurable = [&](bool ok) { ok ? durable++ : lost++; };
+  if (gc.maxOps > 0)
+    db.GroupCommit().Enable(gc);
+
+  Clock::time_point t0 = Clock::now();
+  for (long i = 0; i < ops; i++) {
+    Kind k = kinds[rng() % kinds.size()];
+    long a = pickAcc(rng);
+    Core::Money amt;
+    Core::Money::FromPaise(pickAmt(rng) * 100, &amt);
+    if (i % 100 == 0)
+      Core::TickMarket(market);
+
+    Clock::time_point s = Clock::now();
+    bool ok = false;
+    switch (k) {
+    case DEPOSIT:
+      ok = db.Deposit(nums[a], amt, onDurable);
+      break;
+    case WITHDRAW:
+      ok = db.Withdraw(nums[a], amt, onDurable);
+      break;
+    case TRANSFER: {
+      long b = pickAcc(rng);
+      if (b == a)
+        b = (b + 1) % nAccounts;
+      ok = db.Transfer(nums[a], nums[b], amt, onDurable) == 0;
+    } break;
+    case TRADE: {
+      const Core::Stock &st = market[pickStock(rng)];
+      int qty = (rng() & 1) ? 1 : -1;
+      ok = Trade(db, nums[a], st, qty);
+    } break;
+    case LOOKUP:
+      ok = db.FindAccountsByName(names[a]).size() == 1;
+      break;
+    case KIND_COUNT:
+      break;
+    }
+    stats[k].Add(
+        chrono::duration<double, micro>(Clock::now() - s).count(), ok);
+  }
+  db.GroupCommit().Disable();
+  double wall = chrono::duration<double>(Clock::now() - t0).count();
+
+  for (int k = 0; k < KIND_COUNT; k++)
+    stats[k].Print(kNames[k]);
+  printf("total      %9ld ops in %.3f s (%.0f ops/s)\n", ops, wall,
+         ops / wall);
+  Core::StmtCacheStats sc = db.GetStmtCacheStats();
+  printf("stmt cache %llu hits, %llu misses\n", sc.hits, sc.misses);
+  Core::GroupCommitStats gs = db.GroupCommit().Stats();
+  printf("durable    %zu ops, %zu not applied", durable, lost);
+  if (gs.batches)
+    printf(", %llu group commits (%.1f ops/commit)", gs.batches,
+           (double)gs.ops / gs.batches);
+  printf("\n");
+  return 0;
+}
+
+int CmdSettleBench(Core::VaultDB &db, vector<string> args) {
+  long transfers = FlagLong(args, "--transfers", 20000);
+  long nAccounts = FlagLong(args, "--accounts", 1000);
+  long seed = FlagLong(args, "--seed", 1);
+  if (transfers <= 0 || nAccounts < 2) {
+    fputs(kUsage, stderr);
+    return 2;
+  }
+  vector<string> nums, names;
+  SetupBenchAccounts(db, nAccounts, &nums, &names);
+  mt19937_64 rng(seed);
+  vector<Core::TransferRequest> requests(transfers);
+  for (auto &r : requests) {
+    size_t a = rng() % nums.size(), b = rng() % nums.size();
+    r.from = nums[a];
+    r.to = nums[b == a ? (b + 1) % nums.size() : b];
+    Core::Money::FromPaise((int64_t)(rng() % 100 + 1) * 100, &r.amount);
+  }
+  Core::Money before, after;
+  if (!BenchTotal(db, nums, &before)) {
+    fprintf(stderr, "cannot read bench balances\n");
+    return 1;
+  }
+
+  Clock::time_point t0 = Clock::now();
+  long failed = 0;
+  for (auto &r : requests)
+    if (db.Transfer(r.from, r.to, r.amount) != 0)
+      failed++;
+  double single = chrono::duration<double>(Clock::now() - t0).count();
+  printf("single     %ld transfers (%ld failed) in %.3f s (%.0f ops/s)\n",
+         transfers, failed, single, transfers / single);
+
+  vector<int> results;
+  t0 = Clock::now();
+  bool ok = db.TransferBatch(requests, &results);
+  double batched = chrono::duration<double>(Clock::now() - t0).count();
+  failed = 0;
+  for (int r : results)
+    if (r != 0)
+      failed++;
+  printf("batch      %ld transfers (%ld failed) in %.3f s (%.0f ops/s)\n",
+         transfers, failed, batched, transfers / batched);
+
+  if (!ok || !BenchTotal(db, nums, &after) || after != before) {
+    fprintf(stderr, "balance check failed\n");
+    return 1;
+  }
+  printf("balances   consistent\n");
+  return 0;
+}
+
+int CmdEngineBench(Core::VaultDB &db, vector<string> args) {
+  long threads = FlagLong(args, "--threads", 4);
+  long transfers = FlagLong(args, "--transfers", 200000);
+  long nAccounts = FlagLong(args, "--accounts", 1000);
+  long shards = FlagLong(args, "--shards", 64);
+  long seed = FlagLong(args, "--seed", 1);
+  if (threads <= 0 || transfers <= 0 || nAccounts < 2 || shards <= 0) {
+    fputs(kUsage, stderr);
+    return 2;
+  }
+  vector<string> nums, names;
+  SetupBenchAccounts(db, nAccounts, &nums, &names);
+  Core::Money before, after;
+  if (!BenchTotal(db, nums, &before)) {
+    fprintf(stderr, "cannot read bench balances\n");
+    return 1;
+  }
+
+  Core::AccountEngine engine(db, (size_t)shards);
+  engine.Load();
+  engine.Start();
+  vector<thread> pool;
+  vector<long> failed(threads);
+  Clock::time_point t0 = Clock::now();
+  for (long t = 0; t < threads; t++)
+    pool.emplace_back([&, t] {
+      mt19937_64 rng(seed * 1000003 + t);
+      long mine = transfers / threads + (t < transfers % threads ? 1 : 0);
+      for (long i = 0; i < mine; i++) {
+        size_t a = rng() % nums.size(), b = rng() % nums.size();
+        if (b == a)
+          b = (b + 1) % nums.size();
+        Core::Money amt;
+        Core::Money::FromPaise((int64_t)(rng() % 100 + 1) * 100, &amt);
+        if (engine.Transfer(nums[a], nums[b], amt) != 0)
+          failed[t]++;
+      }
+    });
+  for (auto &th : pool)
+    th.join();
+  double wall = chrono::duration<double>(Clock::now() - t0).count();
+  engine.Flush();
+  double flushed = chrono::duration<double>(Clock::now() - t0).count();
+  engine.Stop();
+
+  long totalFailed = 0;
+  for (long f : failed)
+    totalFailed += f;
+  Core::AccountEngineStats st = engine.Stats();
+  printf("engine     %ld threads, %ld shards, %llu transfers (%ld failed) in "
+         "%.3f s (%.0f ops/s)\n",
+         threads, shards, st.transfers, totalFailed, wall,
+         st.transfers / wall);
+  printf("persisted  %llu transfers in %llu batches, all on disk after "
+         "%.3f s (%llu refused, %llu retried)\n",
+         st.persisted, st.batches, flushed, st.diverged, st.retries);
+
+  // The database must agree with the engine account by account.
+  for (auto &n : nums) {
+    Core::Money inMemory, onDisk;
+    if (!engine.GetBalance(n, &inMemory) || !db.GetBalance(n, &onDisk) ||
+        inMemory != onDisk) {
+      fprintf(stderr, "balance mismatch on %s\n", n.c_str());
+      return 1;
+    }
+  }
+  if (!BenchTotal(db, nums, &after) || after != before) {
+    fprintf(stderr, "balance check failed\n");
+    return 1;
+  }
+  printf("balances   consistent\n");
+  return 0;
+}
+
+int CmdKeyBench(Core::VaultDB &db, vector<string> args) {
+  long ops = FlagLong(args, "--ops", 20000);
+  long nAccounts = FlagLong(args, "--accounts", 1000);
+  long seed = FlagLong(args, "--seed", 1);
+  if (ops <= 0 || nAccounts < 2) {
+    fputs(kUsage, stderr);
+    return 2;
+  }
+  vector<string> nums, names;
+  SetupBenchAccounts(db, nAccounts, &nums, &names);
+  mt19937_64 rng(seed);
+  vector<Core::TransferRequest> requests(ops);
+  // Keys are unique per run so reruns on the same database start fresh.
+  long long run = (long long)chrono::system_clock::now().time_since_epoch()
+                      .count();
+  for (long i = 0; i < ops; i++) {
+    Core::TransferRequest &r = requests[i];
+    size_t a = rng() % nums.size(), b = rng() % nums.size();
+    r.from = nums[a];
+    r.to = nums[b == a ? (b + 1) % nums.size() : b];
+    Core::Money::FromPaise((int64_t)(rng() % 100 + 1) * 100, &r.amount);
+    r.key = "bench-" + to_string(run) + "-" + to_string(i);
+  }
+  Core::Money before, after;
+  if (!BenchTotal(db, nums, &before)) {
+    fprintf(stderr, "cannot read bench balances\n");
+    return 1;
+  }
+
+  const char *labels[] = {"plain", "keyed", "retried"};
+  vector<int> first(ops);
+  for (int pass = 0; pass < 3; pass++) {
+    OpStats stats;
+    size_t differ = 0;
+    for (long i = 0; i < ops; i++) {
+      const Core::TransferRequest &r = requests[i];
+      Clock::time_point t0 = Clock::now();
+      int res = db.Transfer(r.from, r.to, r.amount, nullptr,
+                            pass == 0 ? string() : r.key);
+      stats.Add(chrono::duration<double, micro>(Clock::now() - t0).count(),
+                res == 0);
+      if (pass == 1)
+        first[i] = res;
+      else if (pass == 2 && res != first[i])
+        differ++;
+    }
+    stats.Print(labels[pass]);
+    if (differ) {
+      fprintf(stderr, "%zu retries returned a different result\n", differ);
+      return 1;
+    }
+  }
+  Core::IdempotencyStats ks = db.GetIdempotencyStats();
+  printf("keys       %llu recorded, %llu answered from memory, %llu from "
+         "disk\n",
+         ks.recorded, ks.hits, ks.replayed);
+  if (!BenchTotal(db, nums, &after) || after != before) {
+    fprintf(stderr, "balance check failed\n");
+    return 1;
+  }
+  printf("balances   consistent\n");
+  return 0;
+}
+
+// "SYM:QTY" against the default market's prices.
+bool ParseLeg(const vector<Core::Stock> &market, const string &text,
+              Core::OrderLeg *leg) {
+  size_t colon = text.find(':');
+  int i = FindStock(market, text.substr(0, colon));
+  if (colon == string::npos || i < 0) {
+    fprintf(stderr, "invalid leg %s (want SYMBOL:QTY)\n", text.c_str());
+    return false;
+  }
+  *leg = {market[i].symbol, atoi(text.c_str() + colon + 1), market[i].price};
+  return true;
+}
+
+int CmdBasket(Core::VaultDB &db, const vector<string> &args,
+              const string &key) {
+  vector<Core::Stock> market = Core::DefaultMarket();
+  vector<Core::OrderLeg> legs(args.size() - 1);
+  for (size_t i = 1; i < args.size(); i++)
+    if (!ParseLeg(market, args[i], &legs[i - 1]))
+      return 1;
+  int res = db.ExecuteBasket(args[0], legs, nullptr, key);
+  if (res != 0)
+    fprintf(stderr, "basket failed: code %d\n", res);
+  return res;
+}
+
+// A rebalance across every market symbol for each account, submitted first
+// as one Trade per leg and then as one basket. Positions open at about
+// Rs. 1 lakh per symbol and both passes apply the same legs, so each must
+// end at opening + 2 * leg; a closing basket then sells it all back.
+int CmdBasketBench(Core::VaultDB &db, vector<string> args) {
+  long nAccounts = FlagLong(args, "--accounts", 1000);
+  long seed = FlagLong(args, "--seed", 1);
+  if (nAccounts < 1) {
+    fputs(kUsage, stderr);
+    return 2;
+  }
+  vector<string> nums, names;
+  SetupBenchAccounts(db, nAccounts, &nums, &names);
+  vector<Core::Stock> market = Core::DefaultMarket();
+  vector<Core::OrderLeg> opening;
+  for (auto &s : market)
+    opening.push_back({s.symbol, max(4, (int)(100000 / s.price)), s.price});
+  mt19937_64 rng(seed);
+  vector<vector<Core::OrderLeg>> rebalance(nums.size(), opening);
+  for (auto &legs : rebalance)
+    for (auto &leg : legs) {
+      int span = leg.quantity / 4; // two passes leave half the opening
+      leg.quantity = (int)(rng() % (2 * span + 1)) - span;
+      if (leg.quantity == 0)
+        leg.quantity = 1;
+    }
+  vector<int> held(nums.size() * market.size());
+  for (size_t a = 0; a < nums.size(); a++)
+    for (size_t i = 0; i < market.size(); i++)
+      held[a * market.size() + i] =
+          db.GetOwnedStocks(nums[a], market[i].symbol);
+  for (auto &num : nums)
+    if (db.ExecuteBasket(num, opening) != 0) {
+      fprintf(stderr, "opening basket failed for %s\n", num.c_str());
+      return 1;
+    }
+
+  OpStats legs, baskets;
+  for (size_t a = 0; a < nums.size(); a++) {
+    Clock::time_point t0 = Clock::now();
+    bool ok = true;
+    for (auto &leg : rebalance[a])
+      ok = db.Trade(nums[a], leg.symbol, leg.quantity, leg.price) == 0 && ok;
+    legs.Add(chrono::duration<double, micro>(Clock::now() - t0).count(), ok);
+  }
+  for (size_t a = 0; a < nums.size(); a++) {
+    Clock::time_point t0 = Clock::now();
+    int res = db.ExecuteBasket(nums[a], rebalance[a]);
+    baskets.Add(chrono::duration<double, micro>(Clock::now() - t0).count(),
+                res == 0);
+  }
+  legs.Print("per-leg");
+  baskets.Print("basket");
+
+  for (size_t a = 0; a < nums.size(); a++) {
+    vector<Core::OrderLeg> closing = opening;
+    for (size_t i = 0; i < closing.size(); i++)
+      closing[i].quantity =
+          -(opening[i].quantity + 2 * rebalance[a][i].quantity);
+    bool ok = db.ExecuteBasket(nums[a], closing) == 0;
+    for (size_t i = 0; ok && i < market.size(); i++)
+      ok = db.GetOwnedStocks(nums[a], market[i].symbol) ==
+           held[a * market.size() + i];
+    if (!ok) {
+      fprintf(stderr, "position mismatch for %s\n", nums[a].c_str());
+      return 1;
+    }
+  }
+  printf("positions  consistent\n");
+  Core::LedgerReport r;
+  if (!db.VerifyLedger(0, &r) || !r.Ok()) {
+    fprintf(stderr, "ledger check failed\n");
+    return 1;
+  }
+  printf("ledger     balanced\n");
+  return 0;
+}
+
+// Nanosecond percentiles for the book benchmark, where OpStats' 0.1 us
+// resolution would round everything to one bucket.
+void PrintNanos(const char *name, vector<double> &ns) {
+  if (ns.empty())
+    return;
+  sort(ns.begin(), ns.end());
+  printf("%-10s %9zu ops  p50 %6.0f ns  p99 %6.0f ns  p99.9 %7.0f ns\n", name,
+         ns.size(), ns[ns.size() / 2], ns[ns.size() * 99 / 100],
+         ns[ns.size() * 999 / 1000]);
+}
+
+// Part one drives a bare OrderBook with a random mix of limit orders around
+// the touch, cancels and small market orders, timing each call. Part two
+// sends orders from bench accounts through an Exchange, so every match is
+// settled in the database, and checks that cash was only moved between
+// them.
+int CmdBookBench(Core::VaultDB &db, vector<string> args) {
+  long ops = FlagLong(args, "--ops", 1000000);
+  long depth = FlagLong(args, "--depth", 10000);
+  long settled = FlagLong(args, "--settled", 2000);
+  long nAccounts = FlagLong(args, "--accounts", 100);
+  long seed = FlagLong(args, "--seed", 1);
+  if (ops <= 0 || depth < 0 || settled < 0 || nAccounts < 2) {
+    fputs(kUsage, stderr);
+    return 2;
+  }
+  const uint32_t kLevels = 8192, kMid = kLevels / 2;
+  Core::OrderBook book(kLevels);
+  mt19937_64 rng(seed);
+  vector<uint64_t> live;
+  vector<Core::BookMatch> matches;
+  uint32_t left;
+  // Resting orders a few ticks either side of the middle, bids below.
+  for (long i = 0; i < depth; i++) {
+    bool bid = rng() & 1;
+    uint32_t off = 1 + (uint32_t)(rng() % 64);
+    uint64_t id = book.Limit(bid ? Core::BUY : Core::SELL, 0,
+                             bid ? kMid - off : kMid + off,
+                             1 + (uint32_t)(rng() % 100), &matches, &left);
+    if (left)
+      live.push_back(id);
+  }
+
+  vector<double> add, cancel, market;
+  add.reserve(ops);
+  size_t matched = 0;
+  Clock::time_point start = Clock::now();
+  for (long i = 0; i < ops; i++) {
+    unsigned kind = rng() % 10;
+    Core::Side side = rng() & 1 ? Core::BUY : Core::SELL;
+    matches.clear();
+    if (kind < 5) {
+      // Mostly passive; about one in eight crosses the touch.
+      uint32_t off = (uint32_t)(rng() % 64);
+      uint32_t tick = side == Core::BUY ? kMid - off + 8 : kMid + off - 8;
+      uint32_t qty = 1 + (uint32_t)(rng() % 100);
+      Clock::time_point t0 = Clock::now();
+      uint64_t id = book.Limit(side, 0, tick, qty, &matches, &left);
+      add.push_back(chrono::duration<double, nano>(Clock::now() - t0).count());
+      if (left)
+        live.push_back(id);
+    } else if (kind < 8 && !live.empty()) {
+      size_t j = rng() % live.size();
+      uint64_t id = live[j];
+      live[j] = live.back();
+      live.pop_back();
+      Clock::time_point t0 = Clock::now();
+      book.Cancel(id, &left);
+      cancel.push_back(
+          chrono::duration<double, nano>(Clock::now() - t0).count());
+    } else {
+      uint32_t qty = 1 + (uint32_t)(rng() % 200);
+      Clock::time_point t0 = Clock::now();
+      book.Market(side, 0, qty, &matches);
+      market.push_back(
+          chrono::duration<double, nano>(Clock::now() - t0).count());
+    }
+    matched += matches.size();
+  }
+  double secs = chrono::duration<double>(Clock::now() - start).count();
+  PrintNanos("limit", add);
+  PrintNanos("cancel", cancel);
+  PrintNanos("market", market);
+  printf("book       %ld ops, %zu matches in %.3f s (%.0f ops/s), %zu "
+         "resting\n",
+         ops, matched, secs, ops / secs, book.Resting());
+  if (settled == 0)
+    return 0;
+
+  // Everyone starts with shares to sell; sellers quote a little above the
+  // stock's price and buyers lift or hit them with limit and market orders.
+  vector<string> nums, names;
+  SetupBenchAccounts(db, nAccounts, &nums, &names);
+  vector<Core::Stock> market0 = Core::DefaultMarket();
+  const Core::Stock &s = market0[1];
+  for (auto &num : nums)
+    if (db.ExecuteBasket(num, {{s.symbol, 1000, s.price}}) != 0) {
+      fprintf(stderr, "cannot seed shares for %s\n", num.c_str());
+      return 1;
+    }
+  Core::Money before, after;
+  int sharesBefore = 0, sharesAfter = 0;
+  for (auto &num : nums)
+    sharesBefore += db.GetOwnedStocks(num, s.symbol);
+  if (!BenchTotal(db, nums, &before)) {
+    fprintf(stderr, "cannot read bench balances\n");
+    return 1;
+  }
+  Core::Exchange ex(db, market0);
+  OpStats orders;
+  vector<uint64_t> resting;
+  for (long i = 0; i < settled; i++) {
+    const string &acc = nums[rng() % nums.size()];
+    int qty = 1 + (int)(rng() % 20);
+    double px = s.price + (double)(rng() % 20) / 10;
+    uint64_t id = 0;
+    unsigned kind = rng() % 4;
+    Clock::time_point t0 = Clock::now();
+    int res = 0;
+    if (kind == 0)
+      res = ex.Submit(acc, s.symbol, -qty, px, &id);
+    else if (kind == 1)
+      res = ex.Submit(acc, s.symbol, qty, 0);
+    else if (kind == 2)
+      res = ex.Submit(acc, s.symbol, qty, px, &id);
+    else if (!resting.empty()) {
+      ex.Cancel(resting.back()); // false if it has filled since
+      resting.pop_back();
+    }
+    // 3 just means the account could not cover the order.
+    orders.Add(chrono::duration<double, micro>(Clock::now() - t0).count(),
+               res == 0 || res == 3);
+    if (id)
+      resting.push_back(id);
+  }
+  orders.Print("settled");
+  Core::ExchangeStats es = ex.Stats();
+  printf("exchange   %llu orders, %llu matches, %llu refused\n", es.orders,
+         es.matches, es.refused);
+  for (auto &num : nums)
+    sharesAfter += db.GetOwnedStocks(num, s.symbol);
+  if (!BenchTotal(db, nums, &after) || after != before ||
+      sharesAfter != sharesBefore || es.refused) {
+    fprintf(stderr, "settlement check failed\n");
+    return 1;
+  }
+  printf("balances   consistent\n");
+  return 0;
+}
+
+// Ticks a MarketSim of N symbols on this thread and compares the cost per
+// symbol with the portal's TickMarket; checks the simulated log returns
+// against the GBM mean and variance; then runs the ticker thread flat out
+// while this thread takes snapshots.
+int CmdMarketBench(vector<string> args) {
+  long nSymbols = FlagLong(args, "--symbols", 100000);
+  long ticks = FlagLong(args, "--ticks", 1000);
+  long seed = FlagLong(args, "--seed", 1);
+  if (nSymbols <= 0 || ticks <= 0) {
+    fputs(kUsage, stderr);
+    return 2;
+  }
+  const double kDrift = 0.08, kVol = 0.45, kStart = 100.0;
+  Core::MarketSimConfig cfg;
+  cfg.seed = (uint64_t)seed;
+  Core::MarketSim sim(cfg);
+  for (long i = 0; i < nSymbols; i++)
+    sim.Add("S" + to_string(i), kStart, kDrift, kVol);
+
+  Clock::time_point t0 = Clock::now();
+  for (long t = 0; t < ticks; t++)
+    sim.Step();
+  double secs = chrono::duration<double>(Clock::now() - t0).count();
+  printf("gbm        %ld symbols x %ld ticks in %.3f s: %.2f ns/symbol, "
+         "%.0f ticks/s\n",
+         nSymbols, ticks, secs, secs * 1e9 / nSymbols / ticks, ticks / secs);
+
+  vector<Core::Stock> legacy(
+      nSymbols, Core::Stock{"", "", kStart, Core::RingBuffer<float>(15)});
+  long legacyTicks = ticks < 20 ? ticks : 20;
+  t0 = Clock::now();
+  for (long t = 0; t < legacyTicks; t++)
+    Core::TickMarket(legacy);
+  double lsecs = chrono::duration<double>(Clock::now() - t0).count();
+  printf("tickmarket %ld symbols x %ld ticks in %.3f s: %.2f ns/symbol\n",
+         nSymbols, legacyTicks, lsecs, lsecs * 1e9 / nSymbols / legacyTicks);
+
+  // Every symbol has the same parameters, so the cross-section of log
+  // returns should have mean (mu - sigma^2/2) T and variance sigma^2 T.
+  vector<double> prices;
+  sim.Snapshot(&prices);
+  double years = ticks * cfg.dtYears, mean = 0, var = 0;
+  for (double p : prices)
+    mean += log(p / kStart);
+  mean /= prices.size();
+  for (double p : prices)
+    var += (log(p / kStart) - mean) * (log(p / kStart) - mean);
+  var /= prices.size();
+  printf("returns    mean %.4f (expect %.4f), variance %.4f (expect %.4f)\n",
+         mean, (kDrift - kVol * kVol / 2) * years, var, kVol * kVol * years);
+
+  uint64_t first = sim.Ticks();
+  size_t snapshots = 0;
+  sim.Start(0);
+  t0 = Clock::now();
+  while (Clock::now() - t0 < chrono::seconds(1)) {
+    sim.Snapshot(&prices);
+    snapshots++;
+  }
+  sim.Stop();
+  printf("threaded   %llu ticks and %zu snapshots in 1 s\n",
+         (unsigned long long)(sim.Ticks() - first), snapshots);
+  return 0;
+}
+
+// A tick and a chart repaint per point, the way the portal used to keep
+// history (vector, erase the front, scan for min/max) and with the ring
+// buffer.
+int CmdRingBench(vector<string> args) {
+  long depth = FlagLong(args, "--depth", 2048);
+  long pushes = FlagLong(args, "--pushes", 200000);
+  long seed = FlagLong(args, "--seed", 1);
+  if (depth <= 0 || pushes <= 0) {
+    fputs(kUsage, stderr);
+    return 2;
+  }
+  mt19937_64 rng(seed);
+  vector<float> values(pushes);
+  for (float &v : values)
+    v = 100.0f + (float)(rng() % 10000) / 100;
+
+  vector<float> hist;
+  double check = 0;
+  Clock::time_point t0 = Clock::now();
+  for (float v : values) {
+    hist.push_back(v);
+    if ((long)hist.size() > depth)
+      hist.erase(hist.begin());
+    float lo = hist[0], hi = hist[0];
+    for (float h : hist) {
+      lo = min(lo, h);
+      hi = max(hi, h);
+    }
+    check += hi - lo;
+  }
+  double vsecs = chrono::duration<double>(Clock::now() - t0).count();
+
+  Core::RingBuffer<float> ring(depth);
+  double check2 = 0;
+  t0 = Clock::now();
+  for (float v : values) {
+    ring.Push(v);
+    check2 += ring.Max() - ring.Min();
+  }
+  double rsecs = chrono::duration<double>(Clock::now() - t0).count();
+  printf("vector     %ld pushes at depth %ld: %.1f ns each\n", pushes, depth,
+         vsecs * 1e9 / pushes);
+  printf("ring       %ld pushes at depth %ld: %.1f ns each\n", pushes, depth,
+         rsecs * 1e9 / pushes);
+  if (check != check2) {
+    fprintf(stderr, "min/max disagree\n");
+    return 1;
+  }
+  printf("min/max    identical\n");
+  return 0;
+}
+
+// Feeds MarketSim ticks, tick-ms apart on a simulated clock, into a
+// CandleAggregator and times the folding per symbol and tick, then chart
+// windows. With --store the same ticks are run again while logging to the
+// file, and the file is then replayed into a fresh aggregator.
+int CmdCandleBench(vector<string> args) {
+  long nSymbols = FlagLong(args, "--symbols", 1000);
+  long ticks = FlagLong(args, "--ticks", 20000);
+  long tickMillis = FlagLong(args, "--tick-ms", 250);
+  long depth = FlagLong(args, "--depth", 1024);
+  long seed = FlagLong(args, "--seed", 1);
+  string storePath;
+  FlagValue(args, "--store", &storePath);
+  if (nSymbols <= 0 || ticks <= 0 || tickMillis <= 0 || depth <= 0) {
+    fputs(kUsage, stderr);
+    return 2;
+  }
+  Core::CandleConfig cfg;
+  cfg.depth = depth;
+  mt19937_64 rng(seed);
+  vector<double> volumes(nSymbols);
+  for (double &v : volumes)
+    v = (double)(1 + rng() % 500);
+
+  // Returns the seconds spent in the aggregator only.
+  auto run = [&](Core::CandleAggregator &agg) {
+    Core::MarketSimConfig simCfg;
+    simCfg.seed = (uint64_t)seed;
+    Core::MarketSim sim(simCfg);
+    for (long i = 0; i < nSymbols; i++)
+      sim.Add("S" + to_string(i), 100.0, 0.08, 0.45);
+    vector<double> prices;
+    double secs = 0;
+    for (long t = 0; t < ticks; t++) {
+      sim.Step();
+      sim.Snapshot(&prices);
+      Clock::time_point t0 = Clock::now();
+      agg.OnTicks(t * tickMillis, prices.data(), prices.size(),
+                  volumes.data());
+      secs += chrono::duration<double>(Clock::now() - t0).count();
+    }
+    return secs;
+  };
+
+  Core::CandleAggregator agg(nSymbols, cfg);
+  double secs = run(agg);
+  printf("fold       %ld symbols x %ld ticks, %zu periods: %.1f ns/symbol "
+         "tick\n",
+         nSymbols, ticks, agg.Periods(), secs * 1e9 / nSymbols / ticks);
+
+  const size_t kChartBars = 120;
+  vector<Core::Candle> bars;
+  for (size_t p = 0; p < agg.Periods(); p++) {
+    size_t got = 0;
+    Clock::time_point t0 = Clock::now();
+    for (long s = 0; s < nSymbols; s++)
+      got += agg.Window(s, p, kChartBars, &bars);
+    double wsecs = chrono::duration<double>(Clock::now() - t0).count();
+    printf("window     %6llds period: %.0f ns per %zu-bar query "
+           "(%.1f bars)\n",
+           (long long)(agg.PeriodMillis(p) / 1000), wsecs * 1e9 / nSymbols,
+           kChartBars, (double)got / nSymbols);
+  }
+
+  if (storePath.empty())
+    return 0;
+  Core::CandleStore store;
+  if (!store.Open(storePath)) {
+    fprintf(stderr, "cannot open store %s\n", storePath.c_str());
+    return 1;
+  }
+  Core::CandleAggregator logged(nSymbols, cfg);
+  logged.SetSink(&store);
+  double lsecs = run(logged);
+  store.Close();
+  printf("logged     %.1f ns/symbol tick with the store\n",
+         lsecs * 1e9 / nSymbols / ticks);
+
+  Core::CandleAggregator replayed(nSymbols, cfg);
+  size_t tickRecords = 0, candleRecords = 0;
+  Clock::time_point t0 = Clock::now();
+  bool ok = Core::CandleStore::Read(
+      storePath,
+      [&](uint32_t s, int64_t time, float price, float volume) {
+        replayed.OnTick(s, time, price, volume);
+        tickRecords++;
+      },
+      [&](uint32_t, int64_t, const Core::Candle &) { candleRecords++; });
+  double rsecs = chrono::duration<double>(Clock::now() - t0).count();
+  if (!ok) {
+    fprintf(stderr, "cannot read store %s\n", storePath.c_str());
+    return 1;
+  }
+  printf("replay     %zu ticks, %zu bars in %.3f s\n", tickRecords,
+         candleRecords, rsecs);
+  return 0;
+}
+
+// Feeds MarketSim ticks to the indicators three ways and reports the cost
+// per symbol and tick: IndicatorUniverse's vectorized batch, a
+// SymbolIndicators per symbol, and rescanning each symbol's window for the
+// windowed indicators. The first two must agree exactly, the rescan to
+// rounding.
+int CmdIndicatorBench(vector<string> args) {
+  long nSymbols = FlagLong(args, "--symbols", 10000);
+  long ticks = FlagLong(args, "--ticks", 1000);
+  long window = FlagLong(args, "--window", 20);
+  long seed = FlagLong(args, "--seed", 1);
+  if (nSymbols <= 0 || ticks <= 0 || window <= 0) {
+    fputs(kUsage, stderr);
+    return 2;
+  }
+  Core::IndicatorConfig cfg;
+  cfg.window = window;
+  Core::MarketSimConfig simCfg;
+  simCfg.seed = (uint64_t)seed;
+  Core::MarketSim sim(simCfg);
+  for (long i = 0; i < nSymbols; i++)
+    sim.Add("S" + to_string(i), 100.0, 0.08, 0.45);
+  mt19937_64 rng(seed);
+  vector<double> volumes(nSymbols), prices;
+  for (double &v : volumes)
+    v = (double)(1 + rng() % 500);
+
+  Core::IndicatorUniverse batch(nSymbols, cfg);
+  vector<Core::SymbolIndicators> single(nSymbols,
+                                        Core::SymbolIndicators(cfg));
+  vector<Core::RingBuffer<double, false>> hist(
+      nSymbols, Core::RingBuffer<double, false>(window));
+  vector<double> rescanSma(nSymbols), rescanSd(nSymbols);
+  vector<double> rescanLow(nSymbols), rescanHigh(nSymbols);
+  double batchSecs = 0, singleSecs = 0, rescanSecs = 0;
+  for (long t = 0; t < ticks; t++) {
+    sim.Step();
+    sim.Snapshot(&prices);
+    Clock::time_point t0 = Clock::now();
+    batch.Tick(prices.data(), volumes.data());
+    Clock::time_point t1 = Clock::now();
+    for (long i = 0; i < nSymbols; i++)
+      single[i].Update(prices[i], volumes[i]);
+    Clock::time_point t2 = Clock::now();
+    for (long i = 0; i < nSymbols; i++) {
+      Core::RingBuffer<double, false> &h = hist[i];
+      h.Push(prices[i]);
+      double sum = 0, lo = h[0], hi = h[0];
+      for (size_t k = 0; k < h.Size(); k++) {
+        sum += h[k];
+        lo = min(lo, h[k]);
+        hi = max(hi, h[k]);
+      }
+      double mean = sum / h.Size(), sq = 0;
+      for (size_t k = 0; k < h.Size(); k++)
+        sq += (h[k] - mean) * (h[k] - mean);
+      rescanSma[i] = mean;
+      rescanSd[i] = sqrt(sq / h.Size());
+      rescanLow[i] = lo;
+      rescanHigh[i] = hi;
+    }
+    Clock::time_point t3 = Clock::now();
+    batchSecs += chrono::duration<double>(t1 - t0).count();
+    singleSecs += chrono::duration<double>(t2 - t1).count();
+    rescanSecs += chrono::duration<double>(t3 - t2).count();
+  }
+  double per = 1e9 / nSymbols / ticks;
+  printf("batch      %ld symbols x %ld ticks, window %ld: %.2f ns/symbol "
+         "tick\n",
+         nSymbols, ticks, window, batchSecs * per);
+  printf("single     %.2f ns/symbol tick\n", singleSecs * per);
+  printf("rescan     %.2f ns/symbol tick (windowed indicators only)\n",
+         rescanSecs * per);
+
+  double drift = 0;
+  for (long i = 0; i < nSymbols; i++) {
+    Core::IndicatorValues a = batch.Values(i), b = single[i].Values();
+    if (memcmp(&a, &b, sizeof a) != 0) {
+      fprintf(stderr, "batch and single differ for symbol %ld\n", i);
+      return 1;
+    }
+    double sd = (a.upper - a.lower) / (2 * cfg.bandWidth);
+    drift = max(drift, fabs(a.sma - rescanSma[i]) / rescanSma[i]);
+    drift = max(drift, fabs(sd - rescanSd[i]) / rescanSma[i]);
+    if (a.low != rescanLow[i] || a.high != rescanHigh[i]) {
+      fprintf(stderr, "channel differs for symbol %ld\n", i);
+      return 1;
+    }
+  }
+  printf("check      batch == single; vs rescan max relative error %.1e\n",
+         drift);
+  Core::IndicatorValues v = batch.Values(0);
+  printf("S0         sma %.2f ema %.2f vwap %.2f bands %.2f..%.2f rsi %.1f "
+         "channel %.2f..%.2f\n",
+         v.sma, v.ema, v.vwap, v.lower, v.upper, v.rsi, v.low, v.high);
+  return 0;
+}
+
+// Marks a synthetic book of accounts to market every tick: position rows
+// summed into their accounts one at a time, the engine's full pass, and its
+// incremental pass, with only a fraction of the symbols moving each tick.
+// Checks that all three agree.
+int CmdValueBench(vector<string> args) {
+  long nAccounts = FlagLong(args, "--accounts", 100000);
+  long nSymbols = FlagLong(args, "--symbols", 2000);
+  long nPositions = FlagLong(args, "--positions", 1000000);
+  long ticks = FlagLong(args, "--ticks", 200);
+  long seed = FlagLong(args, "--seed", 1);
+  string changedText = "0.1";
+  FlagValue(args, "--changed", &changedText);
+  double changed = atof(changedText.c_str());
+  if (nAccounts <= 0 || nSymbols <= 0 || nPositions < 0 || ticks <= 0 ||
+      changed < 0 || changed > 1) {
+    fputs(kUsage, stderr);
+    return 2;
+  }
+  Core::MarketSimConfig simCfg;
+  simCfg.seed = (uint64_t)seed;
+  Core::MarketSim sim(simCfg);
+  vector<string> symbols;
+  for (long i = 0; i < nSymbols; i++) {
+    symbols.push_back("S" + to_string(i));
+    sim.Add(symbols.back(), 100.0, 0.08, 0.45);
+  }
+
+  // Positions are dealt out account by account, a symbol each at random,
+  // and kept as rows in shuffled order as well.
+  mt19937_64 rng(seed);
+  Core::ValuationEngine engine;
+  engine.Reset(symbols);
+  vector<uint32_t> gatherAccount, gatherSymbol;
+  vector<double> gatherQty;
+  for (long a = 0; a < nAccounts; a++)
+    engine.AddAccount(to_string(90000000 + a), (double)(rng() % 1000000));
+  for (long i = 0; i < nPositions; i++) {
+    long a = i * nAccounts / max(nPositions, 1L);
+    long s = (long)(rng() % nSymbols);
+    int qty = 1 + (int)(rng() % 200);
+    engine.AddPosition(a, s, qty, 50.0 + rng() % 100);
+    gatherAccount.push_back((uint32_t)a);
+    gatherSymbol.push_back((uint32_t)s);
+    gatherQty.push_back(qty);
+  }
+  engine.Finish();
+  for (size_t i = gatherQty.size(); i > 1; i--) {
+    size_t j = rng() % i;
+    swap(gatherAccount[i - 1], gatherAccount[j]);
+    swap(gatherSymbol[i - 1], gatherSymbol[j]);
+    swap(gatherQty[i - 1], gatherQty[j]);
+  }
+
+  vector<double> prices, next, gatherMv(nAccounts);
+  sim.Snapshot(&prices);
+  engine.Update(prices.data());
+  Core::ValuationEngine full = engine;
+  double gatherSecs = 0, fullSecs = 0, updateSecs = 0;
+  size_t touched = 0;
+  uint64_t moveCut = (uint64_t)(changed * 1e6);
+  for (long t = 0; t < ticks; t++) {
+    sim.Step();
+    sim.Snapshot(&next);
+    for (long s = 0; s < nSymbols; s++)
+      if (rng() % 1000000 < moveCut)
+        prices[s] = next[s];
+    Clock::time_point t0 = Clock::now();
+    fill(gatherMv.begin(), gatherMv.end(), 0.0);
+    for (size_t i = 0; i < gatherQty.size(); i++)
+      gatherMv[gatherAccount[i]] += gatherQty[i] * prices[gatherSymbol[i]];
+    Clock::time_point t1 = Clock::now();
+    full.Value(prices.data());
+    Clock::time_point t2 = Clock::now();
+    touched += engine.Update(prices.data());
+    Clock::time_point t3 = Clock::now();
+    gatherSecs += chrono::duration<double>(t1 - t0).count();
+    fullSecs += chrono::duration<double>(t2 - t1).count();
+    updateSecs += chrono::duration<double>(t3 - t2).count();
+  }
+  double per = 1e9 / max(nPositions, 1L) / ticks;
+  printf("rows       %ld accounts, %ld symbols, %ld positions x %ld ticks: "
+         "%.2f ns/position\n",
+         nAccounts, nSymbols, nPositions, ticks, gatherSecs * per);
+  printf("full       %.2f ns/position (%.2f ms/tick)\n", fullSecs * per,
+         fullSecs * 1e3 / ticks);
+  printf("update     %.2f ns/position (%.2f ms/tick), touching %.1f%% of "
+         "positions\n",
+         updateSecs * per, updateSecs * 1e3 / ticks,
+         100.0 * touched / max(nPositions, 1L) / ticks);
+
+  double drift = 0;
+  for (long a = 0; a < nAccounts; a++) {
+    double mv = full.MarketValue()[a], scale = max(mv, 1.0);
+    if (fabs(mv - gatherMv[a]) > 1e-9 * scale ||
+        full.Equity()[a] != full.Cash()[a] + mv) {
+      fprintf(stderr, "full pass differs for account %ld\n", a);
+      return 1;
+    }
+    drift = max(drift, fabs(engine.Equity()[a] - full.Equity()[a]) / scale);
+    drift = max(drift, fabs(engine.Pnl()[a] - full.Pnl()[a]) / scale);
+  }
+  if (drift > 1e-9) {
+    fprintf(stderr, "incremental drifted %.1e from the full pass\n", drift);
+    return 1;
+  }
+  printf("check      full == rows; incremental max relative error %.1e\n",
+         drift);
+  printf("book       equity %.2f, unrealized P&L %.2f\n", full.TotalEquity(),
+         full.TotalPnl());
+  return 0;
+}
+
+// Values every account in the database at the default market's prices.
+// Lists the N largest by equity, then book totals.
+int CmdValue(Core::VaultDB &db, vector<string> args) {
+  long top = FlagLong(args, "--top", 20);
+  vector<Core::Stock> market = Core::DefaultMarket();
+  vector<string> symbols;
+  vector<double> prices;
+  for (auto &s : market) {
+    symbols.push_back(s.symbol);
+    prices.push_back(s.price);
+  }
+  Core::ValuationEngine engine;
+  if (!engine.Load(db, symbols)) {
+    fprintf(stderr, "cannot read positions\n");
+    return 1;
+  }
+  engine.Value(prices.data());
+  vector<size_t> order(engine.Accounts());
+  for (size_t i = 0; i < order.size(); i++)
+    order[i] = i;
+  sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+    return engine.Equity()[a] > engine.Equity()[b];
+  });
+  if (top >= 0 && (size_t)top < order.size())
+    order.resize(top);
+  printf("%-10s %16s %16s %16s %14s\n", "account", "cash", "stocks", "equity",
+         "P&L");
+  for (size_t a : order)
+    printf("%-10s %16.2f %16.2f %16.2f %14.2f\n",
+           engine.AccountNumber(a).c_str(), engine.Cash()[a],
+           engine.MarketValue()[a], engine.Equity()[a], engine.Pnl()[a]);
+  printf("%zu accounts, %zu positions (%zu in unlisted symbols): equity "
+         "%.2f, P&L %.2f\n",
+         engine.Accounts(), engine.Positions(), engine.Unpriced(),
+         engine.TotalEquity(), engine.TotalPnl());
+  return 0;
+}
+
+// Inverse of the standard normal CDF, by bisection.
+double NormalQuantile(double p) {
+  double lo = -10, hi = 10;
+  for (int i = 0; i < 100; i++) {
+    double mid = (lo + hi) / 2;
+    (0.5 * erfc(-mid / sqrt(2.0)) < p ? lo : hi) = mid;
+  }
+  return (lo + hi) / 2;
+}
+
+// Monte Carlo VaR of a synthetic book, dealt out as in valuebench, with
+// random volatilities and one correlation. Runs on every thread, then on
+// one, and checks the two reports are identical; the book's VaR is also
+// compared with the delta-normal estimate, which it should approach over
+// a short horizon.
+int CmdRiskBench(vector<string> args) {
+  long nAccounts = FlagLong(args, "--accounts", 10000);
+  long nSymbols = FlagLong(args, "--symbols", 100);
+  long nPositions = FlagLong(args, "--positions", 100000);
+  long scenarios = FlagLong(args, "--scenarios", 10000);
+  long threads = FlagLong(args, "--threads", 0);
+  long seed = FlagLong(args, "--seed", 1);
+  string corrText = "0.3";
+  FlagValue(args, "--correlation", &corrText);
+  double correlation = atof(corrText.c_str());
+  if (nAccounts <= 0 || nSymbols <= 0 || nPositions < 0 || scenarios <= 0 ||
+      threads < 0) {
+    fputs(kUsage, stderr);
+    return 2;
+  }
+  mt19937_64 rng(seed);
+  vector<string> symbols;
+  vector<double> prices, vols;
+  for (long s = 0; s < nSymbols; s++) {
+    symbols.push_back("S" + to_string(s));
+    prices.push_back(20.0 + rng() % 1000);
+    vols.push_back(0.2 + 0.4 * (rng() % 1000) / 1000.0);
+  }
+  Core::ValuationEngine book;
+  book.Reset(symbols);
+  for (long a = 0; a < nAccounts; a++)
+    book.AddAccount(to_string(90000000 + a), 0);
+  for (long i = 0; i < nPositions; i++)
+    book.AddPosition(i * nAccounts / max(nPositions, 1L), rng() % nSymbols,
+                     1 + (int)(rng() % 200), 0);
+  book.Finish();
+  Core::RiskConfig cfg;
+  cfg.seed = (uint64_t)seed;
+  cfg.scenarios = scenarios;
+  cfg.covariance = Core::UniformCovariance(vols, correlation);
+
+  Core::RiskReport reports[2];
+  double secs[2];
+  unsigned used = 1;
+  for (int run = 0; run < 2; run++) {
+    Core::WorkStealingPool pool(run == 0 ? (unsigned)threads : 1);
+    Core::RiskEngine engine(pool);
+    Clock::time_point t0 = Clock::now();
+    if (!engine.Run(book, prices.data(), cfg, &reports[run])) {
+      fprintf(stderr, "covariance is not positive definite\n");
+      return 1;
+    }
+    secs[run] = chrono::duration<double>(Clock::now() - t0).count();
+    if (run == 0) {
+      printf("parallel   %u threads: %ld scenarios x %ld positions in "
+             "%.3f s, %.2f ns/position scenario (%llu steals)\n",
+             pool.Threads(), scenarios, nPositions, secs[0],
+             secs[0] * 1e9 / scenarios / max(nPositions, 1L),
+             (unsigned long long)pool.Steals());
+      used = pool.Threads();
+    }
+  }
+  printf("single     %.3f s, speedup %.1fx\n", secs[1], secs[1] / secs[0]);
+  const Core::RiskReport &r = reports[0], &one = reports[1];
+  if (r.var != one.var || r.es != one.es || r.accountVar != one.accountVar ||
+      r.accountEs != one.accountEs) {
+    fprintf(stderr, "results depend on the thread count\n");
+    return 1;
+  }
+
+  // Delta-normal: losses ~ N(0, e' C e h) for exposures e.
+  vector<double> exposure(nSymbols);
+  for (size_t i = 0; i < book.Positions(); i++)
+    exposure[book.PositionSymbol(i)] +=
+        book.PositionQuantity(i) * prices[book.PositionSymbol(i)];
+  double variance = 0;
+  for (long i = 0; i < nSymbols; i++)
+    for (long j = 0; j < nSymbols; j++)
+      variance += exposure[i] * exposure[j] * cfg.covariance[i * nSymbols + j];
+  double sd = sqrt(variance * cfg.horizonYears);
+  double z = NormalQuantile(cfg.confidence);
+  double pdf = exp(-z * z / 2) / sqrt(2 * M_PI);
+  printf("book       VaR %.2f (delta-normal %.2f), ES %.2f (%.2f), %zu tail "
+         "scenarios\n",
+         r.var, z * sd, r.es, sd * pdf / (1 - cfg.confidence), r.tail);
+  double sumVar = 0;
+  for (double v : r.accountVar)
+    sumVar += v;
+  printf("accounts   sum of VaRs %.2f, diversification %.1f%%\n", sumVar,
+         100 * (1 - r.var / max(sumVar, 1e-9)));
+  printf("check      %u-thread run == 1-thread run; 100k scenarios x 1M "
+         "positions here: about %.0f s\n",
+         used, secs[0] * 1e11 / scenarios / max(nPositions, 1L));
+  return 0;
+}
+
+// VaR and expected shortfall of every account in the database over one
+// trading day, with the default market's symbols at one volatility and one
+// correlation. Lists the N riskiest accounts, then the book.
+int CmdRisk(Core::VaultDB &db, vector<string> args) {
+  long scenarios = FlagLong(args, "--scenarios", 10000);
+  long threads = FlagLong(args, "--threads", 0);
+  long seed = FlagLong(args, "--seed", 1);
+  long top = FlagLong(args, "--top", 20);
+  string confText = "0.99", volText = "0.45", corrText = "0.3";
+  FlagValue(args, "--confidence", &confText);
+  FlagValue(args, "--vol", &volText);
+  FlagValue(args, "--correlation", &corrText);
+  double confidence = atof(confText.c_str());
+  if (scenarios <= 0 || threads < 0 || !(confidence > 0 && confidence < 1)) {
+    fputs(kUsage, stderr);
+    return 2;
+  }
+  vector<Core::Stock> market = Core::DefaultMarket();
+  vector<string> symbols;
+  vector<double> prices;
+  for (auto &s : market) {
+    symbols.push_back(s.symbol);
+    prices.push_back(s.price);
+  }
+  Core::ValuationEngine book;
+  if (!book.Load(db, symbols)) {
+    fprintf(stderr, "cannot read positions\n");
+    return 1;
+  }
+  book.Value(prices.data());
+  Core::RiskConfig cfg;
+  cfg.seed = (uint64_t)seed;
+  cfg.scenarios = scenarios;
+  cfg.confidence = confidence;
+  cfg.covariance =
+      Core::UniformCovariance(vector<double>(symbols.size(),
+                                             atof(volText.c_str())),
+                              atof(corrText.c_str()));
+  Core::WorkStealingPool pool((unsigned)threads);
+  Core::RiskEngine engine(pool);
+  Core::RiskReport r;
+  if (!engine.Run(book, prices.data(), cfg, &r)) {
+    fprintf(stderr, "covariance is not positive definite\n");
+    return 1;
+  }
+  vector<size_t> order(book.Accounts());
+  for (size_t i = 0; i < order.size(); i++)
+    order[i] = i;
+  sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+    return r.accountVar[a] > r.accountVar[b];
+  });
+  if (top >= 0 && (size_t)top < order.size())
+    order.resize(top);
+  printf("%-10s %16s %16s %14s %14s\n", "account", "equity", "stocks", "VaR",
+         "ES");
+  for (size_t a : order)
+    printf("%-10s %16.2f %16.2f %14.2f %14.2f\n",
+           book.AccountNumber(a).c_str(), book.Equity()[a],
+           book.MarketValue()[a], r.accountVar[a], r.accountEs[a]);
+  printf("book: %zu accounts, %zu positions, %zu scenarios at %.1f%%: VaR "
+         "%.2f, ES %.2f\n",
+         book.Accounts(), book.Positions(), r.scenarios, 100 * confidence,
+         r.var, r.es);
+  return 0;
+}
+
+// The data side of painting the account grid: every paint runs
+// LoadAccounts and copies each name out, as the UI used to, or takes an
+// AccountDirectory snapshot and reads it in place. A deposit every N paints
+// moves the version, so some snapshots reload. Checks the final snapshot
+// against LoadAccounts.
+int CmdDirectoryBench(Core::VaultDB &db, vector<string> args) {
+  long nAccounts = FlagLong(args, "--accounts", 1000);
+  long paints = FlagLong(args, "--paints", 2000);
+  long every = FlagLong(args, "--every", 100);
+  if (nAccounts < 1 || paints <= 0 || every <= 0) {
+    fputs(kUsage, stderr);
+    return 2;
+  }
+  vector<string> nums, names;
+  SetupBenchAccounts(db, nAccounts, &nums, &names);
+  Core::Money one;
+  Core::Money::FromRupees(1, &one);
+
+  Core::AccountDirectory dir(db);
+  vector<double> load, snap;
+  size_t chars = 0;
+  for (int pass = 0; pass < 2; pass++)
+    for (long p = 0; p < paints; p++) {
+      if (p % every == every - 1)
+        db.Deposit(nums[p % nums.size()], one);
+      Clock::time_point t0 = Clock::now();
+      if (pass == 0) {
+        for (auto &a : db.LoadAccounts()) {
+          string name = a.name;
+          chars += name.size();
+        }
+      } else {
+        shared_ptr<const Core::AccountList> list = dir.Snapshot();
+        for (auto &a : list->accounts)
+          chars += a.name.size();
+      }
+      (pass == 0 ? load : snap)
+          .push_back(chrono::duration<double, nano>(Clock::now() - t0).count());
+    }
+  PrintNanos("load", load);
+  PrintNanos("snapshot", snap);
+  printf("reloads    %llu of %ld paints (%zu chars read)\n", dir.Reloads(),
+         paints, chars);
+
+  shared_ptr<const Core::AccountList> list = dir.Snapshot();
+  vector<Core::Account> fresh = db.LoadAccounts();
+  bool same = fresh.size() == list->accounts.size();
+  for (size_t i = 0; same && i < fresh.size(); i++)
+    same = fresh[i].accNum == list->accounts[i].accNum &&
+           fresh[i].balance == list->accounts[i].balance &&
+           list->Find(fresh[i].accNum) == &list->accounts[i];
+  if (!same) {
+    fprintf(stderr, "snapshot differs from LoadAccounts\n");
+    return 1;
+  }
+  printf("check      snapshot matches %zu accounts\n", fresh.size());
+  return 0;
+}
+
+// What a stock portal repaint costs in position lookups: one
+// GetOwnedStocks per row, as the portal used to do, against a
+// PortfolioSnapshot that is refreshed and marked per repaint, first with
+// nothing traded in between and then after a trade every repaint. Checks
+// the snapshot against the per-row queries.
+int CmdPortfolioBench(Core::VaultDB &db, vector<string> args) {
+  long repaints = FlagLong(args, "--repaints", 20000);
+  if (repaints <= 0) {
+    fputs(kUsage, stderr);
+    return 2;
+  }
+  vector<string> nums, names;
+  SetupBenchAccounts(db, 1, &nums, &names);
+  const string &acc = nums[0];
+  vector<Core::Stock> market = Core::DefaultMarket();
+  for (auto &s : market)
+    if (db.GetOwnedStocks(acc, s.symbol) == 0 && !Trade(db, acc, s, 1)) {
+      fprintf(stderr, "cannot open a position in %s\n", s.symbol.c_str());
+      return 1;
+    }
+
+  vector<double> perRow, idle, traded;
+  double pnl = 0;
+  for (long r = 0; r < repaints; r++) {
+    pnl = 0;
+    Clock::time_point t0 = Clock::now();
+    for (auto &s : market) {
+      double avg = 0;
+      int qty = db.GetOwnedStocks(acc, s.symbol, &avg);
+      pnl += (s.price - avg) * qty;
+    }
+    perRow.push_back(
+        chrono::duration<double, nano>(Clock::now() - t0).count());
+  }
+  Core::PortfolioSnapshot snap;
+  for (long r = 0; r < repaints; r++) {
+    Clock::time_point t0 = Clock::now();
+    snap.Refresh(db, acc);
+    snap.Mark(market);
+    idle.push_back(chrono::duration<double, nano>(Clock::now() - t0).count());
+  }
+  // The trade itself is not timed; the refresh after it runs the query.
+  long trades = min(repaints, 2000L);
+  for (long r = 0; r < trades; r++) {
+    Trade(db, acc, market[r % market.size()], r % 2 ? -1 : 1);
+    Clock::time_point t0 = Clock::now();
+    snap.Refresh(db, acc);
+    snap.Mark(market);
+    traded.push_back(
+        chrono::duration<double, nano>(Clock::now() - t0).count());
+  }
+  PrintNanos("per-row", perRow);
+  PrintNanos("snapshot", idle);
+  PrintNanos("after-trade", traded);
+
+  pnl = 0;
+  for (size_t i = 0; i < market.size(); i++) {
+    double avg = 0;
+    int qty = db.GetOwnedStocks(acc, market[i].symbol, &avg);
+    Core::PortfolioRow row = snap.Row(i);
+    pnl += (market[i].price - avg) * qty;
+    if (row.quantity != qty || row.avgPrice != avg) {
+      fprintf(stderr, "snapshot differs for %s\n", market[i].symbol.c_str());
+      return 1;
+    }
+  }
+  if (fabs(pnl - snap.Pnl()) > 1e-6) {
+    fprintf(stderr, "P&L differs: %.4f vs %.4f\n", pnl, snap.Pnl());
+    return 1;
+  }
+  printf("check      snapshot matches %zu positions, P&L %.2f\n",
+         market.size(), pnl);
+  return 0;
+}
+
+int CmdCasBench(const string &path, vector<string> args) {
+  long threads = FlagLong(args, "--threads", 4);
+  long trades = FlagLong(args, "--trades", 2000);
+  long seed = FlagLong(args, "--seed", 1);
+  if (threads <= 0 || trades <= 0) {
+    fputs(kUsage, stderr);
+    return 2;
+  }
+  // One connection per thread, all on the same account and symbol.
+  vector<unique_ptr<Core::VaultDB>> conns;
+  for (long t = 0; t < threads; t++) {
+    conns.emplace_back(new Core::VaultDB);
+    if (!conns.back()->Init(path)) {
+      fprintf(stderr, "cannot open %s\n", path.c_str());
+      return 1;
+    }
+  }
+  Core::VaultDB &db = *conns[0];
+  vector<string> nums, names;
+  SetupBenchAccounts(db, 1, &nums, &names);
+  const string acc = nums[0], symbol = "NVDA";
+  int before = db.GetOwnedStocks(acc, symbol);
+
+  struct Worker {
+    long applied = 0, failed = 0;
+    long long shares = 0;
+  };
+  vector<Worker> work(threads);
+  vector<thread> pool;
+  Clock::time_point t0 = Clock::now();
+  for (long t = 0; t < threads; t++)
+    pool.emplace_back([&, t] {
+      mt19937_64 rng(seed * 1000003 + t);
+      long mine = trades / threads + (t < trades % threads ? 1 : 0);
+      for (long i = 0; i < mine; i++) {
+        int qty = (int)(rng() % 9) - 3;
+        if (qty == 0)
+          qty = 1;
+        if (conns[t]->Trade(acc, symbol, qty, 100.0 + rng() % 50) == 0) {
+          work[t].applied++;
+          work[t].shares += qty;
+        } else {
+          work[t].failed++;
+        }
+      }
+    });
+  for (auto &th : pool)
+    th.join();
+  double wall = chrono::duration<double>(Clock::now() - t0).count();
+
+  long applied = 0, failed = 0;
+  long long shares = 0;
+  unsigned long long retries = 0;
+  for (long t = 0; t < threads; t++) {
+    applied += work[t].applied;
+    failed += work[t].failed;
+    shares += work[t].shares;
+    retries += conns[t]->GetCasRetries();
+  }
+  printf("trades     %ld threads, %ld applied, %ld refused in %.3f s "
+         "(%.0f ops/s)\n",
+         threads, applied, failed, wall, (applied + failed) / wall);
+  printf("cas        %llu retries (balance overwrites only)\n", retries);
+  int after = db.GetOwnedStocks(acc, symbol);
+  if (after != before + shares) {
+    fprintf(stderr, "lost update: position %d, expected %lld\n", after,
+            before + shares);
+    return 1;
+  }
+  Core::LedgerReport r;
+  if (!db.VerifyLedger(1, &r) || !r.Ok()) {
+    fprintf(stderr, "ledger does not match balances\n");
+    return 1;
+  }
+  printf("position   %d shares, consistent; ledger balanced\n", after);
+  return 0;
+}
+
+int CmdQueueBench(Core::VaultDB &db, vector<string> args) {
+  long producers = FlagLong(args, "--producers", 4);
+  long ops = FlagLong(args, "--ops", 100000);
+  long nAccounts = FlagLong(args, "--accounts", 1000);
+  long batch = FlagLong(args, "--batch", 256);
+  long seed = FlagLong(args, "--seed", 1);
+  if (producers <= 0 || ops <= 0 || nAccounts < 2 || batch <= 0) {
+    fputs(kUsage, stderr);
+    return 2;
+  }
+  vector<string> nums, names;
+  SetupBenchAccounts(db, nAccounts, &nums, &names);
+  Core::Money before, after;
+  if (!BenchTotal(db, nums, &before)) {
+    fprintf(stderr, "cannot read bench balances\n");
+    return 1;
+  }
+
+  // Each producer records the net cash its applied deposits and withdrawals
+  // moved; transfers must leave the total unchanged.
+  struct Producer {
+    thread t;
+    long failed = 0;
+    int64_t netPaise = 0;
+  };
+  vector<Producer> prod(producers);
+  Clock::time_point t0;
+  {
+    Core::CommandWriter writer(db, (size_t)batch);
+    t0 = Clock::now();
+    for (long p = 0; p < producers; p++) {
+      Producer &me = prod[p];
+      me.t = thread([&, p] {
+        mt19937_64 rng(seed * 1000003 + p);
+        long mine = ops / producers + (p < ops % producers ? 1 : 0);
+        vector<future<int>> pending;
+        vector<int64_t> delta;
+        pending.reserve(mine);
+        for (long i = 0; i < mine; i++) {
+          size_t a = rng() % nums.size(), b = rng() % nums.size();
+          if (b == a)
+            b = (b + 1) % nums.size();
+          Core::Money amt;
+          Core::Money::FromPaise((int64_t)(rng() % 100 + 1) * 100, &amt);
+          switch (rng() % 3) {
+          case 0:
+            pending.push_back(writer.Deposit(nums[a], amt));
+            delta.push_back(amt.Paise());
+            break;
+          case 1:
+            pending.push_back(writer.Withdraw(nums[a], amt));
+            delta.push_back(-amt.Paise());
+            break;
+          default:
+            pending.push_back(writer.Transfer(nums[a], nums[b], amt));
+            delta.push_back(0);
+          }
+        }
+        for (size_t i = 0; i < pending.size(); i++) {
+          if (pending[i].get() == 0)
+            me.netPaise += delta[i];
+          else
+            me.failed++;
+        }
+      });
+    }
+    for (auto &p : prod)
+      p.t.join();
+    writer.Stop();
+    double wall = chrono::duration<double>(Clock::now() - t0).count();
+    Core::CommandWriterStats ws = writer.Stats();
+    long failed = 0;
+    for (auto &p : prod)
+      failed += p.failed;
+    printf("queue      %ld producers, %llu commands (%ld failed) in %.3f s "
+           "(%.0f ops/s)\n",
+           producers, ws.commands, failed, wall, ws.commands / wall);
+    printf("batches    %llu (%.1f commands/batch)\n", ws.batches,
+           ws.batches ? (double)ws.commands / ws.batches : 0.0);
+  }
+
+  int64_t net = 0;
+  for (auto &p : prod)
+    net += p.netPaise;
+  if (!BenchTotal(db, nums, &after) || after.Paise() - before.Paise() != net) {
+    fprintf(stderr, "balance check failed: expected change %lld paise\n",
+            (long long)net);
+    return 1;
+  }
+  Core::Money change;
+  after.Sub(before, &change);
+  printf("balances   consistent (net change %s)\n", change.ToString().c_str());
+  return 0;
+}
+
+int CmdCacheBench(vector<string> args) {
+  long n = FlagLong(args, "--accounts", 1000000);
+  long lookups = FlagLong(args, "--lookups", 5000000);
+  long seed = FlagLong(args, "--seed", 1);
+  if (n <= 0 || n > 100000000 || lookups <= 0) {
+    fputs(kUsage, stderr);
+    return 2;
+  }
+
+  mt19937_64 rng(seed);
+  vector<string> nums;
+  nums.reserve(n);
+  for (long i = 0; i < n; i++) {
+    char num[16];
+    snprintf(num, sizeof num, "%08ld", (long)(rng() % 100000000));
+    nums.push_back(num);
+  }
+  vector<uint32_t> probes(lookups);
+  for (auto &p : probes)
+    p = (uint32_t)(rng() % n);
+  Core::Money bal;
+  Core::Money::FromRupees(1000, &bal);
+
+  Clock::time_point t0 = Clock::now();
+  map<string, EvaultApp::Account> tree;
+  for (long i = 0; i < n; i++)
+    tree[nums[i]] = EvaultApp::Account(nums[i], "bench", "0000", bal);
+  double treeBuild = chrono::duration<double>(Clock::now() - t0).count();
+
+  t0 = Clock::now();
+  Core::AccountTable<EvaultApp::Account> table;
+  for (long i = 0; i < n; i++) {
+    EvaultApp::Account a(nums[i], "bench", "0000", bal);
+    table.Insert(a.getPackedNumber(), a);
+  }
+  double tableBuild = chrono::duration<double>(Clock::now() - t0).count();
+
+  // Same probe sequence for both; the hit counts keep the loops honest.
+  size_t treeHits = 0, tableHits = 0;
+  t0 = Clock::now();
+  for (uint32_t p : probes) {
+    auto it = tree.find(nums[p]);
+    treeHits += it != tree.end() && it->second.getBalance().IsPositive();
+  }
+  double treeFind = chrono::duration<double>(Clock::now() - t0).count();
+  t0 = Clock::now();
+  for (uint32_t p : probes) {
+    uint32_t key;
+    Core::PackAccountNumber(nums[p], &key);
+    EvaultApp::Account *a = table.Find(key);
+    tableHits += a && a->getBalance().IsPositive();
+  }
+  double tableFind = chrono::duration<double>(Clock::now() - t0).count();
+
+  // Red-black node: three pointers and a colour word ahead of the pair.
+  size_t treeBytes =
+      tree.size() * (sizeof(pair<const string, EvaultApp::Account>) + 32);
+  if (treeHits != tableHits)
+    fprintf(stderr, "hit counts differ: %zu vs %zu\n", treeHits, tableHits);
+  printf("accounts   %zu distinct of %ld\n", table.Size(), n);
+  printf("std::map   build %7.1f ms  find %6.1f ns  ~%zu bytes\n",
+         treeBuild * 1e3, treeFind * 1e9 / lookups, treeBytes);
+  printf("flat table build %7.1f ms  find %6.1f ns  %zu bytes\n",
+         tableBuild * 1e3, tableFind * 1e9 / lookups, table.MemoryBytes());
+  return 0;
+}
+
+int CmdRefreshBench(const string &dbPath, vector<string> args) {
+  long n = FlagLong(args, "--accounts", 100000);
+  long rounds = FlagLong(args, "--rounds", 20);
+  long changes = FlagLong(args, "--changes", 10);
+  long seed = FlagLong(args, "--seed", 1);
+  if (n <= 0 || n > 10000000 || rounds <= 0 || changes < 0) {
+    fputs(kUsage, stderr);
+    return 2;
+  }
+
+  // The cache's Database opens first so a new file gets the
+  // account_number schema it reads; the writer then detects that schema.
+  EvaultApp::Database cache;
+  Core::VaultDB writer;
+  if (!cache.init(dbPath) || !writer.Init(dbPath)) {
+    fprintf(stderr, "cannot open %s\n", dbPath.c_str());
+    return 1;
+  }
+  vector<string> nums;
+  Core::Money opening, amt;
+  Core::Money::FromRupees(1000, &opening);
+  Core::Money::FromRupees(1, &amt);
+  Core::GroupCommitConfig gc;
+  gc.maxOps = 4096;
+  writer.GroupCommit().Enable(gc);
+  for (long i = 0; i < n; i++) {
+    char num[24], name[32];
+    snprintf(num, sizeof num, "%08ld", 90000000 + i);
+    snprintf(name, sizeof name, "bench-%06ld", i);
+    nums.push_back(num);
+    if (!cache.findAccount(num))
+      writer.CreateAccount(num, name, "0000", opening);
+  }
+  writer.GroupCommit().Disable();
+  cache.reloadAccounts();
+
+  mt19937_64 rng(seed);
+  double reloadUs = 0, refreshUs = 0, idleUs = 0;
+  size_t stale = 0;
+  for (long r = 0; r < rounds; r++) {
+    vector<string> touched;
+    for (long c = 0; c < changes; c++) {
+      touched.push_back(nums[rng() % n]);
+      writer.Deposit(touched.back(), amt);
+    }
+    Clock::time_point t0 = Clock::now();
+    cache.refreshAccounts();
+    refreshUs += chrono::duration<double, micro>(Clock::now() - t0).count();
+    for (auto &num : touched) {
+      Core::Money bal;
+      EvaultApp::Account *a = cache.findAccount(num);
+      if (!writer.GetBalance(num, &bal) || !a || a->getBalance() != bal)
+        stale++;
+    }
+
+    t0 = Clock::now();
+    cache.refreshAccounts();
+    idleUs += chrono::duration<double, micro>(Clock::now() - t0).count();
+
+    // What getAllAccounts() used to cost: a full reload plus a map copy.
+    t0 = Clock::now();
+    cache.reloadAccounts();
+    map<string, EvaultApp::Account> copy;
+    for (auto &a : cache.getAllAccounts())
+      copy.emplace(a.getAccountNumber(), a);
+    reloadUs += chrono::duration<double, micro>(Clock::now() - t0).count();
+  }
+
+  printf("accounts   %zu cached, %ld changed per round, %zu stale\n",
+         cache.getAllAccounts().Size(), changes, stale);
+  printf("reload     %10.1f us/round (full reload + copy)\n",
+         reloadUs / rounds);
+  printf("refresh    %10.1f us/round (after changes)\n", refreshUs / rounds);
+  printf("refresh    %10.1f us/round (nothing changed)\n", idleUs / rounds);
+  return stale ? 1 : 0;
+}
+
+int CmdHistoryBench(const string &dbPath, vector<string> args) {
+  long rows = FlagLong(args, "--rows", 200000);
+  long pageSize = FlagLong(args, "--page", 50);
+  if (rows < 0 || pageSize <= 0) {
+    fputs(kUsage, stderr);
+    return 2;
+  }
+  EvaultApp::Database hist;
+  if (!hist.init(dbPath)) {
+    fprintf(stderr, "cannot open %s\n", dbPath.c_str());
+    return 1;
+  }
+  const string heavy = "99999999", peer = "99999998";
+  Core::Money amt;
+  Core::Money::FromRupees(1, &amt);
+  if (!hist.findAccount(heavy)) {
+    hist.saveAccount(EvaultApp::Account(heavy, "history-bench", "0000", amt));
+    hist.saveAccount(EvaultApp::Account(peer, "history-peer", "0000", amt));
+  }
+  Clock::time_point t0 = Clock::now();
+  hist.beginTransaction();
+  for (long i = 0; i < rows; i++) {
+    // Interleave another account so the heavy one's rows are not contiguous.
+    hist.saveTransaction(EvaultApp::Transaction(
+        0, heavy, EvaultApp::TransactionType::TRANSFER_OUT, amt, peer));
+    hist.saveTransaction(EvaultApp::Transaction(
+        0, peer, EvaultApp::TransactionType::TRANSFER_IN, amt, heavy));
+  }
+  hist.commitTransaction();
+  printf("setup      %ld rows in %.1f ms\n", rows * 2,
+         chrono::duration<double, milli>(Clock::now() - t0).count());
+
+  const int kReps = 200;
+  t0 = Clock::now();
+  size_t got = 0;
+  for (int r = 0; r < kReps; r++) {
+    EvaultApp::HistoryCursor cur;
+    got += hist.getHistoryPage(heavy, pageSize, &cur).size();
+  }
+  double firstUs =
+      chrono::duration<double, micro>(Clock::now() - t0).count() / kReps;
+
+  // Walk half way with the streaming form, then time the page found there.
+  EvaultApp::HistoryCursor mid;
+  size_t total = 0;
+  hist.forEachTransaction(heavy, [&](const EvaultApp::Transaction &) {
+    return ++total < (size_t)rows / 2;
+  }, &mid);
+  t0 = Clock::now();
+  for (int r = 0; r < kReps; r++) {
+    EvaultApp::HistoryCursor cur = mid;
+    got += hist.getHistoryPage(heavy, pageSize, &cur).size();
+  }
+  double deepUs =
+      chrono::duration<double, micro>(Clock::now() - t0).count() / kReps;
+
+  t0 = Clock::now();
+  size_t all = hist.getHistory(heavy).size();
+  double fullUs = chrono::duration<double, micro>(Clock::now() - t0).count();
+
+  printf("history    %zu rows for %s (%zu paged)\n", all, heavy.c_str(), got);
+  printf("first page %10.1f us (%ld rows)\n", firstUs, pageSize);
+  printf("deep page  %10.1f us (%ld rows)\n", deepUs, pageSize);
+  printf("full read  %10.1f us\n", fullUs);
+  return 0;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  vector<string> args(argv + 1, argv + argc);
+  string dbPath = "evault.db";
+  FlagValue(args, "--db", &dbPath);
+  if (args.empty()) {
+    fputs(kUsage, stderr);
+    return 2;
+  }
+  if (args[0] == "marketbench")
+    return CmdMarketBench(vector<string>(args.begin() + 1, args.end()));
+  if (args[0] == "ringbench")
+    return CmdRingBench(vector<string>(args.begin() + 1, args.end()));
+  if (args[0] == "candlebench")
+    return CmdCandleBench(vector<string>(args.begin() + 1, args.end()));
+  if (args[0] == "indicatorbench")
+    return CmdIndicatorBench(vector<string>(args.begin() + 1, args.end()));
+  if (args[0] == "valuebench")
+    return CmdValueBench(vector<string>(args.begin() + 1, args.end()));
+  if (args[0] == "riskbench")
+    return CmdRiskBench(vector<string>(args.begin() + 1, args.end()));
+  if (args[0] == "cachebench")
+    return CmdCacheBench(vector<string>(args.begin() + 1, args.end()));
+  if (args[0] == "historybench")
+    return CmdHistoryBench(dbPath,
+                           vector<string>(args.begin() + 1, args.end()));
+  if (args[0] == "casbench")
+    return CmdCasBench(dbPath, vector<string>(args.begin() + 1, args.end()));
+  if (args[0] == "refreshbench")
+    return CmdRefreshBench(dbPath,
+                           vector<string>(args.begin() + 1, args.end()));
+
+  Core::VaultDB db;
+  if (!db.Init(dbPath)) {
+    fprintf(stderr, "cannot open %s\n", dbPath.c_str());
+    return 1;
+  }
+
+  string cmd = args[0];
+  args.erase(args.begin());
+  string key;
+  FlagValue(args, "--key", &key);
+  Core::Money amt;
+  if (cmd == "accounts")
+    return CmdAccounts(db);
+  if (cmd == "total")
+    return CmdTotal(db);
+  if (cmd == "create" && args.size() == 4)
+    return ParseMoney(args[3], &amt) &&
+                   db.CreateAccount(args[0], args[1], args[2], amt, nullptr,
+                                    key)
+               ? 0
+               : 1;
+  if (cmd == "deposit" && args.size() == 2)
+    return ParseMoney(args[1], &amt) && db.Deposit(args[0], amt, nullptr, key)
+               ? 0
+               : 1;
+  if (cmd == "withdraw" && args.size() == 2)
+    return ParseMoney(args[1], &amt) &&
+                   db.Withdraw(args[0], amt, nullptr, key)
+               ? 0
+               : 1;
+  if (cmd == "transfer" && args.size() == 3) {
+    if (!ParseMoney(args[2], &amt))
+      return 1;
+    int res = db.Transfer(args[0], args[1], amt, nullptr, key);
+    if (res != 0)
+      fprintf(stderr, "transfer failed: code %d\n", res);
+    return res;
+  }
+  if (cmd == "find" && args.size() == 1) {
+    vector<Core::Account> found = db.FindAccountsByName(args[0]);
+    for (auto &a : found)
+      printf("%s  %-24s %14s\n", a.accNum.c_str(), a.name.c_str(),
+             a.balance.ToString().c_str());
+    return found.empty() ? 1 : 0;
+  }
+  if (cmd == "trade" && args.size() == 3) {
+    vector<Core::Stock> market = Core::DefaultMarket();
+    int i = FindStock(market, args[1]);
+    if (i < 0) {
+      fprintf(stderr, "unknown symbol %s\n", args[1].c_str());
+      return 1;
+    }
+    return Trade(db, args[0], market[i], atoi(args[2].c_str()), key) ? 0 : 1;
+  }
+  if (cmd == "basket" && args.size() >= 2)
+    return CmdBasket(db, args, key);
+  if (cmd == "fills" && (args.size() == 1 || args.size() == 2)) {
+    for (auto &f : db.GetFills(args[0], args.size() == 2
+                                            ? strtoul(args[1].c_str(), 0, 10)
+                                            : 50))
+      printf("%-8lld %s  %-6s %6d @ %10s  %14s\n", (long long)f.id,
+             f.createdAt.c_str(), f.symbol.c_str(), f.quantity,
+             f.price.ToString().c_str(), f.amount.ToString().c_str());
+    return 0;
+  }
+  if (cmd == "settle" && args.size() == 1)
+    return CmdSettle(db, args[0]);
+  if (cmd == "verify")
+    return CmdVerify(db, args);
+  if (cmd == "value")
+    return CmdValue(db, args);
+  if (cmd == "risk")
+    return CmdRisk(db, args);
+  if (cmd == "bench")
+    return CmdBench(db, args);
+  if (cmd == "queuebench")
+    return CmdQueueBench(db, args);
+  if (cmd == "settlebench")
+    return CmdSettleBench(db, args);
+  if (cmd == "enginebench")
+    return CmdEngineBench(db, args);
+  if (cmd == "keybench")
+    return CmdKeyBench(db, args);
+  if (cmd == "basketbench")
+    return CmdBasketBench(db, args);
+  if (cmd == "bookbench")
+    return CmdBookBench(db, args);
+  if (cmd == "portfoliobench")
+    return CmdPortfolioBench(db, args);
+  if (cmd == "directorybench")
+    return CmdDirectoryBench(db, args);
+
+  fputs(kUsage, stderr);
+  return 2;
+}
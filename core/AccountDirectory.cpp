@@ -0,0 +1,37 @@
+#include "AccountDirectory.h"
+
+#include <algorithm>
+
+using namespace std;
+
+namespace Core {
+
+const Account *AccountList::Find(const string &accNum) const {
+  auto it = lower_bound(byNumber.begin(), byNumber.end(), accNum,
+                        [&](uint32_t i, const string &num) {
+                          return accounts[i].accNum < num;
+                        });
+  return it != byNumber.end() && accounts[*it].accNum == accNum
+             ? &accounts[*it]
+             : nullptr;
+}
+
+shared_ptr<const AccountList> AccountDirectory::Snapshot() {
+  uint64_t version = db.AccountsVersion();
+  if (current && current->version == version)
+    return current;
+  auto list = make_shared<AccountList>();
+  list->version = version;
+  list->accounts = db.LoadAccounts();
+  list->byNumber.resize(list->accounts.size());
+  for (size_t i = 0; i < list->byNumber.size(); i++)
+    list->byNumber[i] = (uint32_t)i;
+  const vector<Account> &accs = list->accounts;
+  sort(list->byNumber.begin(), list->byNumber.end(),
+       [&](uint32_t a, uint32_t b) { return accs[a].accNum < accs[b].accNum; });
+  current = move(list);
+  reloads++;
+  return current;
+}
+
+} // namespace Core
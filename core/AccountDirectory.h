@@ -0,0 +1,44 @@
+#pragma once
+
+#include "VaultDB.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace Core {
+
+// Every account as of one AccountsVersion. Never modified once handed out,
+// so it can be held and read from any thread for as long as needed.
+struct AccountList {
+  uint64_t version;
+  std::vector<Account> accounts; // in LoadAccounts order
+  std::vector<uint32_t> byNumber; // indices into accounts, by accNum
+
+  // The account numbered accNum, or null.
+  const Account *Find(const std::string &accNum) const;
+};
+
+// The accounts table as the UI reads it. Snapshot() costs a counter
+// comparison while VaultDB::AccountsVersion stands still and reloads the
+// whole list with one LoadAccounts when it has moved, so painting and
+// hit-testing never query per call. Use on the VaultDB's thread; the
+// snapshots themselves may go anywhere.
+class AccountDirectory {
+  VaultDB &db;
+  std::shared_ptr<const AccountList> current;
+  unsigned long long reloads = 0;
+
+public:
+  explicit AccountDirectory(VaultDB &vault) : db(vault) {}
+
+  std::shared_ptr<const AccountList> Snapshot();
+  // Forces the next Snapshot to reload, e.g. after another connection
+  // wrote accounts.
+  void Invalidate() { current.reset(); }
+  unsigned long long Reloads() const { return reloads; }
+};
+
+} // namespace Core
@@ -0,0 +1,187 @@
+#include "AccountEngine.h"
+
+#include <algorithm>
+#include <chrono>
+
+using namespace std;
+
+namespace Core {
+
+namespace {
+// Longest wait between attempts at a batch the database keeps failing.
+const unsigned kMaxBackoffMillis = 1000;
+// Attempts Drain() makes at such a batch before leaving it unwritten.
+const int kDrainAttempts = 8;
+} // namespace
+
+AccountEngine::AccountEngine(VaultDB &vault, size_t count)
+    : db(vault), shards(new Shard[count ? count : 1]),
+      shardCount(count ? count : 1) {}
+
+AccountEngine::~AccountEngine() { Stop(); }
+
+bool AccountEngine::Load() {
+  vector<Account> accs = db.LoadAccounts();
+  index.Clear();
+  index.Reserve(accs.size());
+  balances.reset(new atomic<int64_t>[accs.size()]);
+  accountCount = 0;
+  for (const Account &a : accs) {
+    uint32_t packed;
+    if (!PackAccountNumber(a.accNum, &packed) || index.Find(packed))
+      continue;
+    balances[accountCount].store(a.balance.Paise(), memory_order_relaxed);
+    index.Insert(packed, (uint32_t)accountCount++);
+  }
+  return true;
+}
+
+const uint32_t *AccountEngine::Slot(const string &num) const {
+  uint32_t packed;
+  return PackAccountNumber(num, &packed) ? index.Find(packed) : nullptr;
+}
+
+bool AccountEngine::GetBalance(const string &num, Money *balance) const {
+  const uint32_t *slot = Slot(num);
+  return slot &&
+         Money::FromPaise(balances[*slot].load(memory_order_acquire), balance);
+}
+
+int AccountEngine::Transfer(const string &from, const string &toAccNum,
+                            Money amount) {
+  if (!amount.IsPositive())
+    return 5;
+  if (toAccNum == from)
+    return 2;
+  const uint32_t *to = Slot(toAccNum);
+  if (!to)
+    return 4;
+  const uint32_t *src = Slot(from);
+  if (!src)
+    return 3;
+
+  size_t a = *src % shardCount, b = *to % shardCount;
+  unique_lock<mutex> first(shards[a < b ? a : b].lock);
+  unique_lock<mutex> second;
+  if (a != b)
+    second = unique_lock<mutex>(shards[a < b ? b : a].lock);
+
+  // Only lock holders write these, so relaxed loads see the latest value.
+  Money fromBal, toBal, credited, debited;
+  Money::FromPaise(balances[*src].load(memory_order_relaxed), &fromBal);
+  Money::FromPaise(balances[*to].load(memory_order_relaxed), &toBal);
+  if (!toBal.Add(amount, &credited))
+    return 4;
+  if (fromBal < amount || !fromBal.Sub(amount, &debited))
+    return 3;
+  balances[*to].store(credited.Paise(), memory_order_release);
+  balances[*src].store(debited.Paise(), memory_order_release);
+  // Queued under the locks, so transfers touching the same account are
+  // persisted in the order they were applied.
+  TransferRequest r;
+  r.from = from;
+  r.to = toAccNum;
+  r.amount = amount;
+  pending.Push(move(r));
+  applied.fetch_add(1, memory_order_release);
+  return 0;
+}
+
+// Writes everything queued so far and returns how many transfers that was;
+// 0 also when the database failed the batch, which is then kept for the
+// next call. Only one thread at a time: the persister, or the caller of
+// Stop()/Flush() when there is none.
+size_t AccountEngine::Persist() {
+  vector<TransferRequest> batch;
+  batch.swap(unwritten);
+  TransferRequest r;
+  while (pending.Pop(&r))
+    batch.push_back(move(r));
+  if (batch.empty())
+    return 0;
+  vector<int> results;
+  if (!db.TransferBatch(batch, &results)) {
+    unwritten = move(batch);
+    failures++;
+    lock_guard<mutex> guard(persistLock);
+    retries++;
+    return 0;
+  }
+  failures = 0;
+  size_t refused = 0;
+  for (int res : results)
+    if (res >= 2 && res <= 5)
+      refused++;
+  lock_guard<mutex> guard(persistLock);
+  persisted += batch.size();
+  batches++;
+  diverged += refused;
+  persistedCv.notify_all();
+  return batch.size();
+}
+
+// The flush interval, doubled for each failed attempt in a row.
+chrono::milliseconds AccountEngine::Backoff() const {
+  unsigned long long wait = (unsigned long long)flushMillis
+                            << min(failures, 10u);
+  return chrono::milliseconds(min(wait, (unsigned long long)kMaxBackoffMillis));
+}
+
+void AccountEngine::Drain() {
+  for (int failed = 0; failed < kDrainAttempts;) {
+    if (Persist())
+      continue;
+    if (unwritten.empty())
+      return;
+    failed++;
+    this_thread::sleep_for(Backoff());
+  }
+}
+
+void AccountEngine::Run() {
+  unique_lock<mutex> guard(persistLock);
+  while (!stopping) {
+    wake.wait_for(guard, Backoff());
+    guard.unlock();
+    Persist();
+    guard.lock();
+  }
+}
+
+void AccountEngine::Start(unsigned intervalMillis) {
+  if (persister.joinable())
+    return;
+  flushMillis = intervalMillis ? intervalMillis : 1;
+  stopping = false;
+  persister = thread(&AccountEngine::Run, this);
+}
+
+void AccountEngine::Stop() {
+  if (persister.joinable()) {
+    {
+      lock_guard<mutex> guard(persistLock);
+      stopping = true;
+      wake.notify_one();
+    }
+    persister.join();
+  }
+  Drain();
+}
+
+void AccountEngine::Flush() {
+  unsigned long long target = applied.load(memory_order_acquire);
+  if (!persister.joinable()) {
+    Drain();
+    return;
+  }
+  unique_lock<mutex> guard(persistLock);
+  wake.notify_one();
+  persistedCv.wait(guard, [&] { return persisted >= target; });
+}
+
+AccountEngineStats AccountEngine::Stats() {
+  lock_guard<mutex> guard(persistLock);
+  return {applied.load(), persisted, batches, diverged, retries};
+}
+
+} // namespace Core
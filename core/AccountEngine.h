@@ -0,0 +1,105 @@
+#pragma once
+
+#include "AccountTable.h"
+#include "Money.h"
+#include "MpscQueue.h"
+#include "VaultDB.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace Core {
+
+struct AccountEngineStats {
+  unsigned long long transfers; // applied in memory
+  unsigned long long persisted; // written to the database
+  unsigned long long batches;   // TransferBatch calls made by the persister
+  unsigned long long diverged;  // replayed transfers the database refused
+  unsigned long long retries;   // flushes that failed whole and were retried
+};
+
+// In-memory balances for every account in a VaultDB, safe to use from any
+// number of threads. Accounts are spread over lock shards; a transfer locks
+// the shards of its two accounts (lower index first, so two transfers in
+// opposite directions cannot deadlock) and transfers between accounts in
+// different shards run in parallel. Balance reads take no lock.
+//
+// Applied transfers are queued, in the order they took effect, for a
+// persister thread that replays them through VaultDB::TransferBatch, so
+// each flush writes one UPDATE per dirty account plus the ledger entries.
+// While the engine is running it owns the VaultDB: nothing else may use it.
+// The account set is fixed at Load(); open accounts through VaultDB and
+// reload.
+class AccountEngine {
+  // One lock per shard, each on its own cache line.
+  struct alignas(64) Shard {
+    std::mutex lock;
+  };
+
+  VaultDB &db;
+  AccountTable<uint32_t> index; // packed number -> slot
+  std::unique_ptr<std::atomic<int64_t>[]> balances; // paise, by slot
+  size_t accountCount = 0;
+  std::unique_ptr<Shard[]> shards;
+  size_t shardCount;
+
+  MpscQueue<TransferRequest> pending;
+  // A batch the database failed as a whole, written ahead of anything
+  // queued after it, and how many attempts in a row have failed. Only the
+  // persisting thread touches these.
+  std::vector<TransferRequest> unwritten;
+  unsigned failures = 0;
+  std::atomic<unsigned long long> applied{0};
+  unsigned long long persisted = 0, batches = 0, diverged = 0, retries = 0;
+  std::mutex persistLock; // guards the counters above and Flush waits
+  std::condition_variable persistedCv, wake;
+  bool stopping = false;
+  unsigned flushMillis = 5;
+  std::thread persister;
+
+  const uint32_t *Slot(const std::string &num) const;
+  size_t Persist();
+  std::chrono::milliseconds Backoff() const;
+  void Drain();
+  void Run();
+
+public:
+  explicit AccountEngine(VaultDB &vault, size_t shardCount = 64);
+  // Stops the persister; see Stop().
+  ~AccountEngine();
+  AccountEngine(const AccountEngine &) = delete;
+  AccountEngine &operator=(const AccountEngine &) = delete;
+
+  // Reads every account from the vault. Call before Start().
+  bool Load();
+  // Starts the persister, which flushes every intervalMillis.
+  void Start(unsigned intervalMillis = 5);
+  // Joins the persister, then writes everything queued. A batch the
+  // database keeps failing is given a few more attempts and then left
+  // unwritten: Stats().persisted stays below Stats().transfers.
+  void Stop();
+  // Blocks until every transfer applied before the call has been written,
+  // however long the database keeps failing; without a persister it gives
+  // up as Stop() does.
+  void Flush();
+
+  // Codes as VaultDB::Transfer. 6 is never returned: a transfer the
+  // database later refuses (2-5) is counted in Stats().diverged, and a
+  // flush the database fails as a whole is retried with backoff.
+  int Transfer(const std::string &from, const std::string &toAccNum,
+               Money amount);
+  bool GetBalance(const std::string &num, Money *balance) const;
+
+  size_t Size() const { return accountCount; }
+  AccountEngineStats Stats();
+};
+
+} // namespace Core
@@ -0,0 +1,28 @@
+#include "AccountTable.h"
+
+#include <cstdio>
+
+using namespace std;
+
+namespace Core {
+
+bool PackAccountNumber(const string &num, uint32_t *packed) {
+  if (num.size() != 8)
+    return false;
+  uint32_t v = 0;
+  for (char c : num) {
+    if (c < '0' || c > '9')
+      return false;
+    v = v * 10 + (uint32_t)(c - '0');
+  }
+  *packed = v;
+  return true;
+}
+
+string UnpackAccountNumber(uint32_t packed) {
+  char buf[16];
+  snprintf(buf, sizeof buf, "%08u", (unsigned)packed);
+  return buf;
+}
+
+} // namespace Core
@@ -0,0 +1,146 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace Core {
+
+// Account numbers are eight decimal digits, so they fit in 27 bits.
+// kNoAccount never results from packing.
+const uint32_t kNoAccount = 0xFFFFFFFFu;
+
+// "00012345" -> 12345. False unless num is exactly eight ASCII digits.
+bool PackAccountNumber(const std::string &num, uint32_t *packed);
+// 12345 -> "00012345".
+std::string UnpackAccountNumber(uint32_t packed);
+
+// Open-addressing map from packed account number to T. The slot array holds
+// only (key, index) pairs and is probed linearly; values sit in fixed-size
+// chunks in insertion order, so a pointer returned by Find or Insert stays
+// valid as the table grows, until Clear().
+template <class T> class AccountTable {
+  struct Slot {
+    uint32_t key;   // kNoAccount when empty
+    uint32_t index; // into the value chunks
+  };
+  static const size_t kChunkBits = 10;
+  static const size_t kChunk = size_t(1) << kChunkBits;
+
+  std::vector<Slot> slots;
+  std::vector<std::unique_ptr<T[]>> chunks;
+  size_t count = 0;
+  unsigned shift = 32;
+
+  T &At(size_t i) { return chunks[i >> kChunkBits][i & (kChunk - 1)]; }
+  const T &At(size_t i) const {
+    return chunks[i >> kChunkBits][i & (kChunk - 1)];
+  }
+  // Fibonacci hashing: the top bits of key * 2^32/phi.
+  size_t Home(uint32_t key) const {
+    return (uint32_t)(key * 2654435769u) >> shift;
+  }
+
+  void Rehash(size_t capacity) {
+    unsigned bits = 4;
+    while ((size_t(1) << bits) < capacity)
+      bits++;
+    std::vector<Slot> old;
+    old.swap(slots);
+    slots.assign(size_t(1) << bits, Slot{kNoAccount, 0});
+    shift = 32 - bits;
+    size_t mask = slots.size() - 1;
+    for (const Slot &s : old)
+      if (s.key != kNoAccount) {
+        size_t i = Home(s.key);
+        while (slots[i].key != kNoAccount)
+          i = (i + 1) & mask;
+        slots[i] = s;
+      }
+  }
+
+public:
+  AccountTable() {}
+  AccountTable(const AccountTable &) = delete;
+  AccountTable &operator=(const AccountTable &) = delete;
+
+  size_t Size() const { return count; }
+  size_t MemoryBytes() const {
+    return slots.size() * sizeof(Slot) + chunks.size() * kChunk * sizeof(T);
+  }
+
+  // Sizes the slot array for n values at no more than 3/4 load.
+  void Reserve(size_t n) {
+    if (n * 4 > slots.size() * 3)
+      Rehash(n * 4 / 3 + 1);
+  }
+
+  void Clear() {
+    for (Slot &s : slots)
+      s.key = kNoAccount;
+    chunks.clear();
+    count = 0;
+  }
+
+  T *Find(uint32_t key) {
+    if (slots.empty())
+      return nullptr;
+    size_t mask = slots.size() - 1;
+    for (size_t i = Home(key);; i = (i + 1) & mask) {
+      if (slots[i].key == key)
+        return &At(slots[i].index);
+      if (slots[i].key == kNoAccount)
+        return nullptr;
+    }
+  }
+  const T *Find(uint32_t key) const {
+    return const_cast<AccountTable *>(this)->Find(key);
+  }
+
+  // Stores value under key, replacing any existing one. Null for kNoAccount.
+  T *Insert(uint32_t key, const T &value) {
+    if (key == kNoAccount)
+      return nullptr;
+    Reserve(count + 1);
+    size_t mask = slots.size() - 1;
+    size_t i = Home(key);
+    for (; slots[i].key != kNoAccount; i = (i + 1) & mask)
+      if (slots[i].key == key)
+        return &(At(slots[i].index) = value);
+    if ((count >> kChunkBits) == chunks.size())
+      chunks.emplace_back(new T[kChunk]);
+    slots[i] = Slot{key, (uint32_t)count};
+    T &slot = At(count++);
+    slot = value;
+    return &slot;
+  }
+
+  // Visits values in insertion order.
+  template <class F> void ForEach(F f) const {
+    for (size_t i = 0; i < count; i++)
+      f(At(i));
+  }
+
+  // Read-only iteration in insertion order.
+  class const_iterator {
+    const AccountTable *table;
+    size_t i;
+
+  public:
+    const_iterator(const AccountTable *t, size_t index) : table(t), i(index) {}
+    const T &operator*() const { return table->At(i); }
+    const T *operator->() const { return &table->At(i); }
+    const_iterator &operator++() {
+      i++;
+      return *this;
+    }
+    bool operator==(const const_iterator &o) const { return i == o.i; }
+    bool operator!=(const const_iterator &o) const { return i != o.i; }
+  };
+  const_iterator begin() const { return const_iterator(this, 0); }
+  const_iterator end() const { return const_iterator(this, count); }
+};
+
+} // namespace Core
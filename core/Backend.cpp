@@ -0,0 +1,632 @@
+#include "Backend.h"
+
+#include "Schema.h"
+#include "StringPool.h"
+
+#include <cstdlib>
+#include <ctime>
+#include <sqlite3.h>
+
+using namespace std;
+
+namespace EvaultApp {
+
+namespace {
+// Attempts at a compare-and-swap balance write before giving up.
+const int kCasRetries = 16;
+} // namespace
+
+const char *internAccountString(const string &s) {
+  static Core::StringPool pool;
+  return pool.Intern(s);
+}
+
+void Database::initializeDatabase() {
+  if (!db)
+    return;
+  Core::MigrateMoneyColumns(db);
+  sqlite3_exec(db,
+               "CREATE TABLE IF NOT EXISTS accounts (account_number TEXT "
+               "PRIMARY KEY, holder_name TEXT, pin TEXT, balance INTEGER NOT "
+               "NULL DEFAULT 0, created_at DATETIME DEFAULT "
+               "CURRENT_TIMESTAMP);",
+               0, 0, 0);
+  sqlite3_exec(
+      db,
+      "CREATE TABLE IF NOT EXISTS transactions (id INTEGER PRIMARY KEY "
+      "AUTOINCREMENT, account_number TEXT, type TEXT, amount INTEGER NOT NULL "
+      "DEFAULT 0, target_account TEXT, timestamp DATETIME DEFAULT "
+      "CURRENT_TIMESTAMP);",
+      0, 0, 0);
+  sqlite3_exec(db,
+               "CREATE INDEX IF NOT EXISTS idx_transactions_account_id ON "
+               "transactions(account_number, id);",
+               0, 0, 0);
+  Core::EnsureAccountVersions(db);
+  Core::EnsureRowVersions(db);
+
+  sqlite3_stmt *stmt;
+  if (sqlite3_prepare_v2(db,
+                         "SELECT COALESCE(MAX(id), 0) + 1 FROM transactions;",
+                         -1, &stmt, 0) == SQLITE_OK) {
+    if (sqlite3_step(stmt) == SQLITE_ROW)
+      nextTransactionId = sqlite3_column_int(stmt, 0);
+    sqlite3_finalize(stmt);
+  }
+}
+
+string Database::generateAccountNumber() {
+  static bool seeded = false;
+  if (!seeded) {
+    srand(time(NULL));
+    seeded = true;
+  }
+  uint32_t packed;
+  do {
+    packed = 0;
+    for (int i = 0; i < 8; i++)
+      packed = packed * 10 + rand() % 10;
+  } while (accountsCache.Find(packed));
+  return Core::UnpackAccountNumber(packed);
+}
+
+bool Database::init(const string &filename) {
+  if (sqlite3_open(filename.c_str(), &db) == SQLITE_OK) {
+    Core::EnableWal(db);
+    committer.Attach(db);
+    initializeDatabase();
+    ledger.Attach(db, "SELECT account_number, balance FROM accounts;");
+    keys.Attach(db);
+    reloadAccounts();
+    return true;
+  }
+  return false;
+}
+
+Database::~Database() {
+  committer.Detach();
+  keys.Detach();
+  ledger.Detach();
+  if (db)
+    sqlite3_close(db);
+}
+
+// The cache is updated as soon as a write succeeds; if its group commit
+// batch later rolls back, resynchronise it from disk and forget the key.
+void Database::finishOp(bool ok, const Core::DurableCallback &onDurable,
+                        const string &idempotencyKey) {
+  if (!ok || !committer.Enabled()) {
+    committer.EndOp(ok, onDurable);
+    return;
+  }
+  committer.EndOp(ok, [this, onDurable, idempotencyKey](bool durable) {
+    if (!durable) {
+      reloadAccounts();
+      keys.Forget(idempotencyKey);
+    }
+    if (onDurable)
+      onDurable(durable);
+  });
+}
+
+// Runs body in its own savepoint, undoing its writes unless it succeeds.
+bool Database::inSavepoint(const function<bool()> &body) {
+  if (sqlite3_exec(db, "SAVEPOINT op;", 0, 0, 0) != SQLITE_OK)
+    return false;
+  bool ok = body();
+  if (!ok)
+    sqlite3_exec(db, "ROLLBACK TO op;", 0, 0, 0);
+  if (sqlite3_exec(db, "RELEASE op;", 0, 0, 0) != SQLITE_OK && ok) {
+    sqlite3_exec(db, "ROLLBACK TO op;", 0, 0, 0);
+    sqlite3_exec(db, "RELEASE op;", 0, 0, 0);
+    ok = false;
+  }
+  return ok;
+}
+
+// The stored balance of accNum and, if asked, its row version; false if
+// there is no such row.
+bool Database::readBalance(const string &accNum, Core::Money *balance,
+                           int64_t *version) {
+  sqlite3_stmt *s;
+  if (sqlite3_prepare_v2(db,
+                         "SELECT balance, version FROM accounts WHERE "
+                         "account_number=?;",
+                         -1, &s, 0) != SQLITE_OK)
+    return false;
+  sqlite3_bind_text(s, 1, accNum.c_str(), -1, SQLITE_TRANSIENT);
+  bool found = sqlite3_step(s) == SQLITE_ROW &&
+               Core::Money::FromPaise(sqlite3_column_int64(s, 0), balance);
+  if (found && version)
+    *version = sqlite3_column_int64(s, 1);
+  sqlite3_finalize(s);
+  return found;
+}
+
+// Overwrites acc's stored balance and books the difference from what was
+// there as an adjustment against equity. As in VaultDB::UpdateBalance, the
+// balance is only replaced if its version is still the one read; otherwise
+// the difference is recomputed. False for an unknown account.
+bool Database::storeBalance(const Account &acc) {
+  string num = acc.getAccountNumber();
+  for (int attempt = 0; attempt < kCasRetries; attempt++) {
+    Core::Money old, delta;
+    int64_t version;
+    if (!readBalance(num, &old, &version) ||
+        !acc.getBalance().Sub(old, &delta))
+      return false;
+    if (delta == Core::Money())
+      return true;
+    bool lost = false;
+    bool ok = inSavepoint([&] {
+      sqlite3_stmt *s;
+      if (sqlite3_prepare_v2(db,
+                             "UPDATE accounts SET balance=?, version = "
+                             "version + 1 WHERE account_number=? AND "
+                             "version=?;",
+                             -1, &s, 0) != SQLITE_OK)
+        return false;
+      sqlite3_bind_int64(s, 1, acc.getBalance().Paise());
+      sqlite3_bind_text(s, 2, num.c_str(), -1, SQLITE_TRANSIENT);
+      sqlite3_bind_int64(s, 3, version);
+      bool written = sqlite3_step(s) == SQLITE_DONE;
+      sqlite3_finalize(s);
+      if (written && sqlite3_changes(db) == 0) {
+        lost = true; // lost the race; re-read
+        return false;
+      }
+      Core::Posting legs[2] = {{num, delta},
+                               {Core::Ledger::kEquity, delta.Negated()}};
+      return written && ledger.Post("ADJUSTMENT", legs, 2);
+    });
+    if (!lost)
+      return ok;
+    casRetries++;
+  }
+  return false;
+}
+
+// Adds amount to, or takes it from, the stored balance in one statement, so
+// a write made since the cache was filled is kept. Touches no row, and
+// returns false, when the account is missing, short, or would overflow.
+bool Database::moveBalance(const string &accNum, Core::Money amount,
+                           bool credit) {
+  sqlite3_stmt *s;
+  if (sqlite3_prepare_v2(
+          db,
+          credit ? "UPDATE accounts SET balance = balance + ?, version = "
+                   "version + 1 WHERE account_number = ? AND balance <= "
+                   "9007199254740991 - ?;"
+                 : "UPDATE accounts SET balance = balance - ?, version = "
+                   "version + 1 WHERE account_number = ? AND balance >= ?;",
+          -1, &s, 0) != SQLITE_OK)
+    return false;
+  sqlite3_bind_int64(s, 1, amount.Paise());
+  sqlite3_bind_text(s, 2, accNum.c_str(), -1, SQLITE_TRANSIENT);
+  sqlite3_bind_int64(s, 3, amount.Paise());
+  bool ok = sqlite3_step(s) == SQLITE_DONE && sqlite3_changes(db) == 1;
+  sqlite3_finalize(s);
+  return ok;
+}
+
+// Re-reads one account's row into the cache.
+void Database::reloadAccount(const string &accNum) {
+  sqlite3_stmt *s;
+  if (sqlite3_prepare_v2(db,
+                         "SELECT account_number, holder_name, pin, balance "
+                         "FROM accounts WHERE account_number=?;",
+                         -1, &s, 0) != SQLITE_OK)
+    return;
+  sqlite3_bind_text(s, 1, accNum.c_str(), -1, SQLITE_TRANSIENT);
+  if (sqlite3_step(s) == SQLITE_ROW) {
+    const char *name = (const char *)sqlite3_column_text(s, 1);
+    const char *pin = (const char *)sqlite3_column_text(s, 2);
+    Core::Money bal;
+    Core::Money::FromPaise(sqlite3_column_int64(s, 3), &bal);
+    Account acc(accNum, name ? name : "", pin ? pin : "", bal);
+    accountsCache.Insert(acc.getPackedNumber(), acc);
+  }
+  sqlite3_finalize(s);
+}
+
+bool Database::saveAccount(const Account &acc,
+                           const Core::DurableCallback &onDurable,
+                           const string &idempotencyKey) {
+  if (!db || acc.getPackedNumber() == Core::kNoAccount ||
+      !committer.BeginOp()) {
+    finishOp(false, onDurable);
+    return false;
+  }
+  int res = keys.Run(
+      idempotencyKey,
+      [&] {
+        bool ok = inSavepoint([&] {
+          sqlite3_stmt *s;
+          sqlite3_prepare_v2(db,
+                             "INSERT INTO accounts (account_number, "
+                             "holder_name, pin, balance) VALUES(?,?,?,?);",
+                             -1, &s, 0);
+          sqlite3_bind_text(s, 1, acc.getAccountNumber().c_str(), -1,
+                            SQLITE_TRANSIENT);
+          sqlite3_bind_text(s, 2, acc.getHolderName().c_str(), -1,
+                            SQLITE_TRANSIENT);
+          sqlite3_bind_text(s, 3, acc.getPin().c_str(), -1,
+                            SQLITE_TRANSIENT);
+          sqlite3_bind_int64(s, 4, acc.getBalance().Paise());
+          bool inserted = (sqlite3_step(s) == SQLITE_DONE);
+          sqlite3_finalize(s);
+          Core::Money bal = acc.getBalance();
+          Core::Posting legs[2] = {{acc.getAccountNumber(), bal},
+                                   {Core::Ledger::kEquity, bal.Negated()}};
+          return inserted &&
+                 (bal == Core::Money() || ledger.Post("OPENING", legs, 2));
+        });
+        if (ok)
+          accountsCache.Insert(acc.getPackedNumber(), acc);
+        return ok ? 0 : 6;
+      },
+      [this] { reloadAccounts(); });
+  finishOp(res == 0, onDurable, idempotencyKey);
+  return res == 0;
+}
+
+bool Database::updateAccount(const Account &acc,
+                             const Core::DurableCallback &onDurable,
+                             const string &idempotencyKey) {
+  if (!db || !committer.BeginOp()) {
+    finishOp(false, onDurable);
+    return false;
+  }
+  int res = keys.Run(
+      idempotencyKey,
+      [&] {
+        bool ok = storeBalance(acc);
+        if (ok)
+          accountsCache.Insert(acc.getPackedNumber(), acc);
+        return ok ? 0 : 6;
+      },
+      [this] { reloadAccounts(); });
+  finishOp(res == 0, onDurable, idempotencyKey);
+  return res == 0;
+}
+
+Account *Database::findAccount(const string &accNum) {
+  uint32_t packed;
+  if (!Core::PackAccountNumber(accNum, &packed))
+    return nullptr;
+  return accountsCache.Find(packed);
+}
+
+int64_t Database::readDataVersion() {
+  int64_t v = -1;
+  sqlite3_stmt *stmt;
+  if (sqlite3_prepare_v2(db, "PRAGMA data_version;", -1, &stmt, 0) ==
+      SQLITE_OK) {
+    if (sqlite3_step(stmt) == SQLITE_ROW)
+      v = sqlite3_column_int64(stmt, 0);
+    sqlite3_finalize(stmt);
+  }
+  return v;
+}
+
+// Rows whose number is not eight digits cannot be cached and are skipped;
+// this class never creates them.
+void Database::reloadAccounts() {
+  accountsCache.Clear();
+  // Versions are read before the rows, so a commit racing with the scan is
+  // applied again by the next refresh rather than missed.
+  syncedDataVersion = readDataVersion();
+  syncedRowVersion = 0;
+  sqlite3_stmt *stmt;
+  if (sqlite3_prepare_v2(
+          db, "SELECT COALESCE(MAX(row_version), 0) FROM account_versions;",
+          -1, &stmt, 0) == SQLITE_OK) {
+    if (sqlite3_step(stmt) == SQLITE_ROW)
+      syncedRowVersion = sqlite3_column_int64(stmt, 0);
+    sqlite3_finalize(stmt);
+  }
+  sqlite3_prepare_v2(db, "SELECT * FROM accounts;", -1, &stmt, 0);
+  while (sqlite3_step(stmt) == SQLITE_ROW) {
+    const char *num = (const char *)sqlite3_column_text(stmt, 0);
+    const char *name = (const char *)sqlite3_column_text(stmt, 1);
+    const char *pin = (const char *)sqlite3_column_text(stmt, 2);
+    Core::Money bal;
+    Core::Money::FromPaise(sqlite3_column_int64(stmt, 3), &bal);
+    Account acc(num ? num : "", name ? name : "", pin ? pin : "", bal);
+    accountsCache.Insert(acc.getPackedNumber(), acc);
+  }
+  sqlite3_finalize(stmt);
+}
+
+void Database::refreshAccounts() {
+  if (!db)
+    return;
+  // data_version only moves for other connections' commits; our own writes
+  // update the cache as they happen.
+  int64_t dataVersion = readDataVersion();
+  if (dataVersion == syncedDataVersion)
+    return;
+  sqlite3_stmt *stmt;
+  if (sqlite3_prepare_v2(db,
+                         "SELECT v.row_version, a.account_number, "
+                         "a.holder_name, a.pin, a.balance FROM "
+                         "account_versions v LEFT JOIN accounts a ON "
+                         "a.account_number = v.account_number WHERE "
+                         "v.row_version > ? ORDER BY v.row_version;",
+                         -1, &stmt, 0) != SQLITE_OK) {
+    reloadAccounts();
+    return;
+  }
+  sqlite3_bind_int64(stmt, 1, syncedRowVersion);
+  bool deleted = false;
+  while (sqlite3_step(stmt) == SQLITE_ROW) {
+    syncedRowVersion = sqlite3_column_int64(stmt, 0);
+    const char *num = (const char *)sqlite3_column_text(stmt, 1);
+    const char *name = (const char *)sqlite3_column_text(stmt, 2);
+    const char *pin = (const char *)sqlite3_column_text(stmt, 3);
+    if (!num) {
+      deleted = true;
+      continue;
+    }
+    Core::Money bal;
+    Core::Money::FromPaise(sqlite3_column_int64(stmt, 4), &bal);
+    Account acc(num, name ? name : "", pin ? pin : "", bal);
+    accountsCache.Insert(acc.getPackedNumber(), acc);
+  }
+  sqlite3_finalize(stmt);
+  syncedDataVersion = dataVersion;
+  if (deleted)
+    reloadAccounts();
+}
+
+const Core::AccountTable<Account> &Database::getAllAccounts() {
+  refreshAccounts();
+  return accountsCache;
+}
+
+bool Database::saveTransaction(const Transaction &t,
+                               const Core::DurableCallback &onDurable,
+                               const string &idempotencyKey) {
+  if (!db || !committer.BeginOp()) {
+    finishOp(false, onDurable);
+    return false;
+  }
+  int res = keys.Run(idempotencyKey, [&] {
+    sqlite3_stmt *s;
+    sqlite3_prepare_v2(db,
+                       "INSERT INTO transactions (account_number, type, "
+                       "amount, target_account) VALUES (?,?,?,?);",
+                       -1, &s, 0);
+    sqlite3_bind_text(s, 1, t.accountNumber.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_text(s, 2, t.getTypeString().c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_int64(s, 3, t.amount.Paise());
+    sqlite3_bind_text(s, 4, t.targetAccount.c_str(), -1, SQLITE_TRANSIENT);
+    bool ok = (sqlite3_step(s) == SQLITE_DONE);
+    sqlite3_finalize(s);
+    if (ok)
+      nextTransactionId++;
+    return ok ? 0 : 6;
+  });
+  finishOp(res == 0, onDurable, idempotencyKey);
+  return res == 0;
+}
+
+namespace {
+Transaction readTransaction(sqlite3_stmt *stmt, const string &accNum) {
+  int id = sqlite3_column_int(stmt, 0);
+  const char *type = (const char *)sqlite3_column_text(stmt, 1);
+  string typeStr = type ? type : "";
+  Core::Money amt;
+  Core::Money::FromPaise(sqlite3_column_int64(stmt, 2), &amt);
+  const char *tgt = (const char *)sqlite3_column_text(stmt, 3);
+  const char *tgtName = (const char *)sqlite3_column_text(stmt, 4);
+  TransactionType tType = TransactionType::DEPOSIT;
+  if (typeStr == "WITHDRAW")
+    tType = TransactionType::WITHDRAW;
+  else if (typeStr == "TRANSFER IN")
+    tType = TransactionType::TRANSFER_IN;
+  else if (typeStr == "TRANSFER OUT")
+    tType = TransactionType::TRANSFER_OUT;
+  return Transaction(id, accNum, tType, amt, tgt ? tgt : "",
+                     tgtName ? tgtName : "Unknown");
+}
+} // namespace
+
+size_t Database::forEachTransaction(
+    const string &accNum, const function<bool(const Transaction &)> &fn,
+    HistoryCursor *cursor) {
+  HistoryCursor start;
+  if (!cursor)
+    cursor = &start;
+  if (!db || cursor->done)
+    return 0;
+  sqlite3_stmt *stmt;
+  if (sqlite3_prepare_v2(
+          db,
+          "SELECT t.id, t.type, t.amount, t.target_account, a.holder_name "
+          "FROM transactions t "
+          "LEFT JOIN accounts a ON t.target_account = a.account_number "
+          "WHERE t.account_number = ? AND t.id < ? ORDER BY t.id DESC;",
+          -1, &stmt, 0) != SQLITE_OK)
+    return 0;
+  sqlite3_bind_text(stmt, 1, accNum.c_str(), -1, SQLITE_TRANSIENT);
+  sqlite3_bind_int64(stmt, 2, cursor->beforeId);
+  size_t n = 0;
+  bool more = true;
+  while (more && sqlite3_step(stmt) == SQLITE_ROW) {
+    cursor->beforeId = sqlite3_column_int64(stmt, 0);
+    n++;
+    more = fn(readTransaction(stmt, accNum));
+  }
+  if (more)
+    cursor->done = true;
+  sqlite3_finalize(stmt);
+  return n;
+}
+
+vector<Transaction> Database::getHistoryPage(const string &accNum,
+                                             size_t pageSize,
+                                             HistoryCursor *cursor) {
+  vector<Transaction> page;
+  if (!db || !cursor || cursor->done || pageSize == 0)
+    return page;
+  sqlite3_stmt *stmt;
+  if (sqlite3_prepare_v2(
+          db,
+          "SELECT t.id, t.type, t.amount, t.target_account, a.holder_name "
+          "FROM transactions t "
+          "LEFT JOIN accounts a ON t.target_account = a.account_number "
+          "WHERE t.account_number = ? AND t.id < ? ORDER BY t.id DESC "
+          "LIMIT ?;",
+          -1, &stmt, 0) != SQLITE_OK)
+    return page;
+  sqlite3_bind_text(stmt, 1, accNum.c_str(), -1, SQLITE_TRANSIENT);
+  sqlite3_bind_int64(stmt, 2, cursor->beforeId);
+  sqlite3_bind_int64(stmt, 3, (sqlite3_int64)pageSize);
+  page.reserve(pageSize);
+  while (sqlite3_step(stmt) == SQLITE_ROW) {
+    cursor->beforeId = sqlite3_column_int64(stmt, 0);
+    page.push_back(readTransaction(stmt, accNum));
+  }
+  sqlite3_finalize(stmt);
+  if (page.size() < pageSize)
+    cursor->done = true;
+  return page;
+}
+
+vector<Transaction> Database::getHistory(const string &accNum) {
+  vector<Transaction> h;
+  forEachTransaction(accNum, [&](const Transaction &t) {
+    h.push_back(t);
+    return true;
+  });
+  return h;
+}
+
+bool Database::beginTransaction() {
+  return committer.BeginOp() &&
+         sqlite3_exec(db, "SAVEPOINT txn;", 0, 0, 0) == SQLITE_OK;
+}
+bool Database::commitTransaction(const Core::DurableCallback &onDurable) {
+  bool ok = sqlite3_exec(db, "RELEASE txn;", 0, 0, 0) == SQLITE_OK;
+  finishOp(ok, onDurable);
+  return ok;
+}
+bool Database::rollbackTransaction() {
+  bool ok = sqlite3_exec(db, "ROLLBACK TO txn;", 0, 0, 0) == SQLITE_OK &&
+            sqlite3_exec(db, "RELEASE txn;", 0, 0, 0) == SQLITE_OK;
+  committer.EndOp(false, nullptr);
+  return ok;
+}
+
+bool Database::BeginBatch() {
+  batchKeys.clear();
+  return db && committer.Flush() &&
+         sqlite3_exec(db, "BEGIN IMMEDIATE;", 0, 0, 0) == SQLITE_OK;
+}
+
+bool Database::CommitBatch() {
+  if (sqlite3_exec(db, "COMMIT;", 0, 0, 0) == SQLITE_OK)
+    return true;
+  sqlite3_exec(db, "ROLLBACK;", 0, 0, 0);
+  reloadAccounts();
+  for (auto &key : batchKeys)
+    keys.Forget(key);
+  return false;
+}
+
+int Database::Apply(const Core::Command &cmd) {
+  if (!cmd.key.empty())
+    batchKeys.push_back(cmd.key);
+  return keys.Run(
+      cmd.key, [&] { return applyCommand(cmd); },
+      [this] { reloadAccounts(); });
+}
+
+int Database::applyCommand(const Core::Command &cmd) {
+  if (cmd.kind == Core::Command::TRADE)
+    return 7;
+  if (!findAccount(cmd.account))
+    return 4;
+  if (!cmd.amount.IsPositive())
+    return 5;
+  if (cmd.kind == Core::Command::TRANSFER) {
+    if (!findAccount(cmd.target))
+      return 4;
+    if (cmd.target == cmd.account)
+      return 2;
+  }
+
+  // Balances move relative to the stored rows, never to the cached copies,
+  // which another connection may have overtaken; the ledger gets the same
+  // entries VaultDB posts for these operations, for exactly what moved.
+  Core::Money scratch;
+  Core::Posting legs[2];
+  const char *kind;
+  if (!beginTransaction())
+    return 6;
+  int res = 0;
+  if (cmd.kind == Core::Command::DEPOSIT) {
+    kind = "DEPOSIT";
+    legs[0] = {cmd.account, cmd.amount};
+    legs[1] = {Core::Ledger::kCash, cmd.amount.Negated()};
+    if (!moveBalance(cmd.account, cmd.amount, true))
+      res = readBalance(cmd.account, &scratch) ? 5 : 4;
+  } else {
+    kind = cmd.kind == Core::Command::WITHDRAW ? "WITHDRAW" : "TRANSFER";
+    legs[0] = {cmd.account, cmd.amount.Negated()};
+    legs[1] = {cmd.kind == Core::Command::WITHDRAW ? Core::Ledger::kCash
+                                                   : cmd.target,
+               cmd.amount};
+    // Crediting first reports a missing recipient even when the sender is
+    // also short, as VaultDB::Transfer does.
+    if (cmd.kind == Core::Command::TRANSFER &&
+        !moveBalance(cmd.target, cmd.amount, true))
+      res = readBalance(cmd.target, &scratch) ? 5 : 4;
+    else if (!moveBalance(cmd.account, cmd.amount, false))
+      res = readBalance(cmd.account, &scratch) ? 3 : 4;
+  }
+  if (res == 0 && !ledger.Post(kind, legs, 2))
+    res = 6;
+
+  bool ok = res == 0;
+  if (cmd.kind == Core::Command::DEPOSIT)
+    ok = ok && saveTransaction(Transaction(nextTransactionId, cmd.account,
+                                           TransactionType::DEPOSIT,
+                                           cmd.amount));
+  else if (cmd.kind == Core::Command::WITHDRAW)
+    ok = ok && saveTransaction(Transaction(nextTransactionId, cmd.account,
+                                           TransactionType::WITHDRAW,
+                                           cmd.amount));
+  else
+    ok = ok &&
+         saveTransaction(Transaction(nextTransactionId, cmd.account,
+                                     TransactionType::TRANSFER_OUT,
+                                     cmd.amount, cmd.target)) &&
+         saveTransaction(Transaction(nextTransactionId, cmd.target,
+                                     TransactionType::TRANSFER_IN,
+                                     cmd.amount, cmd.account));
+  if (!ok || !commitTransaction()) {
+    rollbackTransaction();
+    if (res == 0)
+      res = 6;
+  }
+  // Whatever happened, the cache now shows the rows as they are.
+  reloadAccount(cmd.account);
+  if (cmd.kind == Core::Command::TRANSFER)
+    reloadAccount(cmd.target);
+  return res;
+}
+
+Database db;
+Account *currentUser = nullptr;
+
+bool Login(string u, string p) {
+  db.refreshAccounts();
+  Account *acc = db.findAccount(u);
+  if (acc && acc->verifyPin(p))
+    return currentUser = acc, true;
+  return false;
+}
+
+} // namespace EvaultApp
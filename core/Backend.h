@@ -0,0 +1,226 @@
+#pragma once
+
+#include "AccountTable.h"
+#include "CommandQueue.h"
+#include "GroupCommit.h"
+#include "Idempotency.h"
+#include "Ledger.h"
+#include "Money.h"
+
+#include <cstdint>
+#include <ctime>
+#include <functional>
+#include <string>
+#include <vector>
+
+struct sqlite3;
+
+namespace EvaultApp {
+
+enum class TransactionType { DEPOSIT, WITHDRAW, TRANSFER_IN, TRANSFER_OUT };
+
+class Transaction {
+public:
+  int transactionId;
+  std::string accountNumber;
+  TransactionType type;
+  Core::Money amount;
+  time_t timestamp;
+  std::string targetAccount;
+  std::string targetName;
+
+  Transaction(int id, const std::string &accNum, TransactionType t,
+              Core::Money amt, const std::string &target = "",
+              const std::string &tName = "")
+      : transactionId(id), accountNumber(accNum), type(t), amount(amt),
+        timestamp(time(nullptr)), targetAccount(target), targetName(tName) {}
+
+  std::string getTypeString() const {
+    switch (type) {
+    case TransactionType::DEPOSIT:
+      return "DEPOSIT";
+    case TransactionType::WITHDRAW:
+      return "WITHDRAW";
+    case TransactionType::TRANSFER_IN:
+      return "TRANSFER IN";
+    case TransactionType::TRANSFER_OUT:
+      return "TRANSFER OUT";
+    default:
+      return "UNKNOWN";
+    }
+  }
+};
+
+// Returns the shared copy of s; see Core::StringPool.
+const char *internAccountString(const std::string &s);
+
+// 32 bytes: the number is packed and names/PINs are interned, since many
+// accounts share a PIN and cached copies never change them.
+class Account {
+private:
+  uint32_t accountNumber = Core::kNoAccount;
+  const char *holderName = "";
+  const char *pin = "";
+  Core::Money balance;
+
+public:
+  Account() {}
+  // An accNum that is not eight digits leaves getPackedNumber() at
+  // Core::kNoAccount, and Database refuses to store the account.
+  Account(const std::string &accNum, const std::string &name,
+          const std::string &pinCode, Core::Money initialBalance)
+      : holderName(internAccountString(name)),
+        pin(internAccountString(pinCode)), balance(initialBalance) {
+    Core::PackAccountNumber(accNum, &accountNumber);
+  }
+
+  uint32_t getPackedNumber() const { return accountNumber; }
+  std::string getAccountNumber() const {
+    return Core::UnpackAccountNumber(accountNumber);
+  }
+  std::string getHolderName() const { return holderName; }
+  std::string getPin() const { return pin; }
+  Core::Money getBalance() const { return balance; }
+
+  bool deposit(Core::Money amount) {
+    if (!amount.IsPositive())
+      return false;
+    return balance.Add(amount, &balance);
+  }
+
+  bool withdraw(Core::Money amount) {
+    if (!amount.IsPositive() || amount > balance)
+      return false;
+    return balance.Sub(amount, &balance);
+  }
+
+  bool verifyPin(const std::string &inputPin) const { return inputPin == pin; }
+};
+
+// Position in an account's history, which is read newest first. A
+// default-constructed cursor starts at the newest transaction.
+struct HistoryCursor {
+  int64_t beforeId = INT64_MAX; // next page holds ids below this
+  bool done = false;            // set once a short page has been returned
+};
+
+class Database : public Core::CommandSink {
+private:
+  sqlite3 *db;
+  Core::AccountTable<Account> accountsCache;
+  int nextTransactionId;
+  Core::GroupCommitter committer;
+  Core::IdempotencyStore keys;
+  // The same journal VaultDB keeps. Every balance write posts the amount
+  // that actually moved on the row: commands move balances relative to the
+  // stored value and overwrites book their difference from it, so writes
+  // from either class leave VaultDB::VerifyLedger passing.
+  Core::Ledger ledger;
+  std::vector<std::string> batchKeys; // recorded since BeginBatch
+  // What the cache has seen: the connection's data_version and the highest
+  // account_versions.row_version applied.
+  int64_t syncedDataVersion = -1;
+  int64_t syncedRowVersion = 0;
+  unsigned long long casRetries = 0;
+
+  void initializeDatabase();
+  int64_t readDataVersion();
+  std::string generateAccountNumber();
+  int applyCommand(const Core::Command &cmd);
+  bool inSavepoint(const std::function<bool()> &body);
+  bool readBalance(const std::string &accNum, Core::Money *balance,
+                   int64_t *version = nullptr);
+  bool storeBalance(const Account &acc);
+  bool moveBalance(const std::string &accNum, Core::Money amount,
+                   bool credit);
+  void reloadAccount(const std::string &accNum);
+  void finishOp(bool ok, const Core::DurableCallback &onDurable,
+                const std::string &idempotencyKey = "");
+
+public:
+  Database() : db(nullptr), nextTransactionId(1) {}
+  ~Database() override;
+  Database(const Database &) = delete;
+  Database &operator=(const Database &) = delete;
+
+  // Opens (or creates) the database in WAL mode.
+  bool init(const std::string &filename);
+  // Off by default; see Core::GroupCommitter. Writes take an optional
+  // callback that fires once the change is durable or has been rolled back.
+  Core::GroupCommitter &groupCommit() { return committer; }
+
+  std::string createNewAccountNumber() { return generateAccountNumber(); }
+  // Balance overwrites that lost to another writer and were retried.
+  unsigned long long getCasRetries() const { return casRetries; }
+
+  // Writes take an optional client idempotency key: repeating a key that
+  // succeeded inside the window returns true without writing again. See
+  // Core::IdempotencyStore. Balances are posted to the ledger: an opening
+  // entry for a new account, and updateAccount books the change from the
+  // stored balance as an adjustment against equity. That balance is
+  // compared-and-swapped on its row version, so a concurrent write is
+  // never overwritten unbooked.
+  bool saveAccount(const Account &acc,
+                   const Core::DurableCallback &onDurable = nullptr,
+                   const std::string &idempotencyKey = "");
+  bool updateAccount(const Account &acc,
+                     const Core::DurableCallback &onDurable = nullptr,
+                     const std::string &idempotencyKey = "");
+  // One hash probe; null for unknown or malformed numbers. The pointer stays
+  // valid until the next reloadAccounts().
+  Account *findAccount(const std::string &accNum);
+  // Rebuilds the cache from scratch, invalidating Account pointers.
+  void reloadAccounts();
+  // Picks up changes committed by other connections: a no-op unless the
+  // database's data_version moved, then only rows stamped after the last
+  // sync are re-read and updated in place. Falls back to reloadAccounts()
+  // if an account was deleted.
+  void refreshAccounts();
+  // Refreshes, then exposes the cache itself; iterate it rather than
+  // copying. Order is insertion order, not account number.
+  const Core::AccountTable<Account> &getAllAccounts();
+
+  bool saveTransaction(const Transaction &t,
+                       const Core::DurableCallback &onDurable = nullptr,
+                       const std::string &idempotencyKey = "");
+  // Whole history, newest first. Prefer the paged or streaming forms for
+  // busy accounts.
+  std::vector<Transaction> getHistory(const std::string &accNum);
+  // Up to pageSize transactions older than the cursor, newest first, and
+  // advances the cursor. Each page is a range scan on
+  // transactions(account_number, id), so its cost does not depend on how
+  // deep into the history it starts or on how long the history is.
+  std::vector<Transaction> getHistoryPage(const std::string &accNum,
+                                          size_t pageSize,
+                                          HistoryCursor *cursor);
+  // Streams the history newest first without materialising it; stops early
+  // when fn returns false. Returns the number of rows visited.
+  size_t forEachTransaction(const std::string &accNum,
+                            const std::function<bool(const Transaction &)> &fn,
+                            HistoryCursor *cursor = nullptr);
+
+  int getNextTId() { return nextTransactionId; }
+
+  // Savepoint-based, so an explicit transaction nests inside a group commit
+  // batch and counts as one operation in it.
+  bool beginTransaction();
+  bool commitTransaction(const Core::DurableCallback &onDurable = nullptr);
+  bool rollbackTransaction();
+
+  // Core::CommandSink, for driving the database from a Core::CommandWriter.
+  // Each command moves the stored balances by its amount, keeping writes
+  // other connections made since the cache was filled, re-reads the
+  // accounts it touched into the cache and records its transaction rows
+  // like the interactive paths do. Honours Command::key. There is no
+  // portfolio here, so trades complete with 7.
+  bool BeginBatch() override;
+  int Apply(const Core::Command &cmd) override;
+  bool CommitBatch() override;
+};
+
+extern Database db;
+extern Account *currentUser;
+
+bool Login(std::string u, std::string p);
+
+} // namespace EvaultApp
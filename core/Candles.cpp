@@ -0,0 +1,318 @@
+#include "Candles.h"
+
+#include <algorithm>
+#include <cstring>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+namespace Core {
+
+namespace {
+
+const unsigned char kMagic[4] = {'E', 'V', 'C', 'S'};
+const uint32_t kVersion = 1;
+const unsigned char kTickRecord = 'T', kCandleRecord = 'C';
+const size_t kTickSize = 21, kCandleSize = 41;
+
+// Offset just past the last whole record of a store positioned after its
+// header: where a reader stops, so where the next append must go.
+long EndOfRecords(FILE *f) {
+  long end = ftell(f);
+  fseek(f, 0, SEEK_END);
+  long size = ftell(f);
+  for (;;) {
+    fseek(f, end, SEEK_SET);
+    int type = fgetc(f);
+    long n = type == kTickRecord     ? (long)kTickSize
+             : type == kCandleRecord ? (long)kCandleSize
+                                     : 0;
+    if (n == 0 || end + n > size)
+      return end;
+    end += n;
+  }
+}
+
+bool Truncate(FILE *f, long size) {
+  fflush(f);
+#ifdef _WIN32
+  return _chsize_s(_fileno(f), size) == 0;
+#else
+  return ftruncate(fileno(f), size) == 0;
+#endif
+}
+
+// Start of the period-long bucket holding t; floors for negative t too.
+int64_t BucketStart(int64_t t, int64_t period) {
+  int64_t r = t % period;
+  return t - (r < 0 ? r + period : r);
+}
+
+unsigned char *Put32(unsigned char *p, uint32_t v) {
+  for (int i = 0; i < 4; i++)
+    *p++ = (unsigned char)(v >> (8 * i));
+  return p;
+}
+unsigned char *Put64(unsigned char *p, uint64_t v) {
+  for (int i = 0; i < 8; i++)
+    *p++ = (unsigned char)(v >> (8 * i));
+  return p;
+}
+unsigned char *PutFloat(unsigned char *p, float f) {
+  uint32_t v;
+  memcpy(&v, &f, 4);
+  return Put32(p, v);
+}
+
+const unsigned char *Get32(const unsigned char *p, uint32_t *v) {
+  *v = 0;
+  for (int i = 0; i < 4; i++)
+    *v |= (uint32_t)p[i] << (8 * i);
+  return p + 4;
+}
+const unsigned char *Get64(const unsigned char *p, uint64_t *v) {
+  *v = 0;
+  for (int i = 0; i < 8; i++)
+    *v |= (uint64_t)p[i] << (8 * i);
+  return p + 8;
+}
+const unsigned char *GetFloat(const unsigned char *p, float *f) {
+  uint32_t v;
+  p = Get32(p, &v);
+  memcpy(f, &v, 4);
+  return p;
+}
+
+} // namespace
+
+CandleAggregator::CandleAggregator(size_t symbols, const CandleConfig &config)
+    : cfg(config), symbolCount(symbols),
+      forming(symbols * config.periodsMillis.size(), Candle()),
+      closed(symbols * config.periodsMillis.size(),
+             RingBuffer<Candle, false>(config.depth ? config.depth - 1 : 0)) {
+}
+
+void CandleAggregator::Fold(size_t symbol, int64_t timeMillis, float price,
+                            float volume) {
+  size_t periods = cfg.periodsMillis.size(), at = symbol * periods;
+  Candle *c = &forming[at];
+  for (size_t p = 0; p < periods; p++, c++) {
+    int64_t period = cfg.periodsMillis[p];
+    if (c->ticks && timeMillis < c->start + period) {
+      c->high = max(c->high, price);
+      c->low = min(c->low, price);
+      c->close = price;
+      c->volume += volume;
+      c->ticks++;
+      continue;
+    }
+    if (c->ticks) {
+      if (sink)
+        sink->AppendCandle((uint32_t)symbol, period, *c);
+      closed[at + p].Push(*c);
+    }
+    *c = Candle{BucketStart(timeMillis, period), price, price, price, price,
+                volume, 1};
+  }
+}
+
+void CandleAggregator::OnTick(size_t symbol, int64_t timeMillis, double price,
+                              double volume) {
+  if (symbol >= symbolCount)
+    return;
+  if (sink)
+    sink->AppendTick((uint32_t)symbol, timeMillis, (float)price,
+                     (float)volume);
+  Fold(symbol, timeMillis, (float)price, (float)volume);
+}
+
+void CandleAggregator::OnTicks(int64_t timeMillis, const double *prices,
+                               size_t n, const double *volumes) {
+  n = min(n, symbolCount);
+  for (size_t i = 0; i < n; i++)
+    OnTick(i, timeMillis, prices[i], volumes ? volumes[i] : 0);
+}
+
+// Appends the closed bars of series at from index first on, then the
+// forming bar.
+size_t CandleAggregator::Collect(size_t at, size_t first,
+                                 vector<Candle> *out) const {
+  const RingBuffer<Candle, false> &ring = closed[at];
+  for (size_t i = first; i < ring.Size(); i++)
+    out->push_back(ring[i]);
+  if (forming[at].ticks)
+    out->push_back(forming[at]);
+  return out->size();
+}
+
+size_t CandleAggregator::Window(size_t symbol, size_t period, size_t count,
+                                vector<Candle> *out) const {
+  out->clear();
+  if (symbol >= symbolCount || period >= Periods() || count == 0)
+    return 0;
+  size_t at = symbol * Periods() + period;
+  size_t held = closed[at].Size() + (forming[at].ticks ? 1 : 0);
+  size_t n = min(count, held);
+  out->reserve(n);
+  return Collect(at, held - n, out);
+}
+
+size_t CandleAggregator::Range(size_t symbol, size_t period, int64_t from,
+                               int64_t to, vector<Candle> *out) const {
+  out->clear();
+  if (symbol >= symbolCount || period >= Periods())
+    return 0;
+  size_t at = symbol * Periods() + period;
+  const RingBuffer<Candle, false> &ring = closed[at];
+  // Bars are in start order, so the first at or after from is a bisection.
+  size_t lo = 0, hi = ring.Size();
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (ring[mid].start < from)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  for (size_t i = lo; i < ring.Size() && ring[i].start < to; i++)
+    out->push_back(ring[i]);
+  const Candle &c = forming[at];
+  if (c.ticks && c.start >= from && c.start < to)
+    out->push_back(c);
+  return out->size();
+}
+
+CandleStore::~CandleStore() { Close(); }
+
+bool CandleStore::Open(const string &path) {
+  Close();
+  f = fopen(path.c_str(), "r+b");
+  if (!f) {
+    f = fopen(path.c_str(), "w+b");
+    if (!f)
+      return false;
+  }
+  setvbuf(f, nullptr, _IOFBF, 1 << 20);
+  fseek(f, 0, SEEK_END);
+  unsigned char header[8];
+  if (ftell(f) == 0) {
+    memcpy(header, kMagic, 4);
+    Put32(header + 4, kVersion);
+    if (fwrite(header, 1, 8, f) == 8)
+      return true;
+  } else {
+    uint32_t version;
+    fseek(f, 0, SEEK_SET);
+    if (fread(header, 1, 8, f) == 8 && memcmp(header, kMagic, 4) == 0 &&
+        (Get32(header + 4, &version), version == kVersion)) {
+      // A crash may have left a record half written; appending after it
+      // would put every later record out of step for readers.
+      long end = EndOfRecords(f);
+      fseek(f, 0, SEEK_END);
+      if (ftell(f) == end || Truncate(f, end)) {
+        fseek(f, end, SEEK_SET);
+        return true;
+      }
+    }
+  }
+  Close();
+  return false;
+}
+
+bool CandleStore::Flush() { return f && fflush(f) == 0; }
+
+void CandleStore::Close() {
+  if (f)
+    fclose(f);
+  f = nullptr;
+}
+
+bool CandleStore::Write(const unsigned char *rec, size_t n) {
+  return f && fwrite(rec, 1, n, f) == n;
+}
+
+bool CandleStore::AppendTick(uint32_t symbol, int64_t timeMillis, float price,
+                             float volume) {
+  unsigned char rec[kTickSize], *p = rec;
+  *p++ = kTickRecord;
+  p = Put32(p, symbol);
+  p = Put64(p, (uint64_t)timeMillis);
+  p = PutFloat(p, price);
+  PutFloat(p, volume);
+  return Write(rec, sizeof rec);
+}
+
+bool CandleStore::AppendCandle(uint32_t symbol, int64_t periodMillis,
+                               const Candle &c) {
+  unsigned char rec[kCandleSize], *p = rec;
+  *p++ = kCandleRecord;
+  p = Put32(p, symbol);
+  p = Put32(p, (uint32_t)periodMillis);
+  p = Put64(p, (uint64_t)c.start);
+  p = PutFloat(p, c.open);
+  p = PutFloat(p, c.high);
+  p = PutFloat(p, c.low);
+  p = PutFloat(p, c.close);
+  p = PutFloat(p, c.volume);
+  Put32(p, c.ticks);
+  return Write(rec, sizeof rec);
+}
+
+bool CandleStore::Read(
+    const string &path,
+    const function<void(uint32_t, int64_t, float, float)> &onTick,
+    const function<void(uint32_t, int64_t, const Candle &)> &onCandle) {
+  FILE *in = fopen(path.c_str(), "rb");
+  if (!in)
+    return false;
+  setvbuf(in, nullptr, _IOFBF, 1 << 20);
+  unsigned char rec[kCandleSize];
+  uint32_t version = 0;
+  bool ok = fread(rec, 1, 8, in) == 8 && memcmp(rec, kMagic, 4) == 0 &&
+            (Get32(rec + 4, &version), version == kVersion);
+  while (ok) {
+    int type = fgetc(in);
+    if (type == EOF)
+      break;
+    if (type == kTickRecord) {
+      if (fread(rec, 1, kTickSize - 1, in) != kTickSize - 1)
+        break;
+      uint32_t symbol;
+      uint64_t time;
+      float price, volume;
+      const unsigned char *p = Get32(rec, &symbol);
+      p = Get64(p, &time);
+      p = GetFloat(p, &price);
+      GetFloat(p, &volume);
+      if (onTick)
+        onTick(symbol, (int64_t)time, price, volume);
+    } else if (type == kCandleRecord) {
+      if (fread(rec, 1, kCandleSize - 1, in) != kCandleSize - 1)
+        break;
+      uint32_t symbol, period;
+      uint64_t start;
+      Candle c;
+      const unsigned char *p = Get32(rec, &symbol);
+      p = Get32(p, &period);
+      p = Get64(p, &start);
+      c.start = (int64_t)start;
+      p = GetFloat(p, &c.open);
+      p = GetFloat(p, &c.high);
+      p = GetFloat(p, &c.low);
+      p = GetFloat(p, &c.close);
+      p = GetFloat(p, &c.volume);
+      Get32(p, &c.ticks);
+      if (onCandle)
+        onCandle(symbol, period, c);
+    } else {
+      ok = false;
+    }
+  }
+  fclose(in);
+  return ok;
+}
+
+} // namespace Core
@@ -0,0 +1,109 @@
+#pragma once
+
+#include "RingBuffer.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace Core {
+
+// One OHLCV bar. Prices are rupees; times are milliseconds on whatever
+// clock the ticks carry.
+struct Candle {
+  int64_t start; // first millisecond the bar covers
+  float open, high, low, close;
+  float volume;
+  uint32_t ticks;
+};
+
+struct CandleConfig {
+  std::vector<int64_t> periodsMillis = {1000, 60000, 300000, 3600000};
+  size_t depth = 1024; // bars kept per symbol and period, the forming one too
+};
+
+class CandleStore;
+
+// Folds ticks into bars at several periods at once. The bar still forming
+// for each (symbol, period) sits in one dense array, so a tick touches a
+// few adjacent cache lines and costs O(periods); once its period has
+// passed a bar is closed into a ring of the last `depth` - 1 bars. Memory
+// is fixed and a chart window is read straight out of the ring in
+// O(window). Periods without ticks have no bar. Not thread safe.
+class CandleAggregator {
+  CandleConfig cfg;
+  size_t symbolCount;
+  std::vector<Candle> forming; // symbol * periods + period; ticks 0: none
+  std::vector<RingBuffer<Candle, false>> closed; // same index
+  CandleStore *sink = nullptr;
+
+  void Fold(size_t symbol, int64_t timeMillis, float price, float volume);
+  size_t Collect(size_t at, size_t first, std::vector<Candle> *out) const;
+
+public:
+  explicit CandleAggregator(size_t symbols,
+                            const CandleConfig &config = CandleConfig());
+
+  size_t Symbols() const { return symbolCount; }
+  size_t Periods() const { return cfg.periodsMillis.size(); }
+  int64_t PeriodMillis(size_t period) const {
+    return cfg.periodsMillis[period];
+  }
+  // Closed bars are appended to store from now on; nullptr stops that.
+  void SetSink(CandleStore *store) { sink = store; }
+
+  // Ticks for a symbol must come in time order; a late one is folded into
+  // the forming bar.
+  void OnTick(size_t symbol, int64_t timeMillis, double price,
+              double volume = 0);
+  // One tick for each of the first n symbols, e.g. a MarketSim snapshot.
+  void OnTicks(int64_t timeMillis, const double *prices, size_t n,
+               const double *volumes = nullptr);
+
+  // Up to count of the newest bars, oldest first, ending with the one
+  // still forming. O(count).
+  size_t Window(size_t symbol, size_t period, size_t count,
+                std::vector<Candle> *out) const;
+  // The bars starting in [from, to), oldest first, found by binary search.
+  // O(log depth + bars returned).
+  size_t Range(size_t symbol, size_t period, int64_t from, int64_t to,
+               std::vector<Candle> *out) const;
+};
+
+// Append-only file of ticks and closed bars: an 8-byte header, then
+// fixed-size little-endian records, 21 bytes per tick and 41 per bar. A
+// record cut short by a crash is ignored on reading and cut off when the
+// store is next opened, so appends resume on a record boundary.
+class CandleStore {
+  FILE *f = nullptr;
+  bool Write(const unsigned char *rec, size_t n);
+
+public:
+  CandleStore() {}
+  ~CandleStore();
+  CandleStore(const CandleStore &) = delete;
+  CandleStore &operator=(const CandleStore &) = delete;
+
+  // Creates path or appends to it after its last whole record; false if it
+  // exists but is not a store.
+  bool Open(const std::string &path);
+  bool Flush();
+  void Close();
+
+  bool AppendTick(uint32_t symbol, int64_t timeMillis, float price,
+                  float volume);
+  bool AppendCandle(uint32_t symbol, int64_t periodMillis, const Candle &c);
+
+  // Replays a store in file order. Either callback may be empty.
+  static bool Read(
+      const std::string &path,
+      const std::function<void(uint32_t symbol, int64_t timeMillis,
+                               float price, float volume)> &onTick,
+      const std::function<void(uint32_t symbol, int64_t periodMillis,
+                               const Candle &c)> &onCandle);
+};
+
+} // namespace Core
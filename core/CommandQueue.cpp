@@ -0,0 +1,158 @@
+#include "CommandQueue.h"
+
+#include <chrono>
+#include <vector>
+
+using namespace std;
+
+namespace Core {
+
+CommandWriter::CommandWriter(CommandSink &target, size_t batchSize)
+    : sink(target), maxBatch(batchSize ? batchSize : 1) {
+  worker = thread(&CommandWriter::Run, this);
+}
+
+CommandWriter::~CommandWriter() { Stop(); }
+
+future<int> CommandWriter::Submit(Command cmd) {
+  future<int> f = cmd.result.get_future();
+  if (stopping.load()) {
+    cmd.result.set_value(6);
+    return f;
+  }
+  queue.Push(move(cmd));
+  // Stop() may have drained between the check above and the push. The
+  // fence orders the push before the second check against Stop's store,
+  // so either this sees stopping or the writer/Stop sees the command.
+  atomic_thread_fence(memory_order_seq_cst);
+  if (stopping.load()) {
+    FailQueued();
+    return f;
+  }
+  // Only an idle writer needs waking, and only then is the lock taken.
+  if (sleeping.load()) {
+    lock_guard<mutex> guard(wakeLock);
+    wake.notify_one();
+  }
+  return f;
+}
+
+future<int> CommandWriter::Deposit(const string &acc, Money amount,
+                                   const string &key) {
+  Command c;
+  c.kind = Command::DEPOSIT;
+  c.account = acc;
+  c.amount = amount;
+  c.key = key;
+  return Submit(move(c));
+}
+
+future<int> CommandWriter::Withdraw(const string &acc, Money amount,
+                                    const string &key) {
+  Command c;
+  c.kind = Command::WITHDRAW;
+  c.account = acc;
+  c.amount = amount;
+  c.key = key;
+  return Submit(move(c));
+}
+
+future<int> CommandWriter::Transfer(const string &from, const string &to,
+                                    Money amount, const string &key) {
+  Command c;
+  c.kind = Command::TRANSFER;
+  c.account = from;
+  c.target = to;
+  c.amount = amount;
+  c.key = key;
+  return Submit(move(c));
+}
+
+future<int> CommandWriter::Trade(const string &acc, const string &symbol,
+                                 int quantity, double price,
+                                 const string &key) {
+  Command c;
+  c.kind = Command::TRADE;
+  c.account = acc;
+  c.symbol = symbol;
+  c.quantity = quantity;
+  c.price = price;
+  c.key = key;
+  return Submit(move(c));
+}
+
+void CommandWriter::Stop() {
+  if (!worker.joinable())
+    return;
+  stopping.store(true);
+  {
+    lock_guard<mutex> guard(wakeLock);
+    wake.notify_one();
+  }
+  worker.join();
+  {
+    lock_guard<mutex> guard(drainLock);
+    joined = true;
+  }
+  FailQueued();
+}
+
+// Fails whatever slipped in behind the writer's last drain. Until the
+// writer is joined it is the only consumer and drains the queue itself.
+void CommandWriter::FailQueued() {
+  lock_guard<mutex> guard(drainLock);
+  if (!joined)
+    return;
+  Command c;
+  while (queue.Pop(&c))
+    c.result.set_value(6);
+}
+
+// Spins briefly, then sleeps until a producer signals. The timed wait
+// covers a push that lands between the emptiness check and the sleep.
+bool CommandWriter::WaitForWork() {
+  for (int spin = 0; spin < 64; spin++) {
+    if (!queue.Empty())
+      return true;
+    if (stopping.load())
+      return false;
+    this_thread::yield();
+  }
+  unique_lock<mutex> guard(wakeLock);
+  sleeping.store(true);
+  while (queue.Empty() && !stopping.load())
+    wake.wait_for(guard, chrono::milliseconds(1));
+  sleeping.store(false);
+  return !queue.Empty() || !stopping.load();
+}
+
+void CommandWriter::Run() {
+  vector<Command> batch;
+  vector<int> results;
+  batch.reserve(maxBatch);
+  while (WaitForWork()) {
+    batch.clear();
+    Command c;
+    while (batch.size() < maxBatch && queue.Pop(&c))
+      batch.push_back(move(c));
+    if (batch.empty())
+      continue;
+
+    results.assign(batch.size(), 6);
+    if (sink.BeginBatch()) {
+      for (size_t i = 0; i < batch.size(); i++)
+        results[i] = sink.Apply(batch[i]);
+      // A failed commit undoes the commands that had applied.
+      if (!sink.CommitBatch())
+        for (int &r : results)
+          if (r == 0)
+            r = 6;
+    }
+    batches++;
+    commands += batch.size();
+    for (size_t i = 0; i < batch.size(); i++)
+      batch[i].result.set_value(results[i]);
+  }
+}
+
+} // namespace Core
@@ -0,0 +1,96 @@
+#pragma once
+
+#include "Money.h"
+#include "MpscQueue.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <future>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace Core {
+
+// A mutation submitted to a CommandWriter. Result codes match
+// VaultDB::Transfer: 0 ok, 2 self, 3 insufficient funds or shares,
+// 4 no such account, 5 bad amount, 6 database error, 7 not supported by
+// the sink.
+struct Command {
+  enum Kind { DEPOSIT, WITHDRAW, TRANSFER, TRADE };
+  Kind kind = DEPOSIT;
+  std::string account;
+  std::string target; // TRANSFER: recipient account number
+  std::string symbol; // TRADE
+  Money amount;       // DEPOSIT, WITHDRAW, TRANSFER
+  int quantity = 0;   // TRADE: > 0 buys, < 0 sells
+  double price = 0;   // TRADE: per share, rupees
+  std::string key;    // optional idempotency key, honoured by the sink
+  std::promise<int> result;
+};
+
+// Something that can apply commands to a database connection. The writer
+// thread calls these in the order BeginBatch, Apply..., CommitBatch; each
+// Apply is atomic on its own (a failed command changes nothing), and
+// CommitBatch makes the whole batch durable or rolls all of it back. A
+// keyed command repeated within the sink's window returns its first result.
+class CommandSink {
+public:
+  virtual ~CommandSink() {}
+  virtual bool BeginBatch() = 0;
+  virtual int Apply(const Command &cmd) = 0;
+  virtual bool CommitBatch() = 0;
+};
+
+struct CommandWriterStats {
+  unsigned long long batches, commands;
+};
+
+// Funnels commands from any number of threads into one writer thread that
+// owns the sink. Submission is a lock-free queue push; the writer drains up
+// to maxBatch commands, applies them in one transaction, and completes
+// their futures once it has committed. While a writer is running, nothing
+// else may use the sink or its connection.
+class CommandWriter {
+  CommandSink &sink;
+  size_t maxBatch;
+  MpscQueue<Command> queue;
+  std::atomic<bool> stopping{false};
+  std::atomic<bool> sleeping{false};
+  std::mutex drainLock; // guards joined and Pop once the writer is gone
+  bool joined = false;
+  std::mutex wakeLock;
+  std::condition_variable wake;
+  std::atomic<unsigned long long> batches{0}, commands{0};
+  std::thread worker;
+
+  void Run();
+  bool WaitForWork();
+  void FailQueued();
+
+public:
+  explicit CommandWriter(CommandSink &target, size_t batchSize = 256);
+  // Stops the writer; see Stop().
+  ~CommandWriter();
+  CommandWriter(const CommandWriter &) = delete;
+  CommandWriter &operator=(const CommandWriter &) = delete;
+
+  std::future<int> Submit(Command cmd);
+  std::future<int> Deposit(const std::string &acc, Money amount,
+                           const std::string &key = "");
+  std::future<int> Withdraw(const std::string &acc, Money amount,
+                            const std::string &key = "");
+  std::future<int> Transfer(const std::string &from, const std::string &to,
+                            Money amount, const std::string &key = "");
+  std::future<int> Trade(const std::string &acc, const std::string &symbol,
+                         int quantity, double price,
+                         const std::string &key = "");
+
+  // Applies everything already queued, then joins the writer thread.
+  // Commands submitted afterwards complete with 6.
+  void Stop();
+  CommandWriterStats Stats() const { return {batches.load(), commands.load()}; }
+};
+
+} // namespace Core
@@ -0,0 +1,241 @@
+#include "Exchange.h"
+
+using namespace std;
+
+namespace Core {
+
+namespace {
+const uint32_t kNone = 0xFFFFFFFFu;
+const int64_t kMinTickPaise = 5;
+} // namespace
+
+Exchange::Exchange(VaultDB &vault, const vector<Stock> &market,
+                   uint32_t levels)
+    : db(vault), freeOpen(kNone) {
+  if (levels < 2)
+    levels = 2;
+  for (const Stock &s : market) {
+    Money price;
+    if (!Money::FromRupees(s.price, &price) || !price.IsPositive())
+      continue;
+    // Half the levels cover 20% of the price, in whole multiples of 5 paise.
+    int64_t tick = price.Paise() * 2 / 5 / levels / kMinTickPaise *
+                   kMinTickPaise;
+    if (tick < kMinTickPaise)
+      tick = kMinTickPaise;
+    int64_t base = price.Paise() - (int64_t)(levels / 2) * tick;
+    if (base < tick)
+      base = tick;
+    Book b;
+    b.symbol = s.symbol;
+    Money::FromPaise(base, &b.base);
+    Money::FromPaise(tick, &b.tick);
+    b.orders.reset(new OrderBook(levels));
+    books.push_back(move(b));
+  }
+}
+
+int Exchange::FindBook(const string &symbol) const {
+  for (size_t i = 0; i < books.size(); i++)
+    if (books[i].symbol == symbol)
+      return (int)i;
+  return -1;
+}
+
+const OrderBook *Exchange::BookFor(const string &symbol) const {
+  int b = FindBook(symbol);
+  return b < 0 ? nullptr : books[b].orders.get();
+}
+
+uint32_t Exchange::AccountId(const string &num) {
+  auto it = accountIds.find(num);
+  if (it != accountIds.end())
+    return it->second;
+  uint32_t id = (uint32_t)accounts.size();
+  accounts.push_back(num);
+  accountIds[num] = id;
+  cashHeld.push_back(Money());
+  sharesHeld.resize(sharesHeld.size() + books.size(), 0);
+  return id;
+}
+
+// Buys round down and sells up to the tick grid, so neither side is ever
+// filled at a worse price than it asked for.
+bool Exchange::TickOf(const Book &b, double price, Side side,
+                      uint32_t *tick) const {
+  Money p;
+  if (!Money::FromRupees(price, &p) || p < b.base)
+    return false;
+  int64_t off = p.Paise() - b.base.Paise();
+  int64_t t = off / b.tick.Paise();
+  if (side == SELL && off % b.tick.Paise())
+    t++;
+  if (t >= (int64_t)b.orders->Levels())
+    return false;
+  *tick = (uint32_t)t;
+  return true;
+}
+
+Money Exchange::PriceOf(const Book &b, uint32_t tick) const {
+  Money p;
+  Money::FromPaise(b.base.Paise() + (int64_t)tick * b.tick.Paise(), &p);
+  return p;
+}
+
+// Frees what quantity of an order held: cash at price for a buy, shares for
+// a sell.
+void Exchange::Release(uint32_t account, uint32_t book, Side side,
+                       Money price, int64_t quantity) {
+  if (side == SELL) {
+    sharesHeld[(size_t)account * books.size() + book] -= quantity;
+    return;
+  }
+  Money amount;
+  if (price.Mul(quantity, &amount))
+    cashHeld[account].Sub(amount, &cashHeld[account]);
+}
+
+uint32_t Exchange::AllocOpen() {
+  if (freeOpen == kNone) {
+    open.push_back(Open());
+    return (uint32_t)open.size() - 1;
+  }
+  uint32_t slot = freeOpen;
+  freeOpen = open[slot].next;
+  return slot;
+}
+
+void Exchange::FreeOpen(uint32_t slot) {
+  open[slot].id = 0;
+  open[slot].next = freeOpen;
+  freeOpen = slot;
+}
+
+int Exchange::Submit(const string &accNum, const string &symbol, int quantity,
+                     double limit, uint64_t *orderId,
+                     vector<Execution> *executions) {
+  if (orderId)
+    *orderId = 0;
+  int bi = FindBook(symbol);
+  if (quantity == 0 || !(limit >= 0) || bi < 0)
+    return 5;
+  Book &b = books[bi];
+  Side side = quantity > 0 ? BUY : SELL;
+  uint32_t qty = quantity > 0 ? (uint32_t)quantity : 0u - (uint32_t)quantity;
+  bool isMarket = limit == 0;
+  uint32_t tick = 0;
+  if (!isMarket && !TickOf(b, limit, side, &tick))
+    return 5;
+  Money balance;
+  if (!db.GetBalance(accNum, &balance))
+    return 4;
+  uint32_t a = AccountId(accNum);
+
+  // Hold what the order could need before it touches the book.
+  Money limitPrice = PriceOf(b, tick);
+  int64_t &shares = sharesHeld[(size_t)a * books.size() + bi];
+  if (side == BUY) {
+    Money need, free;
+    bool ok;
+    if (isMarket) {
+      uint64_t tickQty;
+      uint32_t fill = b.orders->Sweep(BUY, b.orders->Levels() - 1, qty,
+                                      &tickQty);
+      Money levels;
+      ok = b.base.Mul(fill, &need) && b.tick.Mul((int64_t)tickQty, &levels) &&
+           need.Add(levels, &need);
+    } else {
+      ok = limitPrice.Mul(qty, &need);
+    }
+    if (!ok)
+      return 5;
+    if (!balance.Sub(cashHeld[a], &free) || need > free)
+      return 3;
+    cashHeld[a].Add(need, &cashHeld[a]);
+  } else {
+    if (db.GetOwnedStocks(accNum, symbol) - shares < (int64_t)qty)
+      return 3;
+    shares += qty;
+  }
+
+  uint32_t slot = kNone, left = 0, filled;
+  uint64_t bookId = 0;
+  matches.clear();
+  if (isMarket) {
+    filled = b.orders->Market(side, kNone, qty, &matches);
+  } else {
+    slot = AllocOpen();
+    open[slot].id = 0;
+    bookId = b.orders->Limit(side, slot, tick, qty, &matches, &left);
+    filled = qty - left;
+  }
+  stats.orders++;
+
+  bool refused = false;
+  for (const BookMatch &m : matches) {
+    Open &maker = open[m.makerOwner];
+    Money price = PriceOf(b, m.tick);
+    const string &makerAcc = accounts[maker.account];
+    const string &buyer = side == BUY ? accNum : makerAcc;
+    const string &seller = side == BUY ? makerAcc : accNum;
+    if (db.Cross(buyer, seller, symbol, (int)m.quantity, price.Rupees()) !=
+        0) {
+      stats.refused++;
+      refused = true;
+    }
+    stats.matches++;
+    Release(maker.account, bi, maker.side, maker.limit, m.quantity);
+    // A market buy held exactly the prices it took; a limit buy its limit.
+    Release(a, bi, side, isMarket ? price : limitPrice, m.quantity);
+    if (m.makerLeft == 0)
+      FreeOpen(m.makerOwner);
+    if (executions)
+      executions->push_back(Execution{buyer, seller, (int)m.quantity, price});
+  }
+
+  if (isMarket) {
+    if (side == SELL)
+      shares -= qty - filled;
+  } else if (left == 0) {
+    FreeOpen(slot);
+  } else {
+    uint64_t id = (nextSeq++ << 32) | slot;
+    open[slot] = Open{id, bookId, a, (uint32_t)bi, side, limitPrice, kNone};
+    if (orderId)
+      *orderId = id;
+  }
+  return refused ? 6 : 0;
+}
+
+bool Exchange::Cancel(uint64_t orderId) {
+  uint32_t slot = (uint32_t)orderId, left;
+  if (orderId == 0 || slot >= open.size() || open[slot].id != orderId)
+    return false;
+  Open &o = open[slot];
+  if (!books[o.book].orders->Cancel(o.bookId, &left))
+    return false;
+  Release(o.account, o.book, o.side, o.limit, left);
+  FreeOpen(slot);
+  return true;
+}
+
+bool Exchange::Quote(const string &symbol, double *bid, double *ask) const {
+  *bid = *ask = 0;
+  int bi = FindBook(symbol);
+  if (bi < 0)
+    return false;
+  const Book &b = books[bi];
+  uint32_t t;
+  bool any = false;
+  if (b.orders->BestBid(&t)) {
+    *bid = PriceOf(b, t).Rupees();
+    any = true;
+  }
+  if (b.orders->BestAsk(&t)) {
+    *ask = PriceOf(b, t).Rupees();
+    any = true;
+  }
+  return any;
+}
+
+} // namespace Core
@@ -0,0 +1,107 @@
+#pragma once
+
+#include "Market.h"
+#include "Money.h"
+#include "OrderBook.h"
+#include "VaultDB.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Core {
+
+// One settled match, as reported to the taker.
+struct Execution {
+  std::string buyer, seller;
+  int quantity;
+  Money price;
+};
+
+struct ExchangeStats {
+  unsigned long long orders;  // accepted by Submit
+  unsigned long long matches; // crossed in a book
+  unsigned long long refused; // matches VaultDB::Cross did not settle
+};
+
+// A matching engine per symbol in front of a VaultDB. Orders go into an
+// OrderBook; each match is settled right away through VaultDB::Cross, so
+// cash and shares move between the two accounts with their fills rows and
+// ledger entries.
+//
+// Submit checks the order against what the account has not already
+// committed to its open orders: a buy holds limit * quantity (a market buy
+// the exact cost of the levels it will take), a sell holds the shares. A
+// match therefore only fails to settle if the account was changed behind
+// the exchange's back; it is counted in Stats().refused.
+//
+// Each book spans `levels` ticks centred on the stock's price when the
+// exchange was built; the tick is 5 paise, or coarser for high prices so
+// the band is about +/-20%. Limits outside it are refused. Books live in
+// memory only. Not thread safe.
+class Exchange {
+  struct Book {
+    std::string symbol;
+    Money base, tick;
+    std::unique_ptr<OrderBook> orders;
+  };
+  // An order still resting, keyed by the owner value given to its book.
+  struct Open {
+    uint64_t id; // Exchange id; 0 while the slot is free
+    uint64_t bookId;
+    uint32_t account, book;
+    Side side;
+    Money limit;
+    uint32_t next; // free list
+  };
+
+  VaultDB &db;
+  std::vector<Book> books;
+  std::vector<std::string> accounts;
+  std::unordered_map<std::string, uint32_t> accountIds;
+  std::vector<Money> cashHeld;     // by account
+  std::vector<int64_t> sharesHeld; // by account * books + book
+  std::vector<Open> open;
+  uint32_t freeOpen;
+  uint64_t nextSeq = 1;
+  std::vector<BookMatch> matches;
+  ExchangeStats stats = {0, 0, 0};
+
+  int FindBook(const std::string &symbol) const;
+  uint32_t AccountId(const std::string &num);
+  bool TickOf(const Book &b, double price, Side side, uint32_t *tick) const;
+  Money PriceOf(const Book &b, uint32_t tick) const;
+  void Release(uint32_t account, uint32_t book, Side side, Money price,
+               int64_t quantity);
+  uint32_t AllocOpen();
+  void FreeOpen(uint32_t slot);
+
+public:
+  Exchange(VaultDB &vault, const std::vector<Stock> &market,
+           uint32_t levels = 8192);
+  Exchange(const Exchange &) = delete;
+  Exchange &operator=(const Exchange &) = delete;
+
+  // Buys (quantity > 0) or sells (quantity < 0). A positive limit is a
+  // limit order whose remainder rests in the book under *orderId; a limit
+  // of 0 is a market order, filled as far as the book allows and the rest
+  // dropped (*orderId is then 0). 0 ok, 3 insufficient funds or shares,
+  // 4 no account, 5 bad quantity, limit or symbol, 6 a match failed to
+  // settle.
+  int Submit(const std::string &accNum, const std::string &symbol,
+             int quantity, double limit, uint64_t *orderId = nullptr,
+             std::vector<Execution> *executions = nullptr);
+  // Withdraws a resting order and frees what it held.
+  bool Cancel(uint64_t orderId);
+  // Best bid and ask in rupees, 0 for an empty side. False if both sides
+  // are empty or the symbol is unknown.
+  bool Quote(const std::string &symbol, double *bid, double *ask) const;
+
+  const OrderBook *BookFor(const std::string &symbol) const;
+  ExchangeStats Stats() const { return stats; }
+};
+
+} // namespace Core
@@ -0,0 +1,136 @@
+#include "GroupCommit.h"
+
+#include <sqlite3.h>
+#include <string>
+
+using namespace std;
+
+namespace Core {
+
+bool EnableWal(sqlite3 *db) {
+  string mode;
+  sqlite3_stmt *s;
+  if (sqlite3_prepare_v2(db, "PRAGMA journal_mode=WAL;", -1, &s, 0) !=
+      SQLITE_OK)
+    return false;
+  if (sqlite3_step(s) == SQLITE_ROW) {
+    const char *m = (const char *)sqlite3_column_text(s, 0);
+    mode = m ? m : "";
+  }
+  sqlite3_finalize(s);
+  sqlite3_exec(db, "PRAGMA synchronous=FULL;", 0, 0, 0);
+  return mode == "wal";
+}
+
+GroupCommitter::~GroupCommitter() { Detach(); }
+
+void GroupCommitter::Attach(sqlite3 *connection) {
+  Detach();
+  db = connection;
+  sqlite3_prepare_v3(db, "BEGIN IMMEDIATE;", -1, SQLITE_PREPARE_PERSISTENT,
+                     &begin, 0);
+  sqlite3_prepare_v3(db, "COMMIT;", -1, SQLITE_PREPARE_PERSISTENT, &commit, 0);
+  sqlite3_prepare_v3(db, "ROLLBACK;", -1, SQLITE_PREPARE_PERSISTENT, &rollback,
+                     0);
+}
+
+void GroupCommitter::Detach() {
+  if (!db)
+    return;
+  Flush();
+  sqlite3_finalize(begin);
+  sqlite3_finalize(commit);
+  sqlite3_finalize(rollback);
+  begin = commit = rollback = nullptr;
+  db = nullptr;
+  enabled = false;
+}
+
+void GroupCommitter::Enable(const GroupCommitConfig &config) {
+  cfg = config;
+  if (cfg.maxOps == 0)
+    cfg.maxOps = 1;
+  enabled = db != nullptr;
+}
+
+bool GroupCommitter::Disable() {
+  bool ok = Flush();
+  enabled = false;
+  return ok;
+}
+
+bool GroupCommitter::Step(sqlite3_stmt *s) {
+  if (!s)
+    return false;
+  bool ok = sqlite3_step(s) == SQLITE_DONE;
+  sqlite3_reset(s);
+  return ok;
+}
+
+bool GroupCommitter::Due() const {
+  if (pendingOps >= cfg.maxOps)
+    return true;
+  return chrono::steady_clock::now() - openedAt >=
+         chrono::microseconds(cfg.maxMicros);
+}
+
+bool GroupCommitter::BeginOp() {
+  if (!enabled || open)
+    return true;
+  // Someone else (a caller's explicit BEGIN) owns the transaction.
+  if (!sqlite3_get_autocommit(db))
+    return true;
+  if (!Step(begin))
+    return false;
+  open = true;
+  openedAt = chrono::steady_clock::now();
+  return true;
+}
+
+void GroupCommitter::EndOp(bool applied, const DurableCallback &done) {
+  if (!open) {
+    // Per-operation mode: the statement already autocommitted.
+    if (done)
+      done(applied);
+    return;
+  }
+  if (!applied) {
+    if (done)
+      done(false);
+  } else {
+    pendingOps++;
+    if (done)
+      waiters.push_back(done);
+  }
+  if (Due())
+    Flush();
+}
+
+void GroupCommitter::Poll() {
+  if (open && Due())
+    Flush();
+}
+
+bool GroupCommitter::Flush() {
+  if (!open)
+    return true;
+  bool ok = Step(commit);
+  if (!ok) {
+    Step(rollback);
+    if (onRollback)
+      onRollback();
+  }
+  open = false;
+  if (ok) {
+    stats.batches++;
+    stats.ops += pendingOps;
+  }
+  pendingOps = 0;
+  vector<DurableCallback> done;
+  done.swap(waiters);
+  for (auto &cb : done)
+    cb(ok);
+  return ok;
+}
+
+} // namespace Core
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
+
+struct sqlite3;
+struct sqlite3_stmt;
+
+namespace Core {
+
+// Switches the connection to write-ahead logging with a full fsync per
+// commit. Returns false if the journal mode could not be changed (for
+// example on an in-memory database).
+bool EnableWal(sqlite3 *db);
+
+// Told whether an operation reached disk (true) or was rolled back (false).
+typedef std::function<void(bool durable)> DurableCallback;
+
+struct GroupCommitConfig {
+  size_t maxOps = 64;        // commit once this many operations are queued
+  uint32_t maxMicros = 2000; // ... or once the oldest has waited this long
+};
+
+struct GroupCommitStats {
+  unsigned long long batches, ops;
+};
+
+// Shares one write transaction between consecutive operations so a single
+// COMMIT (and fsync) covers a whole window of them. Disabled by default, in
+// which case every operation autocommits and is durable when it returns.
+//
+// Callers bracket each mutation with BeginOp()/EndOp(); the operation's own
+// atomicity comes from a SAVEPOINT inside the shared transaction.
+class GroupCommitter {
+  sqlite3 *db = nullptr;
+  sqlite3_stmt *begin = nullptr, *commit = nullptr, *rollback = nullptr;
+  bool enabled = false;
+  bool open = false;
+  GroupCommitConfig cfg;
+  std::chrono::steady_clock::time_point openedAt;
+  std::vector<DurableCallback> waiters;
+  std::function<void()> onRollback;
+  size_t pendingOps = 0;
+  GroupCommitStats stats = {0, 0};
+
+  bool Step(sqlite3_stmt *s);
+  bool Due() const;
+
+public:
+  GroupCommitter() {}
+  ~GroupCommitter();
+  GroupCommitter(const GroupCommitter &) = delete;
+  GroupCommitter &operator=(const GroupCommitter &) = delete;
+
+  void Attach(sqlite3 *connection);
+  // Flushes and finalizes; call before closing the connection.
+  void Detach();
+
+  void Enable(const GroupCommitConfig &config);
+  // Called when a batch rolls back, before its waiters hear, so owners can
+  // drop anything cached from the undone operations.
+  void SetRollbackHook(std::function<void()> hook) {
+    onRollback = std::move(hook);
+  }
+  // Commits whatever is queued and goes back to per-operation commits.
+  bool Disable();
+  bool Enabled() const { return enabled; }
+  GroupCommitStats Stats() const { return stats; }
+
+  // Opens the shared transaction if group commit is on and none is open.
+  bool BeginOp();
+  // Records the outcome of an operation started with BeginOp. Failed
+  // operations are reported immediately; applied ones once their batch
+  // commits, which happens here when the batch is full or its window closed.
+  void EndOp(bool applied, const DurableCallback &done);
+  // Commits the open batch if its time window has elapsed. Call from idle
+  // loops and timers so a quiet period does not strand queued operations.
+  void Poll();
+  // Commits the open batch now. False if the commit failed and the batch
+  // was rolled back.
+  bool Flush();
+};
+
+} // namespace Core
@@ -0,0 +1,199 @@
+#include "Idempotency.h"
+
+#include <ctime>
+#include <sqlite3.h>
+#include <vector>
+
+using namespace std;
+
+namespace Core {
+
+namespace {
+const size_t kPruneEvery = 1024; // records between DELETEs of expired keys
+}
+
+IdempotencyStore::~IdempotencyStore() { Detach(); }
+
+bool IdempotencyStore::Step(sqlite3_stmt *s) {
+  int rc = sqlite3_step(s);
+  sqlite3_reset(s);
+  sqlite3_clear_bindings(s);
+  return rc == SQLITE_DONE || rc == SQLITE_ROW;
+}
+
+bool IdempotencyStore::Attach(sqlite3 *connection,
+                              const IdempotencyConfig &config) {
+  Detach();
+  db = connection;
+  cfg = config;
+  if (cfg.maxEntries == 0)
+    cfg.maxEntries = 1;
+  const char *sql[] = {
+      "SAVEPOINT keyed;", "RELEASE keyed;", "ROLLBACK TO keyed;",
+      // Takes the key over only once the old entry has expired.
+      "INSERT INTO idempotency_keys (key, result, created_at) VALUES "
+      "(?1, ?2, ?3) ON CONFLICT(key) DO UPDATE SET result = excluded.result, "
+      "created_at = excluded.created_at WHERE created_at < ?4;",
+      "SELECT result, created_at FROM idempotency_keys WHERE key = ?;",
+      "DELETE FROM idempotency_keys WHERE created_at < ?;"};
+  sqlite3_stmt **out[] = {&savepoint, &release, &rollbackTo,
+                          &upsert,    &select,  &prune};
+  bool ok = sqlite3_exec(db,
+                         "CREATE TABLE IF NOT EXISTS idempotency_keys (key "
+                         "TEXT PRIMARY KEY, result INTEGER NOT NULL, "
+                         "created_at INTEGER NOT NULL) WITHOUT ROWID;"
+                         "CREATE INDEX IF NOT EXISTS "
+                         "idx_idempotency_keys_created_at ON "
+                         "idempotency_keys(created_at);",
+                         0, 0, 0) == SQLITE_OK;
+  for (size_t i = 0; ok && i < 6; i++)
+    ok = sqlite3_prepare_v3(db, sql[i], -1, SQLITE_PREPARE_PERSISTENT, out[i],
+                            0) == SQLITE_OK;
+  if (!ok) {
+    Detach();
+    return false;
+  }
+
+  int64_t cutoff = (int64_t)time(nullptr) - cfg.windowSeconds;
+  sqlite3_bind_int64(prune, 1, cutoff);
+  Step(prune);
+  // Newest keys first, then replayed oldest first so eviction order holds.
+  struct Row {
+    string key;
+    int result;
+    int64_t at;
+  };
+  vector<Row> rows;
+  sqlite3_stmt *s;
+  if (sqlite3_prepare_v2(db,
+                         "SELECT key, result, created_at FROM "
+                         "idempotency_keys WHERE created_at >= ? ORDER BY "
+                         "created_at DESC LIMIT ?;",
+                         -1, &s, 0) == SQLITE_OK) {
+    sqlite3_bind_int64(s, 1, cutoff);
+    sqlite3_bind_int64(s, 2, (sqlite3_int64)cfg.maxEntries);
+    while (sqlite3_step(s) == SQLITE_ROW) {
+      const char *key = (const char *)sqlite3_column_text(s, 0);
+      rows.push_back({key ? key : "", sqlite3_column_int(s, 1),
+                      sqlite3_column_int64(s, 2)});
+    }
+    sqlite3_finalize(s);
+  }
+  recent.reserve(rows.size());
+  for (auto it = rows.rbegin(); it != rows.rend(); ++it)
+    Remember(it->key, it->result, it->at);
+  return true;
+}
+
+void IdempotencyStore::Detach() {
+  for (sqlite3_stmt **s :
+       {&savepoint, &release, &rollbackTo, &upsert, &select, &prune}) {
+    sqlite3_finalize(*s);
+    *s = nullptr;
+  }
+  recent.clear();
+  order.clear();
+  db = nullptr;
+}
+
+void IdempotencyStore::Remember(const string &key, int result, int64_t at) {
+  recent[key] = Entry{result, at};
+  order.emplace_back(key, at);
+  Evict(at);
+}
+
+// Drops expired keys and the oldest ones beyond maxEntries. Queue entries
+// whose key has since been forgotten or re-recorded are skipped.
+void IdempotencyStore::Evict(int64_t now) {
+  int64_t cutoff = now - cfg.windowSeconds;
+  while (!order.empty() &&
+         (recent.size() > cfg.maxEntries ||
+          order.size() > 2 * cfg.maxEntries || order.front().second < cutoff)) {
+    auto it = recent.find(order.front().first);
+    if (it != recent.end() && it->second.at == order.front().second)
+      recent.erase(it);
+    order.pop_front();
+  }
+}
+
+bool IdempotencyStore::Lookup(const string &key, int *result) {
+  auto it = recent.find(key);
+  if (it == recent.end() ||
+      it->second.at < (int64_t)time(nullptr) - cfg.windowSeconds)
+    return false;
+  stats.hits++;
+  *result = it->second.result;
+  return true;
+}
+
+void IdempotencyStore::Forget(const string &key) { recent.erase(key); }
+
+int IdempotencyStore::Record(const string &key, int result, int *stored) {
+  if (!upsert)
+    return -1;
+  int64_t now = (int64_t)time(nullptr);
+  sqlite3_bind_text(upsert, 1, key.c_str(), -1, SQLITE_TRANSIENT);
+  sqlite3_bind_int(upsert, 2, result);
+  sqlite3_bind_int64(upsert, 3, now);
+  sqlite3_bind_int64(upsert, 4, now - cfg.windowSeconds);
+  if (!Step(upsert))
+    return -1;
+  if (sqlite3_changes(db) > 0) {
+    stats.recorded++;
+    Remember(key, result, now);
+    if (++sincePrune >= kPruneEvery) {
+      sincePrune = 0;
+      sqlite3_bind_int64(prune, 1, now - cfg.windowSeconds);
+      Step(prune);
+    }
+    return 0;
+  }
+
+  // Still inside the window on disk, just no longer in memory.
+  sqlite3_bind_text(select, 1, key.c_str(), -1, SQLITE_TRANSIENT);
+  bool found = sqlite3_step(select) == SQLITE_ROW;
+  if (found) {
+    *stored = sqlite3_column_int(select, 0);
+    Remember(key, *stored, sqlite3_column_int64(select, 1));
+  }
+  sqlite3_reset(select);
+  sqlite3_clear_bindings(select);
+  if (!found)
+    return -1;
+  stats.replayed++;
+  return 1;
+}
+
+int IdempotencyStore::Run(const string &key, const function<int()> &apply,
+                          const function<void()> &undo) {
+  if (key.empty())
+    return apply();
+  int res;
+  if (Lookup(key, &res))
+    return res;
+  if (!savepoint || !Step(savepoint))
+    return 6;
+  res = apply();
+  bool undone = false;
+  if (res != 6 && res != 7) {
+    int stored, r = Record(key, res, &stored);
+    if (r != 0) {
+      Step(rollbackTo);
+      undone = true;
+      res = r == 1 ? stored : 6;
+    }
+  }
+  // Outside any transaction this RELEASE is the commit.
+  if (!Step(release)) {
+    Step(rollbackTo);
+    Step(release);
+    Forget(key);
+    undone = true;
+    res = 6;
+  }
+  if (undone && undo)
+    undo();
+  return res;
+}
+
+} // namespace Core
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <string>
+#include <unordered_map>
+
+struct sqlite3;
+struct sqlite3_stmt;
+
+namespace Core {
+
+struct IdempotencyConfig {
+  size_t maxEntries = 100000;        // keys held in memory
+  int64_t windowSeconds = 24 * 3600; // how long a key is honoured
+};
+
+struct IdempotencyStats {
+  unsigned long long recorded; // first-time keys written
+  unsigned long long hits;     // repeats answered from memory
+  unsigned long long replayed; // repeats only found on disk
+};
+
+// Remembers the result of each operation submitted with a client key, so a
+// retry returns the original result instead of applying twice.
+//
+// Keys live in idempotency_keys(key, result, created_at) and, for the most
+// recent maxEntries within the window, in a hash map. Run() checks the map
+// (one probe, no query) and otherwise applies the operation and inserts the
+// key in the same savepoint. A key that had dropped out of the map collides
+// on the primary key instead; the operation is then rolled back and the
+// stored result returned. Either way a key inside the window is never
+// applied twice, and the hot path costs one INSERT in the transaction that
+// was being written anyway.
+//
+// Codes 6 and 7 are not recorded, so the caller can retry them.
+class IdempotencyStore {
+  struct Entry {
+    int result;
+    int64_t at;
+  };
+
+  sqlite3 *db = nullptr;
+  sqlite3_stmt *savepoint = nullptr, *release = nullptr, *rollbackTo = nullptr;
+  sqlite3_stmt *upsert = nullptr, *select = nullptr, *prune = nullptr;
+  IdempotencyConfig cfg;
+  std::unordered_map<std::string, Entry> recent;
+  std::deque<std::pair<std::string, int64_t>> order; // oldest first
+  size_t sincePrune = 0;
+  IdempotencyStats stats = {0, 0, 0};
+
+  bool Step(sqlite3_stmt *s);
+  void Remember(const std::string &key, int result, int64_t at);
+  void Evict(int64_t now);
+
+public:
+  IdempotencyStore() {}
+  ~IdempotencyStore();
+  IdempotencyStore(const IdempotencyStore &) = delete;
+  IdempotencyStore &operator=(const IdempotencyStore &) = delete;
+
+  // Creates the table if needed and loads the newest keys into memory.
+  bool Attach(sqlite3 *connection,
+              const IdempotencyConfig &config = IdempotencyConfig());
+  void Detach();
+
+  // Result of key if it is in memory and inside the window.
+  bool Lookup(const std::string &key, int *result);
+  // Writes key inside the caller's open savepoint: 0 if recorded, 1 if it
+  // was already on disk (*stored set, and now in memory too), -1 on error.
+  // Run() is built on this; batch callers use it directly.
+  int Record(const std::string &key, int result, int *stored);
+  // Drops key from memory, for keys whose transaction was rolled back after
+  // Run() returned (a failed group commit or command batch).
+  void Forget(const std::string &key);
+
+  // Runs apply() at most once per key. An empty key just runs it. undo is
+  // called if apply() ran but had to be rolled back because the key turned
+  // out to be on disk; callers with caches use it to resynchronise.
+  int Run(const std::string &key, const std::function<int()> &apply,
+          const std::function<void()> &undo = nullptr);
+
+  IdempotencyStats Stats() const { return stats; }
+};
+
+} // namespace Core
@@ -0,0 +1,245 @@
+#include "Indicators.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+namespace Core {
+
+namespace {
+
+// The per-tick steps, shared by both classes so their results agree; all
+// branch-free so the universe's loops over them vectorize.
+
+// x joins a window that now holds 1 / invK values.
+inline void WelfordAdd(double x, double invK, double &mean, double &m2) {
+  double d = x - mean;
+  mean += d * invK;
+  m2 += d * (x - mean);
+}
+
+// x replaces out in a full window of 1 / invN values.
+inline void WelfordSlide(double x, double out, double invN, double &mean,
+                         double &m2) {
+  double d = x - out, before = mean;
+  mean += d * invN;
+  m2 += d * (x - mean + out - before);
+}
+
+// Averages of up and down moves. alpha 1 / k over the first k moves is
+// their plain mean, which seeds Wilder's smoothing at 1 / period.
+inline void WilderStep(double x, double alpha, double &prev, double &gain,
+                       double &loss) {
+  double move = x - prev;
+  gain += alpha * (max(move, 0.0) - gain);
+  loss += alpha * (max(-move, 0.0) - loss);
+  prev = x;
+}
+
+// 100 - 100 / (1 + gain / loss), without dividing by a zero loss. The
+// division is unconditional so only a select depends on the test.
+inline double RsiOf(double gain, double loss) {
+  double total = gain + loss, r = 100 * gain / (total > 0 ? total : 1);
+  return total > 0 ? r : 50;
+}
+
+// Falls back to the last price until some volume has traded.
+inline double VwapOf(double pv, double vol, double last) {
+  double r = pv / (vol > 0 ? vol : 1);
+  return vol > 0 ? r : last;
+}
+
+IndicatorConfig Checked(IndicatorConfig cfg) {
+  cfg.window = max<size_t>(cfg.window, 1);
+  cfg.emaPeriod = max<size_t>(cfg.emaPeriod, 1);
+  cfg.rsiPeriod = max<size_t>(cfg.rsiPeriod, 1);
+  return cfg;
+}
+
+} // namespace
+
+SymbolIndicators::SymbolIndicators(const IndicatorConfig &config)
+    : cfg(Checked(config)), window(cfg.window) {}
+
+void SymbolIndicators::Update(double price, double volume) {
+  size_t w = window.Capacity();
+  if (ticks >= w && ticks % w == 0) {
+    // Once a window, recomputed exactly so sliding rounding cannot pile up.
+    double invN = 1.0 / w;
+    mean = m2 = 0;
+    for (size_t k = 0; k < w; k++)
+      mean += window[k];
+    mean *= invN;
+    for (size_t k = 0; k < w; k++)
+      m2 += (window[k] - mean) * (window[k] - mean);
+  }
+  if (window.Size() == w)
+    WelfordSlide(price, window[0], 1.0 / w, mean, m2);
+  else
+    WelfordAdd(price, 1.0 / (window.Size() + 1), mean, m2);
+  window.Push(price);
+  ema += (ticks ? 2.0 / (cfg.emaPeriod + 1) : 1.0) * (price - ema);
+  if (ticks)
+    WilderStep(price, 1.0 / min<uint64_t>(ticks, cfg.rsiPeriod), prev,
+               avgGain, avgLoss);
+  else
+    prev = price;
+  pv += price * volume;
+  vol += volume;
+  ticks++;
+}
+
+IndicatorValues SymbolIndicators::Values() const {
+  double sd = sqrt(max(m2, 0.0) * (1.0 / window.Size()));
+  return IndicatorValues{mean,
+                         ema,
+                         VwapOf(pv, vol, window.Back()),
+                         mean + cfg.bandWidth * sd,
+                         mean - cfg.bandWidth * sd,
+                         RsiOf(avgGain, avgLoss),
+                         window.Min(),
+                         window.Max()};
+}
+
+IndicatorUniverse::IndicatorUniverse(size_t symbols,
+                                     const IndicatorConfig &config)
+    : cfg(Checked(config)), n(symbols), window(cfg.window * symbols),
+      mean(symbols), m2(symbols), pv(symbols), vol(symbols), prev(symbols),
+      avgGain(symbols), avgLoss(symbols), sma(symbols), ema(symbols),
+      vwap(symbols), upper(symbols), lower(symbols), rsi(symbols),
+      low(symbols), high(symbols),
+      suffixLow((cfg.window + 1) * symbols, HUGE_VAL),
+      suffixHigh((cfg.window + 1) * symbols, -HUGE_VAL), blockLow(symbols),
+      blockHigh(symbols) {}
+
+// Before the tick overwrites row next.
+void IndicatorUniverse::Channel(const double *prices) {
+  size_t w = cfg.window;
+  double *bl = blockLow.data(), *bh = blockHigh.data();
+  if (next == 0) {
+    // A block starts. Until the first one is complete the suffix rows stay
+    // empty (+/- infinity).
+    if (ticks) {
+      for (size_t k = w; k-- > 0;) {
+        const double *row = window.data() + k * n;
+        const double *lo1 = suffixLow.data() + (k + 1) * n;
+        const double *hi1 = suffixHigh.data() + (k + 1) * n;
+        double *lo = suffixLow.data() + k * n;
+        double *hi = suffixHigh.data() + k * n;
+        for (size_t i = 0; i < n; i++) {
+          lo[i] = min(lo1[i], row[i]);
+          hi[i] = max(hi1[i], row[i]);
+        }
+      }
+    }
+    copy(prices, prices + n, bl);
+    copy(prices, prices + n, bh);
+  } else {
+    for (size_t i = 0; i < n; i++) {
+      bl[i] = min(bl[i], prices[i]);
+      bh[i] = max(bh[i], prices[i]);
+    }
+  }
+  // The window is the previous block after row next, then this block.
+  const double *lo1 = suffixLow.data() + (next + 1) * n;
+  const double *hi1 = suffixHigh.data() + (next + 1) * n;
+  double *lo = low.data(), *hi = high.data();
+  for (size_t i = 0; i < n; i++) {
+    lo[i] = min(lo1[i], bl[i]);
+    hi[i] = max(hi1[i], bh[i]);
+  }
+}
+
+void IndicatorUniverse::Tick(const double *prices, const double *volumes) {
+  Channel(prices);
+  size_t w = cfg.window;
+  double *row = window.data() + next * n;
+  double *mn = mean.data(), *ms = m2.data();
+  if (ticks >= w) {
+    double invN = 1.0 / w;
+    if (next == 0) {
+      // The same resync as SymbolIndicators, in the same order: at row 0
+      // the rows are oldest first.
+      fill(mn, mn + n, 0.0);
+      fill(ms, ms + n, 0.0);
+      for (size_t k = 0; k < w; k++) {
+        const double *r = window.data() + k * n;
+        for (size_t i = 0; i < n; i++)
+          mn[i] += r[i];
+      }
+      for (size_t i = 0; i < n; i++)
+        mn[i] *= invN;
+      for (size_t k = 0; k < w; k++) {
+        const double *r = window.data() + k * n;
+        for (size_t i = 0; i < n; i++)
+          ms[i] += (r[i] - mn[i]) * (r[i] - mn[i]);
+      }
+    }
+    for (size_t i = 0; i < n; i++) {
+      WelfordSlide(prices[i], row[i], invN, mn[i], ms[i]);
+      row[i] = prices[i];
+    }
+  } else {
+    double invK = 1.0 / (ticks + 1);
+    for (size_t i = 0; i < n; i++) {
+      WelfordAdd(prices[i], invK, mn[i], ms[i]);
+      row[i] = prices[i];
+    }
+  }
+  next = next + 1 == w ? 0 : next + 1;
+
+  double *pr = prev.data(), *ag = avgGain.data(), *al = avgLoss.data();
+  if (ticks) {
+    double alpha = 1.0 / min<uint64_t>(ticks, cfg.rsiPeriod);
+    for (size_t i = 0; i < n; i++)
+      WilderStep(prices[i], alpha, pr[i], ag[i], al[i]);
+  } else {
+    copy(prices, prices + n, pr);
+  }
+
+  double *pvs = pv.data(), *vs = vol.data();
+  if (volumes) {
+    for (size_t i = 0; i < n; i++) {
+      pvs[i] += prices[i] * volumes[i];
+      vs[i] += volumes[i];
+    }
+  } else {
+    for (size_t i = 0; i < n; i++) {
+      pvs[i] += prices[i];
+      vs[i] += 1.0;
+    }
+  }
+
+  // Separate passes: one loop over all eight columns has too many possible
+  // overlaps for the vectorizer to check.
+  double a = ticks ? 2.0 / (cfg.emaPeriod + 1) : 1.0;
+  double *em = ema.data(), *rs = rsi.data(), *vw = vwap.data();
+  for (size_t i = 0; i < n; i++)
+    em[i] += a * (prices[i] - em[i]);
+  for (size_t i = 0; i < n; i++)
+    rs[i] = RsiOf(ag[i], al[i]);
+  for (size_t i = 0; i < n; i++)
+    vw[i] = VwapOf(pvs[i], vs[i], prices[i]);
+  double invHeld = 1.0 / min<uint64_t>(ticks + 1, w), bw = cfg.bandWidth;
+  double *sm = sma.data(), *up = upper.data(), *lo = lower.data();
+  for (size_t i = 0; i < n; i++) {
+    double sd = sqrt(max(ms[i], 0.0) * invHeld);
+    sm[i] = mn[i];
+    up[i] = mn[i] + bw * sd;
+    lo[i] = mn[i] - bw * sd;
+  }
+  ticks++;
+}
+
+void IndicatorUniverse::ResetVwap() {
+  fill(pv.begin(), pv.end(), 0.0);
+  fill(vol.begin(), vol.end(), 0.0);
+}
+
+IndicatorValues IndicatorUniverse::Values(size_t i) const {
+  return IndicatorValues{sma[i],   ema[i], vwap[i], upper[i],
+                         lower[i], rsi[i], low[i],  high[i]};
+}
+
+} // namespace Core
@@ -0,0 +1,246 @@
+#include "Ledger.h"
+
+#include <atomic>
+#include <sqlite3.h>
+#include <thread>
+#include <unordered_map>
+
+using namespace std;
+
+namespace Core {
+
+const char Ledger::kCash[] = "@CASH";
+const char Ledger::kMarket[] = "@MARKET";
+const char Ledger::kEquity[] = "@EQUITY";
+
+namespace {
+
+bool TableExists(sqlite3 *db, const char *table) {
+  sqlite3_stmt *s;
+  if (sqlite3_prepare_v2(db,
+                         "SELECT 1 FROM sqlite_master WHERE type='table' AND "
+                         "name=?;",
+                         -1, &s, 0) != SQLITE_OK)
+    return false;
+  sqlite3_bind_text(s, 1, table, -1, SQLITE_STATIC);
+  bool found = sqlite3_step(s) == SQLITE_ROW;
+  sqlite3_finalize(s);
+  return found;
+}
+
+// Sums over one worker's share of the entry-id chunks.
+struct Partial {
+  unordered_map<string, int64_t> sums;
+  size_t entries = 0, postings = 0, unbalanced = 0;
+  bool ok = true;
+};
+
+} // namespace
+
+Ledger::~Ledger() { Detach(); }
+
+bool Ledger::Attach(sqlite3 *connection, const string &balances) {
+  Detach();
+  db = connection;
+  balancesSql = balances;
+  bool fresh = !TableExists(db, "ledger_entries");
+  if (sqlite3_exec(db, "SAVEPOINT ledger_install;", 0, 0, 0) != SQLITE_OK)
+    return false;
+  bool ok =
+      sqlite3_exec(db,
+                   "CREATE TABLE IF NOT EXISTS ledger_entries (id INTEGER "
+                   "PRIMARY KEY AUTOINCREMENT, kind TEXT NOT NULL, created_at "
+                   "DATETIME DEFAULT CURRENT_TIMESTAMP);"
+                   "CREATE TABLE IF NOT EXISTS ledger_postings (entry_id "
+                   "INTEGER NOT NULL, leg INTEGER NOT NULL, account TEXT NOT "
+                   "NULL, amount INTEGER NOT NULL, PRIMARY KEY(entry_id, "
+                   "leg)) WITHOUT ROWID;",
+                   0, 0, 0) == SQLITE_OK &&
+      sqlite3_prepare_v3(db, "INSERT INTO ledger_entries (kind) VALUES (?);",
+                         -1, SQLITE_PREPARE_PERSISTENT, &insertEntry,
+                         0) == SQLITE_OK &&
+      sqlite3_prepare_v3(db,
+                         "INSERT INTO ledger_postings (entry_id, leg, "
+                         "account, amount) VALUES (?,?,?,?);",
+                         -1, SQLITE_PREPARE_PERSISTENT, &insertPosting,
+                         0) == SQLITE_OK;
+
+  if (ok && fresh) {
+    vector<Posting> opening;
+    sqlite3_stmt *s;
+    ok = sqlite3_prepare_v2(db, balancesSql.c_str(), -1, &s, 0) == SQLITE_OK;
+    if (ok) {
+      while (sqlite3_step(s) == SQLITE_ROW) {
+        const char *acc = (const char *)sqlite3_column_text(s, 0);
+        Money bal;
+        if (acc && Money::FromPaise(sqlite3_column_int64(s, 1), &bal) &&
+            bal != Money())
+          opening.push_back({acc, bal});
+      }
+      sqlite3_finalize(s);
+    }
+    for (size_t i = 0; ok && i < opening.size(); i++) {
+      Posting legs[2] = {opening[i],
+                         {kEquity, opening[i].amount.Negated()}};
+      ok = Post("OPENING", legs, 2);
+    }
+  }
+  if (!ok)
+    sqlite3_exec(db, "ROLLBACK TO ledger_install;", 0, 0, 0);
+  sqlite3_exec(db, "RELEASE ledger_install;", 0, 0, 0);
+  if (!ok)
+    Detach();
+  return ok;
+}
+
+void Ledger::Detach() {
+  sqlite3_finalize(insertEntry);
+  sqlite3_finalize(insertPosting);
+  insertEntry = insertPosting = nullptr;
+  db = nullptr;
+}
+
+bool Ledger::Post(const char *kind, const Posting *legs, size_t n) {
+  if (!insertEntry || n < 2)
+    return false;
+  Money sum;
+  for (size_t i = 0; i < n; i++)
+    if (!sum.Add(legs[i].amount, &sum))
+      return false;
+  if (sum != Money())
+    return false;
+
+  sqlite3_bind_text(insertEntry, 1, kind, -1, SQLITE_STATIC);
+  bool ok = sqlite3_step(insertEntry) == SQLITE_DONE;
+  sqlite3_reset(insertEntry);
+  sqlite3_clear_bindings(insertEntry);
+  sqlite3_int64 entry = sqlite3_last_insert_rowid(db);
+  for (size_t i = 0; ok && i < n; i++) {
+    sqlite3_bind_int64(insertPosting, 1, entry);
+    sqlite3_bind_int(insertPosting, 2, (int)i);
+    sqlite3_bind_text(insertPosting, 3, legs[i].account.c_str(), -1,
+                      SQLITE_TRANSIENT);
+    sqlite3_bind_int64(insertPosting, 4, legs[i].amount.Paise());
+    ok = sqlite3_step(insertPosting) == SQLITE_DONE;
+    sqlite3_reset(insertPosting);
+    sqlite3_clear_bindings(insertPosting);
+  }
+  return ok;
+}
+
+bool Ledger::Verify(unsigned threads, LedgerReport *report) {
+  *report = LedgerReport();
+  if (!db)
+    return false;
+  sqlite3_int64 maxId = 0;
+  sqlite3_stmt *s;
+  if (sqlite3_prepare_v2(db, "SELECT COALESCE(MAX(id), 0) FROM ledger_entries;",
+                         -1, &s, 0) != SQLITE_OK)
+    return false;
+  if (sqlite3_step(s) == SQLITE_ROW)
+    maxId = sqlite3_column_int64(s, 0);
+  sqlite3_finalize(s);
+
+  // Extra connections need a file to open.
+  const char *path = sqlite3_db_filename(db, "main");
+  if (!path || !*path || threads == 0)
+    threads = 1;
+  const size_t chunks = threads * 4;
+  const sqlite3_int64 chunkSize = maxId / (sqlite3_int64)chunks + 1;
+  vector<Partial> parts(threads);
+  atomic<size_t> nextChunk{0};
+
+  auto work = [&](unsigned t) {
+    Partial &p = parts[t];
+    sqlite3 *conn = db;
+    if (threads > 1 &&
+        sqlite3_open_v2(path, &conn, SQLITE_OPEN_READONLY, nullptr) !=
+            SQLITE_OK) {
+      sqlite3_close(conn);
+      p.ok = false;
+      return;
+    }
+    sqlite3_stmt *q;
+    if (sqlite3_prepare_v2(conn,
+                           "SELECT entry_id, account, amount FROM "
+                           "ledger_postings WHERE entry_id >= ? AND entry_id "
+                           "< ? ORDER BY entry_id;",
+                           -1, &q, 0) != SQLITE_OK) {
+      p.ok = false;
+    } else {
+      for (size_t c; (c = nextChunk++) < chunks;) {
+        sqlite3_int64 lo = (sqlite3_int64)c * chunkSize + 1;
+        sqlite3_bind_int64(q, 1, lo);
+        sqlite3_bind_int64(q, 2, lo + chunkSize);
+        sqlite3_int64 entry = -1;
+        int64_t entrySum = 0;
+        while (sqlite3_step(q) == SQLITE_ROW) {
+          sqlite3_int64 id = sqlite3_column_int64(q, 0);
+          const char *acc = (const char *)sqlite3_column_text(q, 1);
+          int64_t amount = sqlite3_column_int64(q, 2);
+          if (id != entry) {
+            if (entry != -1 && entrySum != 0)
+              p.unbalanced++;
+            entry = id;
+            entrySum = 0;
+            p.entries++;
+          }
+          entrySum += amount;
+          p.postings++;
+          p.sums[acc ? acc : ""] += amount;
+        }
+        if (entry != -1 && entrySum != 0)
+          p.unbalanced++;
+        sqlite3_reset(q);
+      }
+      sqlite3_finalize(q);
+    }
+    if (conn != db)
+      sqlite3_close(conn);
+  };
+
+  if (threads == 1) {
+    work(0);
+  } else {
+    vector<thread> pool;
+    for (unsigned t = 0; t < threads; t++)
+      pool.emplace_back(work, t);
+    for (auto &th : pool)
+      th.join();
+  }
+
+  unordered_map<string, int64_t> total;
+  for (Partial &p : parts) {
+    if (!p.ok)
+      return false;
+    report->entries += p.entries;
+    report->postings += p.postings;
+    report->unbalancedEntries += p.unbalanced;
+    for (auto &kv : p.sums)
+      total[kv.first] += kv.second;
+  }
+
+  if (sqlite3_prepare_v2(db, balancesSql.c_str(), -1, &s, 0) != SQLITE_OK)
+    return false;
+  while (sqlite3_step(s) == SQLITE_ROW) {
+    const char *acc = (const char *)sqlite3_column_text(s, 0);
+    string key = acc ? acc : "";
+    int64_t projected = sqlite3_column_int64(s, 1);
+    report->accounts++;
+    auto it = total.find(key);
+    int64_t derived = it == total.end() ? 0 : it->second;
+    if (derived != projected)
+      report->mismatched.push_back(key);
+    if (it != total.end())
+      total.erase(it);
+  }
+  sqlite3_finalize(s);
+  // Whatever is left was posted to accounts that have no row; only the
+  // system accounts are allowed to be like that.
+  for (auto &kv : total)
+    if (kv.second != 0 && (kv.first.empty() || kv.first[0] != '@'))
+      report->mismatched.push_back(kv.first);
+  return true;
+}
+
+} // namespace Core
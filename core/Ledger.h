@@ -0,0 +1,71 @@
+#pragma once
+
+#include "Money.h"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+struct sqlite3;
+struct sqlite3_stmt;
+
+namespace Core {
+
+// One leg of a ledger entry: positive credits the account, negative debits
+// it. The legs of an entry always sum to zero.
+struct Posting {
+  std::string account;
+  Money amount;
+};
+
+struct LedgerReport {
+  size_t entries, postings;
+  size_t accounts;          // projected balances compared
+  size_t unbalancedEntries; // entries whose legs do not sum to zero
+  std::vector<std::string> mismatched; // projection differs from postings
+  bool Ok() const { return unbalancedEntries == 0 && mismatched.empty(); }
+};
+
+// Append-only double-entry journal kept next to the accounts table:
+// ledger_entries(id, kind, created_at) and
+// ledger_postings(entry_id, leg, account, amount), the latter clustered by
+// entry. accounts.balance is the projection of the postings; whoever posts
+// an entry updates the affected balances in the same savepoint, so a post
+// touches only those rows.
+//
+// Money entering or leaving the vault is booked against system accounts,
+// which have no accounts row: kCash for deposits and withdrawals, kMarket
+// for trades, kEquity for opening balances and manual adjustments.
+class Ledger {
+  sqlite3 *db = nullptr;
+  sqlite3_stmt *insertEntry = nullptr, *insertPosting = nullptr;
+  std::string balancesSql;
+
+public:
+  static const char kCash[], kMarket[], kEquity[];
+
+  Ledger() {}
+  ~Ledger();
+  Ledger(const Ledger &) = delete;
+  Ledger &operator=(const Ledger &) = delete;
+
+  // Creates the ledger tables if needed. When they are new, every existing
+  // account with a balance gets an opening entry against kEquity so the
+  // projection starts out consistent. balances is a query returning
+  // (account number, balance) for all accounts in this schema.
+  bool Attach(sqlite3 *connection, const std::string &balances);
+  void Detach();
+
+  // Appends one entry; false (and nothing written) if the legs do not
+  // balance or an insert fails, in which case the caller rolls back.
+  bool Post(const char *kind, const Posting *legs, size_t n);
+
+  // Recomputes every balance from the postings and compares it with the
+  // projection. Entry-id ranges are summed in parallel on up to `threads`
+  // read-only connections (one pass on this connection for in-memory
+  // databases). Writers must be held off meanwhile; VaultDB::VerifyLedger
+  // does that. False if the postings could not be read.
+  bool Verify(unsigned threads, LedgerReport *report);
+};
+
+} // namespace Core
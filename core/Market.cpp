@@ -0,0 +1,32 @@
+#include "Market.h"
+
+#include <cstdlib>
+
+using namespace std;
+
+namespace Core {
+
+vector<Stock> DefaultMarket(size_t historyDepth) {
+  vector<Stock> stocks = {
+      {"NVDA", "NVIDIA Corp", 880.50, {850, 860, 875, 870, 890, 885, 880}},
+      {"AAPL", "Apple Inc", 172.10, {170, 171, 175, 173, 174, 172, 172}},
+      {"TSLA", "Tesla Inc", 165.40, {180, 175, 170, 168, 160, 162, 165}},
+      {"BTC",
+       "Bitcoin",
+       65400.0,
+       {62000, 63000, 66000, 64000, 68000, 67000, 65400}},
+      {"ETH", "Ethereum", 3500.2, {3200, 3300, 3600, 3400, 3700, 3600, 3500}}};
+  for (Stock &s : stocks)
+    s.history.Resize(historyDepth);
+  return stocks;
+}
+
+void TickMarket(vector<Stock> &stocks) {
+  for (auto &s : stocks) {
+    float dev = ((rand() % 20) - 10) / 100.0f;
+    s.price *= (1.0f + dev);
+    s.history.Push((float)s.price);
+  }
+}
+
+} // namespace Core
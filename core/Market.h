@@ -0,0 +1,28 @@
+#pragma once
+
+#include "RingBuffer.h"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace Core {
+
+// Price points kept per stock unless DefaultMarket is told otherwise.
+const size_t kHistoryDepth = 2048;
+
+struct Stock {
+  std::string symbol, name;
+  double price;
+  RingBuffer<float> history; // oldest first, with running min/max
+};
+
+// The five instruments the stock portal lists, with their seed history, each
+// keeping the last historyDepth prices.
+std::vector<Stock> DefaultMarket(size_t historyDepth = kHistoryDepth);
+
+// One random-walk step: each price moves by up to +/-10% and the move is
+// appended to its history.
+void TickMarket(std::vector<Stock> &stocks);
+
+} // namespace Core
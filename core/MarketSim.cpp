@@ -0,0 +1,109 @@
+#include "MarketSim.h"
+
+#include "Random.h"
+
+#include <chrono>
+#include <cmath>
+
+using namespace std;
+
+namespace Core {
+
+MarketSim::MarketSim(const MarketSimConfig &config) : cfg(config) {}
+
+MarketSim::~MarketSim() { Stop(); }
+
+size_t MarketSim::Add(const string &symbol, double price, double annualDrift,
+                      double annualVol) {
+  symbols.push_back(symbol);
+  logPrice.push_back((float)log(price > 0 ? price : 0.01));
+  drift.push_back(
+      (float)((annualDrift - 0.5 * annualVol * annualVol) * cfg.dtYears));
+  vol.push_back((float)(annualVol * sqrt(cfg.dtYears)));
+  normals.resize((symbols.size() + 3) / 4 * 4);
+  lock_guard<mutex> guard(publishLock);
+  published.push_back(logPrice.back());
+  return symbols.size() - 1;
+}
+
+void MarketSim::AddMarket(const vector<Stock> &stocks, double annualDrift,
+                          double annualVol) {
+  for (const Stock &s : stocks)
+    Add(s.symbol, s.price, annualDrift, annualVol);
+}
+
+void MarketSim::Step() {
+  size_t n = symbols.size(), blocks = normals.size() / 4;
+  uint32_t key[2] = {(uint32_t)cfg.seed, (uint32_t)(cfg.seed >> 32)};
+  uint32_t t0 = (uint32_t)ticks, t1 = (uint32_t)(ticks >> 32);
+  // One Philox block gives four normals; they land a quarter of the array
+  // apart so every store is contiguous.
+  float *z = normals.data();
+  for (size_t b = 0; b < blocks; b++) {
+    uint32_t counter[4] = {(uint32_t)b, (uint32_t)(b >> 32), t0, t1}, w[4];
+    Philox4x32(counter, key, w);
+    NormalPair(w[0], w[1], &z[b], &z[blocks + b]);
+    NormalPair(w[2], w[3], &z[2 * blocks + b], &z[3 * blocks + b]);
+  }
+  float *lp = logPrice.data();
+  const float *d = drift.data(), *v = vol.data();
+  for (size_t i = 0; i < n; i++)
+    lp[i] += d[i] + v[i] * z[i];
+  ticks++;
+  Publish();
+}
+
+void MarketSim::Publish() {
+  lock_guard<mutex> guard(publishLock);
+  published = logPrice;
+  publishedTick.store(ticks, memory_order_release);
+}
+
+void MarketSim::Run(unsigned intervalMillis) {
+  unique_lock<mutex> guard(runLock);
+  while (!stopping) {
+    guard.unlock();
+    Step();
+    guard.lock();
+    if (intervalMillis)
+      wake.wait_for(guard, chrono::milliseconds(intervalMillis),
+                    [&] { return stopping; });
+  }
+}
+
+void MarketSim::Start(unsigned intervalMillis) {
+  if (ticker.joinable())
+    return;
+  stopping = false;
+  ticker = thread(&MarketSim::Run, this, intervalMillis);
+}
+
+void MarketSim::Stop() {
+  if (!ticker.joinable())
+    return;
+  {
+    lock_guard<mutex> guard(runLock);
+    stopping = true;
+    wake.notify_one();
+  }
+  ticker.join();
+}
+
+uint64_t MarketSim::Snapshot(vector<double> *prices) const {
+  uint64_t tick;
+  {
+    lock_guard<mutex> guard(publishLock);
+    prices->assign(published.begin(), published.end());
+    tick = publishedTick.load(memory_order_relaxed);
+  }
+  for (double &p : *prices)
+    p = exp(p);
+  return tick;
+}
+
+double MarketSim::Price(size_t i) const {
+  lock_guard<mutex> guard(publishLock);
+  return i < published.size() ? exp((double)published[i]) : 0;
+}
+
+} // namespace Core
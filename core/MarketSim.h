@@ -0,0 +1,84 @@
+#pragma once
+
+#include "Market.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace Core {
+
+struct MarketSimConfig {
+  uint64_t seed = 1;
+  double dtYears = 1.0 / 252; // simulated time per tick: a trading day
+};
+
+// Geometric Brownian motion for any number of symbols:
+//   log S += (mu - sigma^2 / 2) dt + sigma sqrt(dt) Z
+// State is a structure of arrays (log price, per-tick drift, per-tick
+// volatility), so a tick is two branch-free passes over contiguous floats:
+// normals from Philox4x32 keyed by the seed and counted by (tick, block),
+// then a multiply-add per symbol. Both passes vectorize. The same seed
+// gives the same paths whatever thread runs them.
+//
+// Step() may be called directly, or Start() runs it on a dedicated thread.
+// Either way readers only see the prices published after each whole tick.
+class MarketSim {
+  MarketSimConfig cfg;
+  std::vector<std::string> symbols;
+  std::vector<float> logPrice, drift, vol; // by symbol
+  std::vector<float> normals;              // scratch, padded to blocks of 4
+  uint64_t ticks = 0;
+
+  mutable std::mutex publishLock; // guards published and publishedTick
+  std::vector<float> published;   // log prices after the last whole tick
+  std::atomic<uint64_t> publishedTick{0};
+
+  std::mutex runLock;
+  std::condition_variable wake;
+  bool stopping = false;
+  std::thread ticker;
+
+  void Publish();
+  void Run(unsigned intervalMillis);
+
+public:
+  explicit MarketSim(const MarketSimConfig &config = MarketSimConfig());
+  // Stops the ticker thread.
+  ~MarketSim();
+  MarketSim(const MarketSim &) = delete;
+  MarketSim &operator=(const MarketSim &) = delete;
+
+  // Adds a symbol at price rupees with annualised drift and volatility and
+  // returns its index. Only while the ticker is stopped.
+  size_t Add(const std::string &symbol, double price, double annualDrift,
+             double annualVol);
+  // Adds each stock with the same drift and volatility.
+  void AddMarket(const std::vector<Stock> &stocks, double annualDrift,
+                 double annualVol);
+  size_t Size() const { return symbols.size(); }
+  const std::string &Symbol(size_t i) const { return symbols[i]; }
+
+  // Advances every symbol one tick on the calling thread. Only while the
+  // ticker is stopped.
+  void Step();
+  // Ticks every intervalMillis (0: back to back) until Stop().
+  void Start(unsigned intervalMillis);
+  void Stop();
+
+  // Ticks published so far.
+  uint64_t Ticks() const {
+    return publishedTick.load(std::memory_order_acquire);
+  }
+  // Copies every price (rupees) as of the last whole tick and returns that
+  // tick.
+  uint64_t Snapshot(std::vector<double> *prices) const;
+  double Price(size_t i) const;
+};
+
+} // namespace Core
@@ -0,0 +1,76 @@
+#include "Money.h"
+
+#include <cmath>
+#include <cstdio>
+
+using namespace std;
+
+namespace Core {
+
+bool Money::FromRupees(double rupees, Money *out) {
+  double p = rupees * 100.0;
+  if (!(fabs(p) <= (double)kMaxPaise))
+    return false;
+  return FromPaise(llround(p), out);
+}
+
+bool Money::Parse(const string &text, Money *out) {
+  size_t i = 0;
+  bool neg = false;
+  if (i < text.size() && text[i] == '-') {
+    neg = true;
+    i++;
+  }
+  int64_t whole = 0;
+  size_t digits = 0;
+  for (; i < text.size() && text[i] >= '0' && text[i] <= '9'; i++, digits++) {
+    whole = whole * 10 + (text[i] - '0');
+    if (whole > kMaxPaise / 100)
+      return false;
+  }
+  int64_t frac = 0;
+  if (i < text.size() && text[i] == '.') {
+    i++;
+    int places = 0;
+    for (; i < text.size() && text[i] >= '0' && text[i] <= '9'; i++) {
+      if (++places > 2)
+        return false;
+      frac = frac * 10 + (text[i] - '0');
+      digits++;
+    }
+    if (places == 1)
+      frac *= 10;
+  }
+  if (i != text.size() || digits == 0)
+    return false;
+  int64_t p = whole * 100 + frac;
+  return FromPaise(neg ? -p : p, out);
+}
+
+string Money::ToString() const {
+  int64_t a = paise < 0 ? -paise : paise;
+  char buf[32];
+  snprintf(buf, sizeof buf, "%s%lld.%02lld", paise < 0 ? "-" : "",
+           (long long)(a / 100), (long long)(a % 100));
+  return buf;
+}
+
+bool SumMoney(const Money *values, size_t n, Money *total) {
+  // 1024 * kMaxPaise < 2^63, so a block can be summed unchecked.
+  const size_t kBlock = 1024;
+  Money acc;
+  for (size_t base = 0; base < n; base += kBlock) {
+    size_t end = base + kBlock < n ? base + kBlock : n;
+    int64_t block = 0;
+    for (size_t i = base; i < end; i++)
+      block += values[i].Paise();
+    int64_t sum;
+    if (__builtin_add_overflow(acc.Paise(), block, &sum) ||
+        !Money::FromPaise(sum, &acc))
+      return false;
+  }
+  *total = acc;
+  return true;
+}
+
+} // namespace Core
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace Core {
+
+// An amount of rupees held as a whole number of paise. Every way of building
+// or combining a Money is checked against +/-kMaxPaise, which keeps values
+// exactly representable as double and lets SumMoney add blocks of them with
+// plain (vectorizable) integer adds that cannot overflow.
+class Money {
+  int64_t paise;
+
+  explicit constexpr Money(int64_t p) : paise(p) {}
+
+public:
+  static constexpr int64_t kMaxPaise = (int64_t(1) << 53) - 1;
+
+  constexpr Money() : paise(0) {}
+
+  static bool FromPaise(int64_t p, Money *out) {
+    if (p > kMaxPaise || p < -kMaxPaise)
+      return false;
+    *out = Money(p);
+    return true;
+  }
+  // Rounds to the nearest paisa; rejects NaN and out-of-range values.
+  static bool FromRupees(double rupees, Money *out);
+  // Accepts "[-]digits[.d[d]]" - at most two decimals, nothing else.
+  static bool Parse(const std::string &text, Money *out);
+
+  int64_t Paise() const { return paise; }
+  double Rupees() const { return paise / 100.0; }
+  // "-1234.50"
+  std::string ToString() const;
+
+  bool Add(Money o, Money *out) const {
+    return FromPaise(paise + o.paise, out);
+  }
+  bool Sub(Money o, Money *out) const {
+    return FromPaise(paise - o.paise, out);
+  }
+  bool Mul(int64_t n, Money *out) const {
+    int64_t r;
+    if (__builtin_mul_overflow(paise, n, &r))
+      return false;
+    return FromPaise(r, out);
+  }
+
+  // Always in range: the limits are symmetric.
+  Money Negated() const { return Money(-paise); }
+
+  bool IsPositive() const { return paise > 0; }
+  bool IsNegative() const { return paise < 0; }
+
+  friend bool operator==(Money a, Money b) { return a.paise == b.paise; }
+  friend bool operator!=(Money a, Money b) { return a.paise != b.paise; }
+  friend bool operator<(Money a, Money b) { return a.paise < b.paise; }
+  friend bool operator<=(Money a, Money b) { return a.paise <= b.paise; }
+  friend bool operator>(Money a, Money b) { return a.paise > b.paise; }
+  friend bool operator>=(Money a, Money b) { return a.paise >= b.paise; }
+};
+
+// Exact total of n amounts; false if the running total leaves Money's range.
+bool SumMoney(const Money *values, size_t n, Money *total);
+
+} // namespace Core
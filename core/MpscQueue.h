@@ -0,0 +1,56 @@
+#pragma once
+
+#include <atomic>
+#include <utility>
+
+namespace Core {
+
+// Unbounded multi-producer, single-consumer FIFO (Vyukov's node queue).
+// Push is wait-free apart from the node allocation: one atomic exchange
+// plus a release store. Only one thread may call Pop/Empty at a time.
+//
+// A push is visible to the consumer once its link store lands; between the
+// exchange and that store Pop may briefly report the queue empty.
+template <class T> class MpscQueue {
+  struct Node {
+    std::atomic<Node *> next{nullptr};
+    T value;
+  };
+
+  std::atomic<Node *> head; // most recently pushed node; producers swap here
+  Node *tail;               // consumed dummy whose successor is the front
+
+public:
+  MpscQueue() : head(new Node), tail(head.load()) {}
+  ~MpscQueue() {
+    T drop;
+    while (Pop(&drop)) {
+    }
+    delete tail;
+  }
+  MpscQueue(const MpscQueue &) = delete;
+  MpscQueue &operator=(const MpscQueue &) = delete;
+
+  void Push(T value) {
+    Node *n = new Node;
+    n->value = std::move(value);
+    Node *prev = head.exchange(n, std::memory_order_acq_rel);
+    prev->next.store(n, std::memory_order_release);
+  }
+
+  bool Pop(T *out) {
+    Node *next = tail->next.load(std::memory_order_acquire);
+    if (!next)
+      return false;
+    *out = std::move(next->value);
+    delete tail;
+    tail = next; // becomes the new dummy
+    return true;
+  }
+
+  bool Empty() const {
+    return tail->next.load(std::memory_order_acquire) == nullptr;
+  }
+};
+
+} // namespace Core
@@ -0,0 +1,196 @@
+#include "OrderBook.h"
+
+using namespace std;
+
+namespace Core {
+
+namespace {
+
+unsigned LowBit(uint64_t w) { return (unsigned)__builtin_ctzll(w); }
+unsigned HighBit(uint64_t w) { return 63u - (unsigned)__builtin_clzll(w); }
+
+} // namespace
+
+OrderBook::OrderBook(uint32_t levels) : levelCount(levels ? levels : 1) {
+  for (Ladder &l : sides) {
+    l.levels.assign(levelCount, Level{kNil, kNil, 0});
+    l.occupied.assign((levelCount + 63) / 64, 0);
+  }
+}
+
+uint32_t OrderBook::Alloc() {
+  if (freeList == kNil) {
+    pool.push_back(Order());
+    return (uint32_t)pool.size() - 1;
+  }
+  uint32_t slot = freeList;
+  freeList = pool[slot].next;
+  return slot;
+}
+
+// Takes the order off its level and returns the slot to the free list.
+void OrderBook::Unlink(uint32_t slot) {
+  Order &o = pool[slot];
+  Ladder &l = sides[o.side];
+  Level &lv = l.levels[o.tick];
+  if (o.prev != kNil)
+    pool[o.prev].next = o.next;
+  else
+    lv.head = o.next;
+  if (o.next != kNil)
+    pool[o.next].prev = o.prev;
+  else
+    lv.tail = o.prev;
+  lv.quantity -= o.quantity;
+  if (lv.head == kNil) {
+    l.occupied[o.tick / 64] &= ~(uint64_t(1) << (o.tick % 64));
+    if (l.best == o.tick)
+      l.best = NextBest(o.side, o.tick);
+  }
+  o.id = 0;
+  o.next = freeList;
+  freeList = slot;
+  resting--;
+}
+
+// Best non-empty level on side strictly beyond from: lower for bids,
+// higher for asks.
+uint32_t OrderBook::NextBest(Side side, uint32_t from) const {
+  const vector<uint64_t> &bits = sides[side].occupied;
+  if (side == BUY) {
+    if (from == 0)
+      return kNil;
+    uint32_t t = from - 1;
+    size_t w = t / 64;
+    uint64_t word = bits[w] & (~uint64_t(0) >> (63 - t % 64));
+    while (!word) {
+      if (w == 0)
+        return kNil;
+      word = bits[--w];
+    }
+    return (uint32_t)(w * 64 + HighBit(word));
+  }
+  uint32_t t = from + 1;
+  if (t >= levelCount)
+    return kNil;
+  size_t w = t / 64;
+  uint64_t word = bits[w] & (~uint64_t(0) << (t % 64));
+  while (!word) {
+    if (++w == bits.size())
+      return kNil;
+    word = bits[w];
+  }
+  return (uint32_t)(w * 64 + LowBit(word));
+}
+
+// Takes liquidity from the side opposite taker at ticks no worse than
+// limit, oldest order first within a level. Returns what is left.
+uint32_t OrderBook::Match(Side taker, uint32_t owner, uint64_t takerId,
+                          uint32_t limit, uint32_t quantity,
+                          vector<BookMatch> *matches) {
+  Ladder &other = sides[taker == BUY ? SELL : BUY];
+  while (quantity && other.best != kNil &&
+         (taker == BUY ? other.best <= limit : other.best >= limit)) {
+    Level &lv = other.levels[other.best];
+    Order &maker = pool[lv.head];
+    uint32_t q = maker.quantity < quantity ? maker.quantity : quantity;
+    if (matches)
+      matches->push_back(BookMatch{maker.id, takerId, maker.owner, owner,
+                                   maker.tick, q, maker.quantity - q, taker});
+    quantity -= q;
+    if (q == maker.quantity) {
+      Unlink(lv.head);
+    } else {
+      maker.quantity -= q;
+      lv.quantity -= q;
+    }
+  }
+  return quantity;
+}
+
+uint64_t OrderBook::Limit(Side side, uint32_t owner, uint32_t tick,
+                          uint32_t quantity, vector<BookMatch> *matches,
+                          uint32_t *left) {
+  *left = 0;
+  if (tick >= levelCount || quantity == 0)
+    return 0;
+  // Sequence in the high half, so ids rise with arrival time; pool slot in
+  // the low half, so Cancel needs no lookup table. The slot is taken first
+  // so matches carry the same id the order rests under.
+  uint32_t slot = Alloc();
+  uint64_t id = (nextSeq++ << 32) | slot;
+  pool[slot].id = 0;
+  quantity = Match(side, owner, id, tick, quantity, matches);
+  if (quantity == 0) {
+    pool[slot].next = freeList;
+    freeList = slot;
+    return id;
+  }
+
+  Ladder &l = sides[side];
+  Level &lv = l.levels[tick];
+  Order &o = pool[slot];
+  o = Order{id, lv.tail, kNil, owner, quantity, tick, side};
+  if (lv.tail != kNil)
+    pool[lv.tail].next = slot;
+  else
+    lv.head = slot;
+  lv.tail = slot;
+  lv.quantity += quantity;
+  l.occupied[tick / 64] |= uint64_t(1) << (tick % 64);
+  if (l.best == kNil || (side == BUY ? tick > l.best : tick < l.best))
+    l.best = tick;
+  resting++;
+  *left = quantity;
+  return id;
+}
+
+uint32_t OrderBook::Market(Side side, uint32_t owner, uint32_t quantity,
+                           vector<BookMatch> *matches) {
+  uint64_t id = (nextSeq++ << 32) | kNil;
+  return quantity - Match(side, owner, id, side == BUY ? levelCount - 1 : 0,
+                          quantity, matches);
+}
+
+bool OrderBook::Cancel(uint64_t id, uint32_t *left) {
+  uint32_t slot = (uint32_t)id;
+  if (id == 0 || slot >= pool.size() || pool[slot].id != id)
+    return false;
+  *left = pool[slot].quantity;
+  Unlink(slot);
+  return true;
+}
+
+bool OrderBook::BestBid(uint32_t *tick) const {
+  *tick = sides[BUY].best;
+  return *tick != kNil;
+}
+
+bool OrderBook::BestAsk(uint32_t *tick) const {
+  *tick = sides[SELL].best;
+  return *tick != kNil;
+}
+
+uint64_t OrderBook::Depth(Side side, uint32_t tick) const {
+  return tick < levelCount ? sides[side].levels[tick].quantity : 0;
+}
+
+uint32_t OrderBook::Sweep(Side side, uint32_t limit, uint32_t quantity,
+                          uint64_t *tickQuantity) const {
+  Side other = side == BUY ? SELL : BUY;
+  uint32_t filled = 0;
+  *tickQuantity = 0;
+  for (uint32_t t = sides[other].best;
+       t != kNil && filled < quantity &&
+       (side == BUY ? t <= limit : t >= limit);
+       t = NextBest(other, t)) {
+    uint64_t avail = sides[other].levels[t].quantity;
+    uint32_t q =
+        avail < quantity - filled ? (uint32_t)avail : quantity - filled;
+    filled += q;
+    *tickQuantity += (uint64_t)t * q;
+  }
+  return filled;
+}
+
+} // namespace Core
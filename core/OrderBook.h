@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Core {
+
+enum Side : uint8_t { BUY, SELL };
+
+// One execution: taker crossed the spread and traded with the resting order
+// maker, at the maker's price. makerLeft is what still rests of the maker;
+// at 0 it has left the book.
+struct BookMatch {
+  uint64_t maker, taker;
+  uint32_t makerOwner, takerOwner;
+  uint32_t tick;
+  uint32_t quantity, makerLeft;
+  Side takerSide;
+};
+
+// Price-time priority limit order book for one symbol. Prices are ticks:
+// level t stands for price base + t * tickSize, for t in [0, levels).
+//
+// Each side is an array of levels indexed by tick, holding a FIFO of its
+// orders as an intrusive doubly linked list through a pooled order array,
+// plus a bitmap of non-empty levels so the next best price is found a word
+// at a time. Nothing is allocated after the pool has grown to the peak
+// number of resting orders. Not thread safe; owners are opaque to the book.
+class OrderBook {
+  static const uint32_t kNil = 0xFFFFFFFFu;
+
+  struct Order {
+    uint64_t id; // 0 while the slot is free
+    uint32_t prev, next;
+    uint32_t owner;
+    uint32_t quantity;
+    uint32_t tick;
+    Side side;
+  };
+  struct Level {
+    uint32_t head, tail;
+    uint64_t quantity;
+  };
+  struct Ladder {
+    std::vector<Level> levels;
+    std::vector<uint64_t> occupied; // one bit per level
+    uint32_t best = kNil;
+  };
+
+  uint32_t levelCount;
+  Ladder sides[2];
+  std::vector<Order> pool;
+  uint32_t freeList = kNil;
+  uint64_t nextSeq = 1;
+  size_t resting = 0;
+
+  uint32_t Alloc();
+  void Unlink(uint32_t slot);
+  uint32_t NextBest(Side side, uint32_t from) const;
+  uint32_t Match(Side taker, uint32_t owner, uint64_t takerId, uint32_t limit,
+                 uint32_t quantity, std::vector<BookMatch> *matches);
+
+public:
+  explicit OrderBook(uint32_t levels);
+  OrderBook(const OrderBook &) = delete;
+  OrderBook &operator=(const OrderBook &) = delete;
+
+  uint32_t Levels() const { return levelCount; }
+  size_t Resting() const { return resting; }
+
+  // Matches quantity against the other side down (or up) to tick, then
+  // rests what is left. Returns the order id, which rises with arrival and
+  // stays valid for Cancel() while anything rests; *left is the resting
+  // quantity. 0 if tick is outside the book or quantity is 0.
+  uint64_t Limit(Side side, uint32_t owner, uint32_t tick, uint32_t quantity,
+                 std::vector<BookMatch> *matches, uint32_t *left);
+  // Matches as much of quantity as the other side holds and drops the rest.
+  // Returns the quantity filled.
+  uint32_t Market(Side side, uint32_t owner, uint32_t quantity,
+                  std::vector<BookMatch> *matches);
+  // Removes a resting order; *left is the quantity it still had.
+  bool Cancel(uint64_t id, uint32_t *left);
+
+  bool BestBid(uint32_t *tick) const;
+  bool BestAsk(uint32_t *tick) const;
+  uint64_t Depth(Side side, uint32_t tick) const;
+  // What a taker on side would fill of quantity at ticks no worse than
+  // limit: the quantity and the sum of tick * quantity over the levels it
+  // would take, without touching the book.
+  uint32_t Sweep(Side side, uint32_t limit, uint32_t quantity,
+                 uint64_t *tickQuantity) const;
+};
+
+} // namespace Core
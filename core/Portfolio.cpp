@@ -0,0 +1,42 @@
+#include "Portfolio.h"
+
+#include <algorithm>
+
+using namespace std;
+
+namespace Core {
+
+bool PortfolioSnapshot::Refresh(VaultDB &db, const string &account) {
+  if (loaded && account == accNum && version == db.PortfolioVersion())
+    return true;
+  accNum = account;
+  version = db.PortfolioVersion();
+  loaded = db.GetPortfolio(accNum, &positions);
+  if (!loaded)
+    positions.clear();
+  return loaded;
+}
+
+const Position *PortfolioSnapshot::Find(const string &symbol) const {
+  auto it = lower_bound(
+      positions.begin(), positions.end(), symbol,
+      [](const Position &p, const string &s) { return p.symbol < s; });
+  return it != positions.end() && it->symbol == symbol ? &*it : nullptr;
+}
+
+void PortfolioSnapshot::Mark(const vector<Stock> &market) {
+  rows.resize(market.size());
+  value = pnl = 0;
+  for (size_t i = 0; i < market.size(); i++) {
+    const Position *p = Find(market[i].symbol);
+    PortfolioRow &r = rows[i];
+    r.quantity = p ? p->quantity : 0;
+    r.avgPrice = p ? p->avgPrice : 0;
+    r.value = market[i].price * r.quantity;
+    r.pnl = (market[i].price - r.avgPrice) * r.quantity;
+    value += r.value;
+    pnl += r.pnl;
+  }
+}
+
+} // namespace Core
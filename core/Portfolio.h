@@ -0,0 +1,56 @@
+#pragma once
+
+#include "Market.h"
+#include "VaultDB.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Core {
+
+// A position lined up with one row of a market list, valued at that row's
+// price.
+struct PortfolioRow {
+  int quantity;
+  double avgPrice, value, pnl;
+};
+
+// One account's positions held in memory for drawing. Refresh reads them
+// with a single query, and only when VaultDB::PortfolioVersion says a trade
+// (or a rollback) may have changed them or the account is a different one;
+// Mark then values them against current prices in one pass. Rows() and
+// the totals never touch the database.
+class PortfolioSnapshot {
+  std::string accNum;
+  uint64_t version = 0;
+  bool loaded = false;
+  std::vector<Position> positions; // by symbol
+  std::vector<PortfolioRow> rows;  // by market index, as of the last Mark
+  double value = 0, pnl = 0;
+
+public:
+  // False if the positions could not be read; the snapshot is then empty
+  // and the next Refresh tries again.
+  bool Refresh(VaultDB &db, const std::string &account);
+  // Forces the next Refresh to read.
+  void Invalidate() { loaded = false; }
+
+  const std::vector<Position> &Positions() const { return positions; }
+  // The position in symbol, or null if none.
+  const Position *Find(const std::string &symbol) const;
+
+  // Recomputes a row per stock, in market order.
+  void Mark(const std::vector<Stock> &market);
+  size_t Rows() const { return rows.size(); }
+  // Zero for rows the last Mark did not cover.
+  PortfolioRow Row(size_t i) const {
+    return i < rows.size() ? rows[i] : PortfolioRow{0, 0, 0, 0};
+  }
+  // Sums over the rows of the last Mark.
+  double MarketValue() const { return value; }
+  double Pnl() const { return pnl; }
+};
+
+} // namespace Core
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+namespace Core {
+
+// Philox4x32-10 (Salmon et al., "Parallel random numbers: as easy as 1, 2,
+// 3"): a keyed bijection of a 128-bit counter, so the numbers for any
+// (key, counter) are available in any order on any thread with no state to
+// carry. Ten rounds of two 32x32->64 multiplies; no branches or tables, so
+// loops over independent counters vectorize.
+inline void Philox4x32(const uint32_t counter[4], const uint32_t key[2],
+                       uint32_t out[4]) {
+  uint32_t c0 = counter[0], c1 = counter[1], c2 = counter[2], c3 = counter[3];
+  uint32_t k0 = key[0], k1 = key[1];
+  for (int r = 0; r < 10; r++) {
+    uint64_t p0 = (uint64_t)0xD2511F53u * c0;
+    uint64_t p1 = (uint64_t)0xCD9E8D57u * c2;
+    uint32_t n0 = (uint32_t)(p1 >> 32) ^ c1 ^ k0;
+    uint32_t n2 = (uint32_t)(p0 >> 32) ^ c3 ^ k1;
+    c1 = (uint32_t)p1;
+    c3 = (uint32_t)p0;
+    c0 = n0;
+    c2 = n2;
+    k0 += 0x9E3779B9u;
+    k1 += 0xBB67AE85u;
+  }
+  out[0] = c0;
+  out[1] = c1;
+  out[2] = c2;
+  out[3] = c3;
+}
+
+// The top 24 bits as a float in [0, 1).
+inline float UniformFloat(uint32_t bits) {
+  return (float)(int32_t)(bits >> 8) * (1.0f / 16777216.0f);
+}
+
+// Natural log for x in (0, 1], to about 1e-6. Splits off the binary
+// exponent and evaluates 2 atanh((m-1)/(m+1)) for the mantissa m in [1, 2).
+inline float FastLog(float x) {
+  uint32_t bits;
+  std::memcpy(&bits, &x, 4);
+  float e = (float)((int32_t)(bits >> 23) - 127);
+  bits = (bits & 0x007FFFFFu) | 0x3F800000u;
+  float m;
+  std::memcpy(&m, &bits, 4);
+  float t = (m - 1.0f) / (m + 1.0f), t2 = t * t;
+  float s = 2.0f / 7 + t2 * (2.0f / 9);
+  s = 2.0f / 3 + t2 * (2.0f / 5 + t2 * s);
+  s = t * (2.0f + t2 * s);
+  return e * 0.69314718f + s;
+}
+
+// sin and cos of 2 pi u for u in [0, 1), to about 4e-6: a quarter turn of
+// Taylor series, then the quadrant picks signs and order.
+inline void FastSinCosTurns(float u, float *s, float *c) {
+  float q = u * 4.0f;
+  int k = (int)q;
+  float x = (q - (float)k) * 1.57079633f, x2 = x * x;
+  float sn = x * (1 + x2 * (-1.0f / 6 + x2 * (1.0f / 120 +
+                                              x2 * (-1.0f / 5040 +
+                                                    x2 * (1.0f / 362880)))));
+  float cs = 1 + x2 * (-0.5f + x2 * (1.0f / 24 +
+                                     x2 * (-1.0f / 720 +
+                                           x2 * (1.0f / 40320 +
+                                                 x2 * (-1.0f / 3628800)))));
+  float a = (k & 1) ? cs : sn, b = (k & 1) ? sn : cs;
+  *s = (k & 2) ? -a : a;
+  *c = ((k + 1) & 2) ? -b : b;
+}
+
+// Two independent standard normals from two random words (Box-Muller).
+inline void NormalPair(uint32_t w0, uint32_t w1, float *z0, float *z1) {
+  // Shifted into (0, 1] so the log is finite.
+  float u0 = UniformFloat(w0) + 1.0f / 16777216.0f;
+  float r = std::sqrt(-2.0f * FastLog(u0));
+  float s, c;
+  FastSinCosTurns(UniformFloat(w1), &s, &c);
+  *z0 = r * c;
+  *z1 = r * s;
+}
+
+} // namespace Core
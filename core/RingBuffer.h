@@ -0,0 +1,147 @@
+#pragma once
+
+#include <cstddef>
+#include <initializer_list>
+#include <utility>
+#include <vector>
+
+namespace Core {
+
+// The last Capacity() values pushed, oldest first, in one fixed block:
+// Push overwrites the oldest value once full and never moves the others.
+// The contents are at most two contiguous runs, which Spans() hands out for
+// drawing or scanning without a copy.
+//
+// With TrackExtremes, Min() and Max() of the current contents are kept as
+// values are pushed, in amortized O(1), with the usual monotonic wedges:
+// the slots of the values that can still become the minimum (or maximum)
+// once older ones are overwritten. T then needs operator<.
+template <class T, bool TrackExtremes = true> class RingBuffer {
+public:
+  struct Span {
+    const T *data;
+    size_t size;
+  };
+
+private:
+  // A deque of slot indices in a fixed ring; never holds more than the
+  // buffer's capacity.
+  struct Wedge {
+    std::vector<size_t> at;
+    size_t head = 0, count = 0;
+
+    size_t Wrap(size_t i) const { return i >= at.size() ? i - at.size() : i; }
+    size_t Front() const { return at[head]; }
+    size_t Back() const { return at[Wrap(head + count - 1)]; }
+    void PopFront() {
+      head = Wrap(head + 1);
+      count--;
+    }
+    void PopBack() { count--; }
+    void PushBack(size_t slot) {
+      at[Wrap(head + count)] = slot;
+      count++;
+    }
+  };
+
+  std::vector<T> slots;
+  size_t next = 0, count = 0; // next slot to write; values held
+  Wedge low, high;
+
+  size_t Oldest() const { return count == slots.size() ? next : 0; }
+
+  // The full buffer is about to overwrite slot at.
+  void Expire(size_t at) {
+    if (low.count && low.Front() == at)
+      low.PopFront();
+    if (high.count && high.Front() == at)
+      high.PopFront();
+  }
+  // Slot at was just written: older values it beats can never be the
+  // extreme again.
+  void Admit(size_t at) {
+    const T &v = slots[at];
+    while (low.count && !(slots[low.Back()] < v))
+      low.PopBack();
+    while (high.count && !(v < slots[high.Back()]))
+      high.PopBack();
+    low.PushBack(at);
+    high.PushBack(at);
+  }
+
+public:
+  explicit RingBuffer(size_t capacity = 0) { Reset(capacity); }
+  // Capacity is the list's length; for seeding small fixed histories.
+  RingBuffer(std::initializer_list<T> values) {
+    Reset(values.size());
+    for (const T &v : values)
+      Push(v);
+  }
+
+  // Empties the buffer and sets its capacity.
+  void Reset(size_t capacity) {
+    slots.assign(capacity, T());
+    if (TrackExtremes) {
+      low.at.assign(capacity, 0);
+      high.at.assign(capacity, 0);
+    }
+    low.head = low.count = high.head = high.count = 0;
+    next = count = 0;
+  }
+  // Changes the capacity, keeping the newest values that still fit.
+  void Resize(size_t capacity) {
+    RingBuffer resized(capacity);
+    size_t keep = count < capacity ? count : capacity;
+    for (size_t i = count - keep; i < count; i++)
+      resized.Push((*this)[i]);
+    *this = std::move(resized);
+  }
+
+  size_t Capacity() const { return slots.size(); }
+  size_t Size() const { return count; }
+  bool Empty() const { return count == 0; }
+
+  // Does nothing at capacity 0.
+  void Push(const T &v) {
+    size_t cap = slots.size();
+    if (cap == 0)
+      return;
+    size_t at = next;
+    if (count < cap)
+      count++;
+    else if constexpr (TrackExtremes)
+      Expire(at);
+    slots[at] = v;
+    next = at + 1 == cap ? 0 : at + 1;
+    if constexpr (TrackExtremes)
+      Admit(at);
+  }
+
+  // i = 0 is the oldest value.
+  const T &operator[](size_t i) const {
+    size_t at = Oldest() + i;
+    return slots[at >= slots.size() ? at - slots.size() : at];
+  }
+  const T &Back() const { return slots[next ? next - 1 : slots.size() - 1]; }
+  // Of the current contents; only when not Empty().
+  const T &Min() const {
+    static_assert(TrackExtremes, "extremes are not tracked");
+    return slots[low.Front()];
+  }
+  const T &Max() const {
+    static_assert(TrackExtremes, "extremes are not tracked");
+    return slots[high.Front()];
+  }
+
+  // The contents oldest first as up to two runs; *second is empty unless
+  // the buffer has wrapped.
+  void Spans(Span *first, Span *second) const {
+    size_t start = Oldest(), run = slots.size() - start;
+    if (run > count)
+      run = count;
+    *first = Span{slots.data() + start, run};
+    *second = Span{slots.data(), count - run};
+  }
+};
+
+} // namespace Core
@@ -0,0 +1,209 @@
+#include "Risk.h"
+
+#include "Random.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+namespace Core {
+
+namespace {
+
+const size_t kChunk = 256;       // scenarios per generation item
+const size_t kAccountBlock = 32; // accounts per revaluation item
+const size_t kTile = 4096;       // scenarios per pass over an account
+
+// How many of the worst scenarios lie beyond the confidence level; the
+// slack keeps 0.99 of 10000 at 100 despite rounding.
+size_t TailCount(double confidence, size_t scenarios) {
+  double worst = (1 - confidence) * scenarios;
+  size_t tail = (size_t)ceil(worst - 1e-9 * scenarios);
+  return min(max<size_t>(tail, 1), scenarios);
+}
+
+// Partially sorts losses so the tail worst are last; VaR is the least of
+// them and ES their mean.
+template <class T>
+void TailOf(T *losses, size_t n, size_t tail, double *var, double *es) {
+  nth_element(losses, losses + (n - tail), losses + n);
+  double sum = 0;
+  for (size_t k = n - tail; k < n; k++)
+    sum += losses[k];
+  *var = losses[n - tail];
+  *es = sum / tail;
+}
+
+// As TailOf, selecting over far fewer values when the tail is small: a
+// strided sample gives a threshold that about twice the tail should clear,
+// a branch-free pass copies the losses that do into candidates, and the
+// exact selection runs on those. Falls back to all losses if too few clear.
+void TailOfFiltered(float *losses, size_t n, size_t tail,
+                    vector<float> &candidates, double *var, double *es) {
+  const size_t kStride = 16;
+  size_t samples = n / kStride, rank = 2 * (tail / kStride) + 8;
+  if (rank >= samples) {
+    TailOf(losses, n, tail, var, es);
+    return;
+  }
+  candidates.resize(max(samples, n));
+  float *c = candidates.data();
+  for (size_t i = 0; i < samples; i++)
+    c[i] = losses[i * kStride];
+  nth_element(c, c + (samples - rank), c + samples);
+  float threshold = c[samples - rank];
+  size_t kept = 0;
+  for (size_t k = 0; k < n; k++) {
+    c[kept] = losses[k];
+    kept += losses[k] >= threshold;
+  }
+  if (kept < tail)
+    TailOf(losses, n, tail, var, es);
+  else
+    TailOf(c, kept, tail, var, es);
+}
+
+} // namespace
+
+vector<double> UniformCovariance(const vector<double> &vols,
+                                 double correlation) {
+  size_t n = vols.size();
+  vector<double> cov(n * n);
+  for (size_t i = 0; i < n; i++)
+    for (size_t j = 0; j < n; j++)
+      cov[i * n + j] = vols[i] * vols[j] * (i == j ? 1.0 : correlation);
+  return cov;
+}
+
+bool Cholesky(vector<double> &a, size_t n) {
+  if (a.size() != n * n)
+    return false;
+  for (size_t j = 0; j < n; j++) {
+    double d = a[j * n + j];
+    for (size_t k = 0; k < j; k++)
+      d -= a[j * n + k] * a[j * n + k];
+    if (!(d > 0))
+      return false;
+    d = sqrt(d);
+    a[j * n + j] = d;
+    for (size_t i = j + 1; i < n; i++) {
+      double v = a[i * n + j];
+      for (size_t k = 0; k < j; k++)
+        v -= a[i * n + k] * a[j * n + k];
+      a[i * n + j] = v / d;
+    }
+    for (size_t k = j + 1; k < n; k++)
+      a[j * n + k] = 0;
+  }
+  return true;
+}
+
+bool RiskEngine::Run(const ValuationEngine &book, const double *prices,
+                     const RiskConfig &cfg, RiskReport *report) {
+  size_t nSymbols = book.Symbols().size(), nAccounts = book.Accounts();
+  size_t scenarios = max<size_t>(cfg.scenarios, 1);
+  vector<double> factor = cfg.covariance;
+  if (!Cholesky(factor, nSymbols))
+    return false;
+  vector<float> lower(factor.begin(), factor.end());
+
+  // Net exposure per symbol gives the book's loss without summing accounts.
+  vector<double> bookExposure(nSymbols);
+  for (size_t i = 0; i < book.Positions(); i++)
+    bookExposure[book.PositionSymbol(i)] +=
+        book.PositionQuantity(i) * prices[book.PositionSymbol(i)];
+  double sqrtH = sqrt(cfg.horizonYears);
+  vector<float> drift(nSymbols);
+  for (size_t s = 0; s < nSymbols; s++)
+    drift[s] = (float)(-0.5 * cfg.covariance[s * nSymbols + s] *
+                       cfg.horizonYears);
+
+  moves.assign(nSymbols * scenarios, 0);
+  vector<double> bookLoss(scenarios);
+  size_t blocks = (nSymbols + 3) / 4, threads = pool.Threads();
+  vector<vector<float>> normals(threads), scratch(threads);
+  vector<vector<double>> chunkLoss(threads);
+  uint32_t key[2] = {(uint32_t)cfg.seed, (uint32_t)(cfg.seed >> 32)};
+  pool.ParallelFor(
+      (scenarios + kChunk - 1) / kChunk, [&](size_t chunk, unsigned w) {
+        size_t k0 = chunk * kChunk, c = min(kChunk, scenarios - k0);
+        vector<float> &z = normals[w], &y = scratch[w];
+        vector<double> &loss = chunkLoss[w];
+        z.resize(blocks * 4 * kChunk);
+        y.resize(kChunk);
+        loss.assign(c, 0.0);
+        // Normals by symbol row, so the factor below is axpys over rows.
+        for (size_t j = 0; j < c; j++) {
+          uint64_t k = k0 + j;
+          for (size_t b = 0; b < blocks; b++) {
+            uint32_t counter[4] = {(uint32_t)b, (uint32_t)(b >> 32),
+                                   (uint32_t)k, (uint32_t)(k >> 32)};
+            uint32_t bits[4];
+            Philox4x32(counter, key, bits);
+            float *zb = z.data() + 4 * b * kChunk + j;
+            NormalPair(bits[0], bits[1], &zb[0], &zb[kChunk]);
+            NormalPair(bits[2], bits[3], &zb[2 * kChunk], &zb[3 * kChunk]);
+          }
+        }
+        for (size_t s = 0; s < nSymbols; s++) {
+          float *ys = y.data();
+          fill(ys, ys + c, 0.0f);
+          for (size_t t = 0; t <= s; t++) {
+            float l = lower[s * nSymbols + t];
+            const float *zt = z.data() + t * kChunk;
+            for (size_t j = 0; j < c; j++)
+              ys[j] += l * zt[j];
+          }
+          float *out = moves.data() + s * scenarios + k0;
+          float sh = (float)sqrtH, d = drift[s];
+          for (size_t j = 0; j < c; j++)
+            out[j] = exp(ys[j] * sh + d) - 1.0f;
+          double e = bookExposure[s];
+          for (size_t j = 0; j < c; j++)
+            loss[j] -= e * out[j];
+        }
+        copy(loss.begin(), loss.end(), bookLoss.begin() + k0);
+      });
+
+  report->scenarios = scenarios;
+  report->tail = TailCount(cfg.confidence, scenarios);
+  report->accountVar.assign(nAccounts, 0);
+  report->accountEs.assign(nAccounts, 0);
+  TailOf(bookLoss.data(), scenarios, report->tail, &report->var,
+         &report->es);
+
+  vector<vector<float>> losses(threads), candidates(threads);
+  pool.ParallelFor(
+      (nAccounts + kAccountBlock - 1) / kAccountBlock,
+      [&](size_t block, unsigned w) {
+        vector<float> &loss = losses[w];
+        loss.resize(scenarios);
+        float *l = loss.data();
+        size_t end = min(nAccounts, (block + 1) * kAccountBlock);
+        for (size_t a = block * kAccountBlock; a < end; a++) {
+          size_t first = book.FirstPosition(a);
+          size_t last = book.FirstPosition(a + 1);
+          if (first == last)
+            continue;
+          // In tiles of scenarios, so the losses being summed stay in L1
+          // while each position's moves stream past.
+          for (size_t k0 = 0; k0 < scenarios; k0 += kTile) {
+            size_t k1 = min(scenarios, k0 + kTile);
+            fill(l + k0, l + k1, 0.0f);
+            for (size_t i = first; i < last; i++) {
+              uint32_t s = book.PositionSymbol(i);
+              float e = (float)(book.PositionQuantity(i) * prices[s]);
+              const float *m = moves.data() + s * scenarios;
+              for (size_t k = k0; k < k1; k++)
+                l[k] -= e * m[k];
+            }
+          }
+          TailOfFiltered(l, scenarios, report->tail, candidates[w],
+                         &report->accountVar[a], &report->accountEs[a]);
+        }
+      });
+  return true;
+}
+
+} // namespace Core
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "Valuation.h"
+#include "WorkStealingPool.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Core {
+
+struct RiskConfig {
+  uint64_t seed = 1;
+  size_t scenarios = 10000;
+  double horizonYears = 1.0 / 252; // a trading day
+  double confidence = 0.99;
+  // Annualized covariance of log returns, symbols x symbols row-major, in
+  // the book's symbol order.
+  std::vector<double> covariance;
+};
+
+// Losses are positive; VaR is the loss exceeded in 1 - confidence of the
+// scenarios and expected shortfall the mean loss in that tail.
+struct RiskReport {
+  size_t scenarios = 0, tail = 0; // tail: scenarios averaged into ES
+  double var = 0, es = 0;         // the whole book
+  std::vector<double> accountVar, accountEs; // by the book's account index
+};
+
+// Per-symbol volatilities with one correlation between every pair.
+std::vector<double> UniformCovariance(const std::vector<double> &vols,
+                                      double correlation);
+// In place: a (n x n, row-major, symmetric) becomes its lower Cholesky
+// factor L with L L^T = a. False if a is not positive definite.
+bool Cholesky(std::vector<double> &a, size_t n);
+
+// Monte Carlo over correlated lognormal price moves: scenario k draws
+// independent normals from Philox4x32 keyed by the seed and counted by k,
+// correlates them through the Cholesky factor and moves every price by
+// exp(r) - 1 at once. A scenario moves all positions in a
+// symbol alike, so an account's loss is its exposures (quantity x price)
+// dotted with the moves. Runs in two parallel phases on the pool:
+//  - scenarios in chunks: normals, the factor applied as axpys over the
+//    chunk, then moves stored by symbol (a row of all scenarios each), and
+//    the book's loss from its net exposure per symbol;
+//  - accounts in blocks: each account's losses in every scenario are a sum
+//    of its positions' exposures times their symbol's row, a vectorized
+//    axpy, then VaR and ES by selection.
+// Results depend only on the seed and inputs, not on thread count or
+// scheduling. Memory is one float per symbol per scenario plus two per
+// scenario per thread.
+class RiskEngine {
+  WorkStealingPool &pool;
+  std::vector<float> moves; // symbol s, scenario k: moves[s * scenarios + k]
+
+public:
+  explicit RiskEngine(WorkStealingPool &workers) : pool(workers) {}
+  // prices by symbol in the book's order; the book need not have been
+  // valued. False if the covariance has the wrong size or is not positive
+  // definite.
+  bool Run(const ValuationEngine &book, const double *prices,
+           const RiskConfig &config, RiskReport *report);
+};
+
+} // namespace Core
@@ -0,0 +1,332 @@
+#include "Schema.h"
+
+#include <cctype>
+#include <cstring>
+#include <sqlite3.h>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace Core {
+
+namespace {
+
+// Declared type of table.column, or "" if either does not exist. Generated
+// columns are included.
+string ColumnType(sqlite3 *db, const string &table, const string &column) {
+  string type;
+  sqlite3_stmt *s;
+  string sql = "PRAGMA table_xinfo(" + table + ");";
+  if (sqlite3_prepare_v2(db, sql.c_str(), -1, &s, 0) != SQLITE_OK)
+    return type;
+  while (sqlite3_step(s) == SQLITE_ROW) {
+    const char *name = (const char *)sqlite3_column_text(s, 1);
+    const char *decl = (const char *)sqlite3_column_text(s, 2);
+    if (name && column == name) {
+      type = decl ? decl : "";
+      break;
+    }
+  }
+  sqlite3_finalize(s);
+  return type;
+}
+
+// Rows of a query's first column, as text.
+vector<string> Strings(sqlite3 *db, const string &sql) {
+  vector<string> out;
+  sqlite3_stmt *s;
+  if (sqlite3_prepare_v2(db, sql.c_str(), -1, &s, 0) != SQLITE_OK)
+    return out;
+  while (sqlite3_step(s) == SQLITE_ROW) {
+    const char *text = (const char *)sqlite3_column_text(s, 0);
+    out.push_back(text ? text : "");
+  }
+  sqlite3_finalize(s);
+  return out;
+}
+
+// Rows PRAGMA foreign_key_check reports for table ("" for every table), or
+// -1 if it cannot run.
+int ForeignKeyViolations(sqlite3 *db, const string &table) {
+  string sql = "PRAGMA foreign_key_check";
+  if (!table.empty())
+    sql += "(\"" + table + "\")";
+  sqlite3_stmt *s;
+  if (sqlite3_prepare_v2(db, (sql + ";").c_str(), -1, &s, 0) != SQLITE_OK)
+    return -1;
+  int n = 0;
+  while (sqlite3_step(s) == SQLITE_ROW)
+    n++;
+  sqlite3_finalize(s);
+  return n;
+}
+
+bool IsWordChar(char c) { return isalnum((unsigned char)c) || c == '_'; }
+
+// End of the quoted name or string starting at sql[i].
+size_t SkipQuoted(const string &sql, size_t i) {
+  char close = sql[i] == '[' ? ']' : sql[i];
+  for (i++; i < sql.size(); i++)
+    if (sql[i] == close) {
+      if (close != ']' && i + 1 < sql.size() && sql[i + 1] == close)
+        i++; // doubled quote
+      else
+        return i + 1;
+    }
+  return i;
+}
+
+// Rewrites a CREATE TABLE statement from sqlite_master to create newName
+// with column's declared type replaced by INTEGER, leaving its constraints,
+// default and every other column and table constraint as they were. "" if
+// the column is not found.
+string RetypeColumn(const string &create, const string &newName,
+                    const string &column) {
+  size_t open = create.find('(');
+  if (open == string::npos)
+    return "";
+  // Column and table constraint definitions are the comma separated parts
+  // at depth 1.
+  size_t i = open + 1;
+  while (i < create.size()) {
+    while (i < create.size() && isspace((unsigned char)create[i]))
+      i++;
+    size_t nameStart = i, nameEnd;
+    string name;
+    if (i < create.size() && strchr("\"`[", create[i])) {
+      nameEnd = SkipQuoted(create, i);
+      name = create.substr(nameStart + 1, nameEnd - nameStart - 2);
+    } else {
+      while (i < create.size() && IsWordChar(create[i]))
+        i++;
+      nameEnd = i;
+      name = create.substr(nameStart, nameEnd - nameStart);
+    }
+    if (sqlite3_stricmp(name.c_str(), column.c_str()) == 0) {
+      // The type is the words up to the first constraint keyword, with an
+      // optional (size) after them.
+      static const char *const kConstraints[] = {
+          "CONSTRAINT", "PRIMARY",    "NOT",       "NULL", "UNIQUE",
+          "CHECK",      "DEFAULT",    "COLLATE",   "REFERENCES",
+          "GENERATED",  "AS"};
+      size_t typeStart = nameEnd, typeEnd = nameEnd;
+      for (size_t j = nameEnd;;) {
+        while (j < create.size() && isspace((unsigned char)create[j]))
+          j++;
+        size_t w = j;
+        while (w < create.size() && IsWordChar(create[w]))
+          w++;
+        if (w == j)
+          break;
+        string word = create.substr(j, w - j);
+        bool keyword = false;
+        for (const char *k : kConstraints)
+          keyword = keyword || sqlite3_stricmp(word.c_str(), k) == 0;
+        if (keyword)
+          break;
+        if (typeEnd == nameEnd)
+          typeStart = j;
+        typeEnd = j = w;
+      }
+      size_t j = typeEnd;
+      while (j < create.size() && isspace((unsigned char)create[j]))
+        j++;
+      if (typeEnd != nameEnd && j < create.size() && create[j] == '(') {
+        size_t close = create.find(')', j);
+        if (close == string::npos)
+          return "";
+        typeEnd = close + 1;
+      }
+      string retyped = typeEnd == nameEnd
+                           ? create.substr(0, nameEnd) + " INTEGER" +
+                                 create.substr(nameEnd)
+                           : create.substr(0, typeStart) + "INTEGER" +
+                                 create.substr(typeEnd);
+      return "CREATE TABLE \"" + newName + "\" " + retyped.substr(open);
+    }
+    // On to the next part.
+    for (int depth = 0; i < create.size(); i++) {
+      char c = create[i];
+      if (c == '\'' || c == '"' || c == '`' || c == '[') {
+        i = SkipQuoted(create, i) - 1;
+      } else if (c == '(') {
+        depth++;
+      } else if (c == ')') {
+        if (depth-- == 0)
+          return ""; // end of the definitions
+      } else if (c == ',' && depth == 0) {
+        i++;
+        break;
+      }
+    }
+  }
+  return "";
+}
+
+// Rebuilds table with column as INTEGER paise, SQLite's documented way of
+// changing a column: create the new table from the old one's own DDL, copy,
+// drop, rename, then recreate the old table's indexes and triggers.
+// Constraints, defaults and foreign keys (both ways) therefore survive, and
+// views are left alone. Foreign keys are checked before the swap and after
+// it; the rebuild is undone if either finds a violation the old table did
+// not have.
+bool Rebuild(sqlite3 *db, const string &table, const string &column) {
+  vector<string> create = Strings(
+      db, "SELECT sql FROM sqlite_master WHERE type = 'table' AND name = '" +
+              table + "';");
+  string temp = table + "_paise";
+  string ddl = create.empty() ? "" : RetypeColumn(create[0], temp, column);
+  if (ddl.empty())
+    return false;
+  vector<string> dependents =
+      Strings(db, "SELECT sql FROM sqlite_master WHERE type IN ('index', "
+                  "'trigger') AND tbl_name = '" +
+                      table + "' AND sql IS NOT NULL;");
+  // Stored columns only; generated ones are computed by the new table.
+  string columns;
+  sqlite3_stmt *s;
+  string info = "PRAGMA table_xinfo(\"" + table + "\");";
+  if (sqlite3_prepare_v2(db, info.c_str(), -1, &s, 0) != SQLITE_OK)
+    return false;
+  while (sqlite3_step(s) == SQLITE_ROW) {
+    const char *name = (const char *)sqlite3_column_text(s, 1);
+    if (sqlite3_column_int(s, 6) != 0 || !name || column == name)
+      continue;
+    columns += "\"" + string(name) + "\", ";
+  }
+  sqlite3_finalize(s);
+  string copy = "INSERT INTO \"" + temp + "\" (" + columns + column +
+                ") SELECT " + columns + "CAST(ROUND(COALESCE(" + column +
+                ", 0) * 100) AS INTEGER) FROM \"" + table + "\";";
+  string swap = "DROP TABLE \"" + table + "\"; ALTER TABLE \"" + temp +
+                "\" RENAME TO \"" + table + "\";";
+
+  // Dropping a parent table with enforcement on deletes its children's
+  // references, and the pragma only takes effect outside a transaction.
+  vector<string> fk = Strings(db, "PRAGMA foreign_keys;");
+  bool enforced = !fk.empty() && fk[0] == "1";
+  if (enforced && sqlite3_get_autocommit(db))
+    sqlite3_exec(db, "PRAGMA foreign_keys = OFF;", 0, 0, 0);
+  // Without legacy renames, views naming the dropped table fail the rename.
+  sqlite3_exec(db, "PRAGMA legacy_alter_table = ON;", 0, 0, 0);
+  int before = ForeignKeyViolations(db, "");
+  bool ok = before >= 0 && sqlite3_exec(db, "SAVEPOINT money_migration;", 0,
+                                        0, 0) == SQLITE_OK;
+  if (ok) {
+    ok = sqlite3_exec(db, ddl.c_str(), 0, 0, 0) == SQLITE_OK &&
+         sqlite3_exec(db, copy.c_str(), 0, 0, 0) == SQLITE_OK &&
+         ForeignKeyViolations(db, temp) == ForeignKeyViolations(db, table) &&
+         sqlite3_exec(db, swap.c_str(), 0, 0, 0) == SQLITE_OK;
+    for (const string &sql : dependents)
+      ok = ok && sqlite3_exec(db, sql.c_str(), 0, 0, 0) == SQLITE_OK;
+    ok = ok && ForeignKeyViolations(db, "") == before;
+    if (!ok)
+      sqlite3_exec(db, "ROLLBACK TO money_migration;", 0, 0, 0);
+    sqlite3_exec(db, "RELEASE money_migration;", 0, 0, 0);
+  }
+  sqlite3_exec(db, "PRAGMA legacy_alter_table = OFF;", 0, 0, 0);
+  if (enforced)
+    sqlite3_exec(db, "PRAGMA foreign_keys = ON;", 0, 0, 0);
+  return ok;
+}
+
+// Trigger body statement recording a change to the OLD or NEW account row.
+// Writers are serialised, so MAX + 1 hands out versions in commit order.
+string StampVersion(const char *row, const string &key) {
+  return string("INSERT OR REPLACE INTO account_versions VALUES (") + row +
+         "." + key +
+         ", (SELECT COALESCE(MAX(row_version), 0) + 1"
+         " FROM account_versions)); ";
+}
+
+} // namespace
+
+bool MigrateMoneyColumns(sqlite3 *db) {
+  // accounts.balance has the same name in both account schemas.
+  static const char *const kMoneyColumns[][2] = {{"accounts", "balance"},
+                                                 {"transactions", "amount"}};
+  bool ok = true;
+  for (auto &c : kMoneyColumns)
+    if (ColumnType(db, c[0], c[1]) == "REAL")
+      ok = Rebuild(db, c[0], c[1]) && ok;
+  return ok;
+}
+
+bool EnsureNameKey(sqlite3 *db) {
+  const char *nameColumn = nullptr;
+  if (!ColumnType(db, "accounts", "account_number").empty())
+    nameColumn = "holder_name";
+  else if (!ColumnType(db, "accounts", "acc_num").empty())
+    nameColumn = "name";
+  else
+    return false;
+  if (ColumnType(db, "accounts", "name_key").empty()) {
+    // VIRTUAL so existing rows need no rewrite and positional INSERTs,
+    // which skip generated columns, keep working.
+    string add = string("ALTER TABLE accounts ADD COLUMN name_key TEXT "
+                        "GENERATED ALWAYS AS (lower(") +
+                 nameColumn + ")) VIRTUAL;";
+    if (sqlite3_exec(db, add.c_str(), 0, 0, 0) != SQLITE_OK)
+      return false;
+  }
+  return sqlite3_exec(db,
+                      "CREATE INDEX IF NOT EXISTS idx_accounts_name_key ON "
+                      "accounts(name_key);",
+                      0, 0, 0) == SQLITE_OK;
+}
+
+bool EnsureAccountVersions(sqlite3 *db) {
+  string key;
+  if (!ColumnType(db, "accounts", "account_number").empty())
+    key = "account_number";
+  else if (!ColumnType(db, "accounts", "acc_num").empty())
+    key = "acc_num";
+  else
+    return false;
+  string stampOld = StampVersion("OLD", key), stamp = StampVersion("NEW", key);
+  string sql =
+      "CREATE TABLE IF NOT EXISTS account_versions (account_number TEXT "
+      "PRIMARY KEY, row_version INTEGER NOT NULL);"
+      "CREATE INDEX IF NOT EXISTS idx_account_versions_row_version ON "
+      "account_versions(row_version);"
+      "CREATE TRIGGER IF NOT EXISTS accounts_version_insert AFTER INSERT ON "
+      "accounts BEGIN " +
+      stamp +
+      "END;"
+      "CREATE TRIGGER IF NOT EXISTS accounts_version_update AFTER UPDATE ON "
+      "accounts BEGIN " +
+      stamp +
+      "END;"
+      "CREATE TRIGGER IF NOT EXISTS accounts_version_rekey AFTER UPDATE ON "
+      "accounts WHEN OLD." +
+      key + " IS NOT NEW." + key + " BEGIN " + stampOld +
+      "END;"
+      "CREATE TRIGGER IF NOT EXISTS accounts_version_delete AFTER DELETE ON "
+      "accounts BEGIN " +
+      stampOld + "END;";
+  if (sqlite3_exec(db, "SAVEPOINT account_versions;", 0, 0, 0) != SQLITE_OK)
+    return false;
+  bool ok = sqlite3_exec(db, sql.c_str(), 0, 0, 0) == SQLITE_OK;
+  if (!ok)
+    sqlite3_exec(db, "ROLLBACK TO account_versions;", 0, 0, 0);
+  sqlite3_exec(db, "RELEASE account_versions;", 0, 0, 0);
+  return ok;
+}
+
+bool EnsureRowVersions(sqlite3 *db) {
+  bool ok = true;
+  for (const char *table : {"accounts", "portfolio"}) {
+    if (ColumnType(db, table, "symbol").empty() &&
+        ColumnType(db, table, "balance").empty())
+      continue; // table missing
+    if (!ColumnType(db, table, "version").empty())
+      continue;
+    string add = string("ALTER TABLE ") + table +
+                 " ADD COLUMN version INTEGER NOT NULL DEFAULT 0;";
+    ok = sqlite3_exec(db, add.c_str(), 0, 0, 0) == SQLITE_OK && ok;
+  }
+  return ok;
+}
+
+} // namespace Core
@@ -0,0 +1,37 @@
+#pragma once
+
+struct sqlite3;
+
+namespace Core {
+
+// Rebuilds tables whose money columns predate integer paise (accounts.balance
+// in either account schema, transactions.amount) as INTEGER columns, rounding
+// the stored rupee values. The new table is declared from the old one's own
+// CREATE TABLE with only the money column's type changed, so constraints,
+// defaults, foreign keys, indexes and triggers all carry over; the rebuild
+// is undone if PRAGMA foreign_key_check finds a new violation. Tables that
+// are missing or already converted are left alone, so this is safe to run
+// on every open.
+bool MigrateMoneyColumns(sqlite3 *db);
+
+// Adds accounts.name_key, the holder name folded with SQL lower() (ASCII
+// only, like COLLATE NOCASE), and an index on it so name lookups are a
+// B-tree search. Query it as "name_key = lower(?)". Works on either account
+// schema and is a no-op once applied.
+bool EnsureNameKey(sqlite3 *db);
+
+// Change tracking for accounts. Triggers stamp every inserted, updated or
+// deleted account in account_versions(account_number, row_version) with
+// MAX(row_version) + 1, indexed by row_version, so a cache can fetch only
+// rows changed since the version it last saw. Deleted accounts keep their
+// version row and show up with no matching accounts row. Rows written
+// before the triggers existed have no version until they next change.
+bool EnsureAccountVersions(sqlite3 *db);
+
+// Adds a version column (INTEGER NOT NULL DEFAULT 0) to accounts and, if it
+// exists, portfolio. Every write to a row bumps it, so a writer that read
+// the row can update it with "... AND version = ?" and detect that someone
+// else got there first. A no-op once applied.
+bool EnsureRowVersions(sqlite3 *db);
+
+} // namespace Core
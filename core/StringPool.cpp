@@ -0,0 +1,39 @@
+#include "StringPool.h"
+
+#include <cstring>
+
+using namespace std;
+
+namespace Core {
+
+namespace {
+const size_t kBlockBytes = 64 * 1024;
+}
+
+const char *StringPool::Intern(const string &s) {
+  lock_guard<mutex> guard(lock);
+  auto it = index.find(string_view(s));
+  if (it != index.end())
+    return it->data();
+
+  size_t need = s.size() + 1;
+  if (blocks.empty() || blockSize - blockUsed < need) {
+    // Oversized strings get a block of their own.
+    blockSize = need > kBlockBytes ? need : kBlockBytes;
+    blocks.emplace_back(new char[blockSize]);
+    blockUsed = 0;
+  }
+  char *p = blocks.back().get() + blockUsed;
+  memcpy(p, s.data(), s.size());
+  p[s.size()] = '\0';
+  blockUsed += need;
+  index.insert(string_view(p, s.size()));
+  return p;
+}
+
+size_t StringPool::Size() const {
+  lock_guard<mutex> guard(lock);
+  return index.size();
+}
+
+} // namespace Core
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+namespace Core {
+
+// Keeps one copy of each distinct string and hands out NUL-terminated
+// pointers that stay valid for the pool's lifetime. Bytes are carved out of
+// large blocks, so a string costs its length plus one and an index entry
+// rather than a heap allocation per holder.
+class StringPool {
+  std::vector<std::unique_ptr<char[]>> blocks;
+  size_t blockUsed = 0, blockSize = 0;
+  std::unordered_set<std::string_view> index;
+  mutable std::mutex lock;
+
+public:
+  StringPool() {}
+  StringPool(const StringPool &) = delete;
+  StringPool &operator=(const StringPool &) = delete;
+
+  const char *Intern(const std::string &s);
+  // Distinct strings held.
+  size_t Size() const;
+};
+
+} // namespace Core
@@ -0,0 +1,176 @@
+#include "Valuation.h"
+
+#include <algorithm>
+#include <unordered_map>
+
+using namespace std;
+
+namespace Core {
+
+void ValuationEngine::Reset(const vector<string> &symbolList) {
+  symbols = symbolList;
+  accounts.clear();
+  posAccount.clear();
+  posSymbol.clear();
+  posQty.clear();
+  posAvg.clear();
+  runAccount.clear();
+  runQty.clear();
+  cash.clear();
+  accStart.assign(1, 0);
+  runStart.assign(symbols.size() + 1, 0);
+  lastPrice.assign(symbols.size(), 0);
+  unpriced = 0;
+  valued = false;
+}
+
+size_t ValuationEngine::AddAccount(const string &accNum, double cashRupees) {
+  accounts.push_back(accNum);
+  cash.push_back(cashRupees);
+  return accounts.size() - 1;
+}
+
+void ValuationEngine::AddPosition(size_t account, size_t symbol, int quantity,
+                                  double avgPrice) {
+  posAccount.push_back((uint32_t)account);
+  posSymbol.push_back((uint32_t)symbol);
+  posQty.push_back(quantity);
+  posAvg.push_back(avgPrice);
+}
+
+namespace {
+
+// Counting sort: fills start (keys + 1 entries) and returns, for each slot
+// in key order, the index it comes from. Equal keys keep their order.
+vector<size_t> GroupBy(const vector<uint32_t> &key, size_t keys,
+                       vector<size_t> *start) {
+  start->assign(keys + 1, 0);
+  for (uint32_t k : key)
+    (*start)[k + 1]++;
+  for (size_t k = 0; k < keys; k++)
+    (*start)[k + 1] += (*start)[k];
+  vector<size_t> at(start->begin(), start->end() - 1), from(key.size());
+  for (size_t i = 0; i < key.size(); i++)
+    from[at[key[i]]++] = i;
+  return from;
+}
+
+template <class T> void Permute(vector<T> &v, const vector<size_t> &from) {
+  vector<T> out(from.size());
+  for (size_t i = 0; i < from.size(); i++)
+    out[i] = v[from[i]];
+  v.swap(out);
+}
+
+} // namespace
+
+void ValuationEngine::Finish() {
+  vector<size_t> from = GroupBy(posAccount, accounts.size(), &accStart);
+  Permute(posAccount, from);
+  Permute(posSymbol, from);
+  Permute(posQty, from);
+  Permute(posAvg, from);
+  from = GroupBy(posSymbol, symbols.size(), &runStart);
+  runAccount.resize(from.size());
+  runQty.resize(from.size());
+  for (size_t i = 0; i < from.size(); i++) {
+    runAccount[i] = posAccount[from[i]];
+    runQty[i] = posQty[from[i]];
+  }
+
+  cost.assign(accounts.size(), 0);
+  for (size_t i = 0; i < posQty.size(); i++)
+    cost[posAccount[i]] += posQty[i] * posAvg[i];
+  marketValue.assign(accounts.size(), 0);
+  equity = cash;
+  pnl.assign(accounts.size(), 0);
+  valued = false;
+}
+
+bool ValuationEngine::Load(VaultDB &db, const vector<string> &symbolList) {
+  Reset(symbolList);
+  unordered_map<string, size_t> accountIndex, symbolIndex;
+  for (size_t s = 0; s < symbols.size(); s++)
+    symbolIndex[symbols[s]] = s;
+  for (auto &a : db.LoadAccounts())
+    accountIndex[a.accNum] = AddAccount(a.accNum, a.balance.Rupees());
+  vector<Holding> holdings;
+  if (!db.GetAllPositions(&holdings))
+    return false;
+  for (auto &h : holdings) {
+    auto acc = accountIndex.find(h.accNum);
+    auto sym = symbolIndex.find(h.symbol);
+    if (acc == accountIndex.end() || sym == symbolIndex.end())
+      unpriced++;
+    else
+      AddPosition(acc->second, sym->second, h.quantity, h.avgPrice);
+  }
+  Finish();
+  return true;
+}
+
+void ValuationEngine::Value(const double *prices) {
+  copy(prices, prices + symbols.size(), lastPrice.begin());
+  const uint32_t *sym = posSymbol.data();
+  const double *q = posQty.data();
+  double *mv = marketValue.data();
+  for (size_t a = 0; a < accounts.size(); a++) {
+    double sum = 0;
+    for (size_t i = accStart[a]; i < accStart[a + 1]; i++)
+      sum += q[i] * prices[sym[i]];
+    mv[a] = sum;
+  }
+
+  const double *c = cash.data(), *k = cost.data();
+  double *eq = equity.data(), *pl = pnl.data();
+  for (size_t a = 0; a < accounts.size(); a++) {
+    eq[a] = c[a] + mv[a];
+    pl[a] = mv[a] - k[a];
+  }
+  valued = true;
+}
+
+size_t ValuationEngine::Update(const double *prices) {
+  // A scattered add costs several times a position in the full pass, so
+  // past a fifth of the book the full pass is cheaper (and exact).
+  size_t moved = 0;
+  for (size_t s = 0; s < symbols.size(); s++)
+    if (prices[s] != lastPrice[s])
+      moved += runStart[s + 1] - runStart[s];
+  if (!valued || moved > Positions() / 5) {
+    Value(prices);
+    return Positions();
+  }
+  const double *q = runQty.data();
+  const uint32_t *acc = runAccount.data();
+  double *mv = marketValue.data(), *eq = equity.data(), *pl = pnl.data();
+  for (size_t s = 0; s < symbols.size(); s++) {
+    double move = prices[s] - lastPrice[s];
+    if (move == 0)
+      continue;
+    lastPrice[s] = prices[s];
+    for (size_t i = runStart[s]; i < runStart[s + 1]; i++) {
+      double d = q[i] * move;
+      mv[acc[i]] += d;
+      eq[acc[i]] += d;
+      pl[acc[i]] += d;
+    }
+  }
+  return moved;
+}
+
+double ValuationEngine::TotalEquity() const {
+  double total = 0;
+  for (double e : equity)
+    total += e;
+  return total;
+}
+
+double ValuationEngine::TotalPnl() const {
+  double total = 0;
+  for (double p : pnl)
+    total += p;
+  return total;
+}
+
+} // namespace Core
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "VaultDB.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Core {
+
+// Marks every position of every account to market, for risk reports that
+// need the whole book valued on every tick. Positions are columns (symbol
+// id, quantity, average price) grouped by account, with a second copy of
+// (account index, quantity) grouped by symbol:
+//  - Value() recomputes everything. Each account's positions are summed in
+//    a register with prices gathered from the per-symbol table, which stays
+//    in cache, so every position is read and every account written once,
+//    in order. Equity (cash + market value) and unrealized P&L (market
+//    value - cost) then come from one vectorized pass over account columns.
+//  - Update() only walks the symbol runs whose price moved, adding
+//    quantity * move to the accounts holding them; it falls back to Value
+//    when so much moved that the full pass is cheaper.
+// Amounts are rupees as doubles. Update accumulates rounding that the next
+// Value clears. Not thread safe.
+class ValuationEngine {
+  std::vector<std::string> symbols, accounts;
+  // By position: account order after Finish, account i's positions being
+  // [accStart[i], accStart[i + 1]).
+  std::vector<uint32_t> posAccount, posSymbol;
+  std::vector<double> posQty, posAvg;
+  std::vector<size_t> accStart;
+  // The same positions by symbol: symbol s's are [runStart[s],
+  // runStart[s + 1]).
+  std::vector<uint32_t> runAccount;
+  std::vector<double> runQty;
+  std::vector<size_t> runStart;
+  std::vector<double> cash, cost; // by account, fixed after Finish
+  std::vector<double> marketValue, equity, pnl;
+  std::vector<double> lastPrice; // by symbol, as of Value or Update
+  size_t unpriced = 0;
+  bool valued = false;
+
+public:
+  // Starts over with prices to come in this symbol order.
+  void Reset(const std::vector<std::string> &symbolList);
+  // Returns the account's index.
+  size_t AddAccount(const std::string &accNum, double cashRupees);
+  void AddPosition(size_t account, size_t symbol, int quantity,
+                   double avgPrice);
+  // Groups the positions by account and by symbol and sums each account's
+  // cost. Call once everything is added, before Value.
+  void Finish();
+  // Reset, then every account and position in db, then Finish. Positions in
+  // symbols outside the list are left out and counted by Unpriced().
+  bool Load(VaultDB &db, const std::vector<std::string> &symbolList);
+
+  // prices has one entry per symbol, in Reset order.
+  void Value(const double *prices);
+  // As Value, touching only positions whose symbol's price differs from
+  // the last one seen; returns how many that was. The first call, and any
+  // where over a fifth of the positions moved, runs Value instead.
+  size_t Update(const double *prices);
+
+  size_t Accounts() const { return accounts.size(); }
+  size_t Positions() const { return posQty.size(); }
+  size_t Unpriced() const { return unpriced; }
+  const std::string &AccountNumber(size_t i) const { return accounts[i]; }
+  const std::vector<std::string> &Symbols() const { return symbols; }
+  // After Finish, account i's positions are [FirstPosition(i),
+  // FirstPosition(i + 1)).
+  size_t FirstPosition(size_t account) const { return accStart[account]; }
+  uint32_t PositionSymbol(size_t i) const { return posSymbol[i]; }
+  double PositionQuantity(size_t i) const { return posQty[i]; }
+
+  // By account index, as of the last Value or Update.
+  const double *Cash() const { return cash.data(); }
+  const double *MarketValue() const { return marketValue.data(); }
+  const double *Equity() const { return equity.data(); }
+  const double *Pnl() const { return pnl.data(); }
+  double TotalEquity() const;
+  double TotalPnl() const;
+};
+
+} // namespace Core
@@ -0,0 +1,887 @@
+#include "VaultDB.h"
+
+#include "Schema.h"
+
+#include <sqlite3.h>
+#include <unordered_map>
+
+using namespace std;
+
+namespace Core {
+
+namespace {
+// Attempts at a compare-and-swap write before giving up with code 6.
+const int kCasRetries = 16;
+
+// Resets and unbinds a cached statement when it goes out of scope so the
+// next caller starts clean and no read cursor stays open.
+class CachedStmt {
+  sqlite3_stmt *s;
+
+public:
+  explicit CachedStmt(sqlite3_stmt *stmt) : s(stmt) {}
+  ~CachedStmt() {
+    if (s) {
+      sqlite3_reset(s);
+      sqlite3_clear_bindings(s);
+    }
+  }
+  CachedStmt(const CachedStmt &) = delete;
+  CachedStmt &operator=(const CachedStmt &) = delete;
+  operator sqlite3_stmt *() const { return s; }
+  explicit operator bool() const { return s != nullptr; }
+};
+} // namespace
+
+// [0] = legacy acc_num/name schema, [1] = account_number/holder_name schema.
+const char *const VaultDB::kSql[2][VaultDB::STMT_COUNT] = {
+    {"SAVEPOINT op;", "RELEASE op;", "ROLLBACK TO op;", "BEGIN IMMEDIATE;",
+     "COMMIT;", "ROLLBACK;",
+     "INSERT INTO accounts (acc_num, name, pin, balance) VALUES(?,?,?,?);",
+     "SELECT acc_num, name, pin, balance FROM accounts;",
+     "SELECT balance, version FROM accounts WHERE acc_num=?;",
+     "UPDATE accounts SET balance=?, version = version + 1 WHERE acc_num=? "
+     "AND version=?;",
+     "SELECT acc_num, name, pin, balance FROM accounts WHERE name_key = "
+     "lower(?) ORDER BY acc_num;",
+     "UPDATE accounts SET balance = balance - ?, version = version + 1 WHERE "
+     "acc_num = ? AND balance >= ?;",
+     "UPDATE accounts SET balance = balance + ?, version = version + 1 WHERE "
+     "acc_num = ? AND balance <= 9007199254740991 - ?;",
+     "SELECT quantity, avg_price FROM portfolio WHERE acc_num=? AND symbol=?;",
+     "INSERT INTO portfolio (acc_num, symbol, quantity, avg_price) "
+     "VALUES(?1,?2,?3,?4) ON CONFLICT(acc_num, symbol) DO UPDATE SET "
+     "avg_price = (avg_price * quantity + excluded.avg_price * "
+     "excluded.quantity) / (quantity + excluded.quantity), quantity = "
+     "quantity + excluded.quantity, version = version + 1;",
+     "UPDATE portfolio SET quantity = quantity - ?1, version = version + 1 "
+     "WHERE acc_num=?2 AND symbol=?3 AND quantity >= ?1;",
+     "INSERT INTO fills (account_number, symbol, quantity, price, amount) "
+     "VALUES(?,?,?,?,?);",
+     "SELECT id, symbol, quantity, price, amount, created_at FROM fills WHERE "
+     "account_number=? ORDER BY id DESC LIMIT ?;",
+     "SELECT symbol, quantity, avg_price FROM portfolio WHERE acc_num=? AND "
+     "quantity <> 0 ORDER BY symbol;",
+     "SELECT acc_num, symbol, quantity, avg_price FROM portfolio WHERE "
+     "quantity <> 0;"},
+    {"SAVEPOINT op;", "RELEASE op;", "ROLLBACK TO op;", "BEGIN IMMEDIATE;",
+     "COMMIT;", "ROLLBACK;",
+     "INSERT INTO accounts (account_number, holder_name, pin, balance) "
+     "VALUES(?,?,?,?);",
+     "SELECT account_number, holder_name, pin, balance FROM accounts;",
+     "SELECT balance, version FROM accounts WHERE account_number=?;",
+     "UPDATE accounts SET balance=?, version = version + 1 WHERE "
+     "account_number=? AND version=?;",
+     "SELECT account_number, holder_name, pin, balance FROM accounts WHERE "
+     "name_key = lower(?) ORDER BY account_number;",
+     "UPDATE accounts SET balance = balance - ?, version = version + 1 WHERE "
+     "account_number = ? AND balance >= ?;",
+     "UPDATE accounts SET balance = balance + ?, version = version + 1 WHERE "
+     "account_number = ? AND balance <= 9007199254740991 - ?;",
+     "SELECT quantity, avg_price FROM portfolio WHERE account_number=? AND "
+     "symbol=?;",
+     "INSERT INTO portfolio (account_number, symbol, quantity, avg_price) "
+     "VALUES(?1,?2,?3,?4) ON CONFLICT(account_number, symbol) DO UPDATE SET "
+     "avg_price = (avg_price * quantity + excluded.avg_price * "
+     "excluded.quantity) / (quantity + excluded.quantity), quantity = "
+     "quantity + excluded.quantity, version = version + 1;",
+     "UPDATE portfolio SET quantity = quantity - ?1, version = version + 1 "
+     "WHERE account_number=?2 AND symbol=?3 AND quantity >= ?1;",
+     "INSERT INTO fills (account_number, symbol, quantity, price, amount) "
+     "VALUES(?,?,?,?,?);",
+     "SELECT id, symbol, quantity, price, amount, created_at FROM fills WHERE "
+     "account_number=? ORDER BY id DESC LIMIT ?;",
+     "SELECT symbol, quantity, avg_price FROM portfolio WHERE "
+     "account_number=? AND quantity <> 0 ORDER BY symbol;",
+     "SELECT account_number, symbol, quantity, avg_price FROM portfolio "
+     "WHERE quantity <> 0;"}};
+
+sqlite3_stmt *VaultDB::Stmt(StmtId id) {
+  sqlite3_stmt *&slot = stmtCache[useNewSchema ? 1 : 0][id];
+  if (slot) {
+    stmtStats.hits++;
+    return slot;
+  }
+  stmtStats.misses++;
+  if (sqlite3_prepare_v3(db, kSql[useNewSchema ? 1 : 0][id], -1,
+                         SQLITE_PREPARE_PERSISTENT, &slot, 0) != SQLITE_OK) {
+    sqlite3_finalize(slot);
+    slot = nullptr;
+  }
+  return slot;
+}
+
+bool VaultDB::Exec(StmtId id) {
+  CachedStmt s(Stmt(id));
+  return s && sqlite3_step(s) == SQLITE_DONE;
+}
+
+void VaultDB::FinalizeStatements() {
+  for (auto &variant : stmtCache)
+    for (auto &s : variant) {
+      sqlite3_finalize(s);
+      s = nullptr;
+    }
+}
+
+VaultDB::~VaultDB() {
+  committer.Detach();
+  keys.Detach();
+  ledger.Detach();
+  FinalizeStatements();
+  if (db)
+    sqlite3_close(db);
+}
+
+bool VaultDB::Init(const string &path) {
+  if (sqlite3_open(path.c_str(), &db) != SQLITE_OK)
+    return false;
+  EnableWal(db);
+  // Other connections' writers hold the lock only for their short CAS
+  // transactions; wait for them rather than failing.
+  sqlite3_busy_timeout(db, 5000);
+  committer.Attach(db);
+  // A rolled-back group undoes positions and balances already counted.
+  committer.SetRollbackHook([this] {
+    portfolioVersion++;
+    accountsVersion++;
+  });
+
+  // Check which schema we are using
+  sqlite3_stmt *stmt;
+  if (sqlite3_prepare_v2(db, "SELECT account_number FROM accounts LIMIT 1;",
+                         -1, &stmt, 0) != SQLITE_OK) {
+    useNewSchema = false;
+  } else {
+    sqlite3_finalize(stmt);
+    useNewSchema = true;
+  }
+
+  // Balances are integer paise; convert databases written with REAL rupees.
+  MigrateMoneyColumns(db);
+
+  if (useNewSchema) {
+    sqlite3_exec(db,
+                 "CREATE TABLE IF NOT EXISTS accounts (account_number TEXT "
+                 "PRIMARY KEY, holder_name TEXT, pin TEXT, balance INTEGER "
+                 "NOT NULL DEFAULT 0, created_at DATETIME DEFAULT "
+                 "CURRENT_TIMESTAMP);",
+                 0, 0, 0);
+    sqlite3_exec(db,
+                 "CREATE TABLE IF NOT EXISTS portfolio (account_number TEXT, "
+                 "symbol TEXT, quantity INTEGER, avg_price REAL, PRIMARY "
+                 "KEY(account_number, symbol));",
+                 0, 0, 0);
+  } else {
+    sqlite3_exec(db,
+                 "CREATE TABLE IF NOT EXISTS accounts (acc_num TEXT PRIMARY "
+                 "KEY, name TEXT, pin TEXT, balance INTEGER NOT NULL DEFAULT "
+                 "0);",
+                 0, 0, 0);
+    sqlite3_exec(
+        db,
+        "CREATE TABLE IF NOT EXISTS portfolio (acc_num TEXT, symbol TEXT, "
+        "quantity INTEGER, avg_price REAL, PRIMARY KEY(acc_num, symbol));",
+        0, 0, 0);
+  }
+  // Same layout under either schema; account_number holds the account key.
+  sqlite3_exec(db,
+               "CREATE TABLE IF NOT EXISTS fills (id INTEGER PRIMARY KEY "
+               "AUTOINCREMENT, account_number TEXT NOT NULL, symbol TEXT NOT "
+               "NULL, quantity INTEGER NOT NULL, price INTEGER NOT NULL, "
+               "amount INTEGER NOT NULL, created_at DATETIME DEFAULT "
+               "CURRENT_TIMESTAMP);"
+               "CREATE INDEX IF NOT EXISTS idx_fills_account_id ON "
+               "fills(account_number, id);",
+               0, 0, 0);
+  EnsureNameKey(db);
+  EnsureRowVersions(db);
+  ledger.Attach(db, useNewSchema
+                        ? "SELECT account_number, balance FROM accounts;"
+                        : "SELECT acc_num, balance FROM accounts;");
+  keys.Attach(db);
+
+  sqlite3_stmt *check;
+  if (sqlite3_prepare_v2(db, "SELECT COUNT(*) FROM accounts;", -1, &check,
+                         0) == SQLITE_OK) {
+    if (sqlite3_step(check) == SQLITE_ROW &&
+        sqlite3_column_int(check, 0) == 0) {
+      sqlite3_finalize(check);
+      Money bal;
+      Money::FromRupees(100000, &bal);
+      CreateAccount("77367438", "jashwanth oggu", "1985", bal);
+      Money::FromRupees(75000, &bal);
+      CreateAccount("48528372", "chinni jaswanth", "4066", bal);
+      Money::FromRupees(50000, &bal);
+      CreateAccount("57422441", "muni charan teja", "1028", bal);
+    } else
+      sqlite3_finalize(check);
+  }
+  return true;
+}
+
+// Group commit can roll a keyed operation back after it returned; the key
+// must not outlive it in memory.
+DurableCallback VaultDB::ForgetOnRollback(const string &key,
+                                          const DurableCallback &onDurable) {
+  if (key.empty() || !committer.Enabled())
+    return onDurable;
+  return [this, key, onDurable](bool durable) {
+    if (!durable)
+      keys.Forget(key);
+    if (onDurable)
+      onDurable(durable);
+  };
+}
+
+bool VaultDB::CreateAccount(const string &num, const string &name,
+                            const string &pin, Money bal,
+                            const DurableCallback &onDurable,
+                            const string &idempotencyKey) {
+  int res = 6;
+  if (committer.BeginOp())
+    res = keys.Run(idempotencyKey, [&] {
+      if (!Exec(STMT_SAVEPOINT))
+        return 6;
+      int r = 6;
+      CachedStmt s(Stmt(STMT_CREATE_ACCOUNT));
+      if (s) {
+        sqlite3_bind_text(s, 1, num.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(s, 2, name.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(s, 3, pin.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_int64(s, 4, bal.Paise());
+        if (sqlite3_step(s) == SQLITE_DONE) {
+          accountsVersion++;
+          Posting legs[2] = {{num, bal}, {Ledger::kEquity, bal.Negated()}};
+          r = bal == Money() || ledger.Post("OPENING", legs, 2) ? 0 : 6;
+        }
+      }
+      return EndSavepoint(r);
+    });
+  committer.EndOp(res == 0, ForgetOnRollback(idempotencyKey, onDurable));
+  return res == 0;
+}
+
+namespace {
+// Reads a (number, name, pin, balance) row from a LOAD_ACCOUNTS-shaped query.
+Account ReadAccount(sqlite3_stmt *s) {
+  const char *n = (const char *)sqlite3_column_text(s, 0);
+  const char *m = (const char *)sqlite3_column_text(s, 1);
+  const char *p = (const char *)sqlite3_column_text(s, 2);
+  Money bal;
+  Money::FromPaise(sqlite3_column_int64(s, 3), &bal);
+  return {n ? n : "", m ? m : "", p ? p : "", bal};
+}
+} // namespace
+
+vector<Account> VaultDB::LoadAccounts() {
+  vector<Account> list;
+  CachedStmt s(Stmt(STMT_LOAD_ACCOUNTS));
+  if (!s)
+    return list;
+  while (sqlite3_step(s) == SQLITE_ROW)
+    list.push_back(ReadAccount(s));
+  return list;
+}
+
+vector<Account> VaultDB::FindAccountsByName(const string &name) {
+  vector<Account> list;
+  CachedStmt s(Stmt(STMT_FIND_BY_NAME));
+  if (!s)
+    return list;
+  sqlite3_bind_text(s, 1, name.c_str(), -1, SQLITE_TRANSIENT);
+  while (sqlite3_step(s) == SQLITE_ROW)
+    list.push_back(ReadAccount(s));
+  return list;
+}
+
+bool VaultDB::GetBalance(const string &num, Money *balance) {
+  return ReadBalance(num, balance, nullptr);
+}
+
+bool VaultDB::ReadBalance(const string &num, Money *balance,
+                          int64_t *version) {
+  CachedStmt s(Stmt(STMT_GET_BALANCE));
+  if (!s)
+    return false;
+  sqlite3_bind_text(s, 1, num.c_str(), -1, SQLITE_TRANSIENT);
+  if (sqlite3_step(s) != SQLITE_ROW)
+    return false;
+  Money bal;
+  if (!Money::FromPaise(sqlite3_column_int64(s, 0), &bal))
+    return false;
+  if (balance)
+    *balance = bal;
+  if (version)
+    *version = sqlite3_column_int64(s, 1);
+  return true;
+}
+
+// Books the difference from the stored balance as an adjustment against
+// equity, so even a blind overwrite keeps the ledger balanced. The balance
+// is read outside the write and only replaced if its version still
+// matches; otherwise the delta is recomputed.
+bool VaultDB::UpdateBalance(const string &num, Money newBal,
+                            const DurableCallback &onDurable,
+                            const string &idempotencyKey) {
+  int res = 6;
+  if (committer.BeginOp())
+    res = keys.Run(idempotencyKey, [&] {
+      for (int attempt = 0; attempt < kCasRetries; attempt++) {
+        Money old, delta;
+        int64_t version;
+        if (!ReadBalance(num, &old, &version))
+          return 4;
+        if (!newBal.Sub(old, &delta))
+          return 5;
+        if (delta == Money())
+          return 0;
+        if (!Exec(STMT_SAVEPOINT))
+          return 6;
+        CachedStmt s(Stmt(STMT_UPDATE_BALANCE));
+        if (!s)
+          return EndSavepoint(6);
+        sqlite3_bind_int64(s, 1, newBal.Paise());
+        sqlite3_bind_text(s, 2, num.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_int64(s, 3, version);
+        if (sqlite3_step(s) != SQLITE_DONE)
+          return EndSavepoint(6);
+        if (sqlite3_changes(db) == 0) {
+          EndSavepoint(1); // lost the race; re-read
+          casRetries++;
+          continue;
+        }
+        accountsVersion++;
+        Posting legs[2] = {{num, delta}, {Ledger::kEquity, delta.Negated()}};
+        return EndSavepoint(ledger.Post("ADJUSTMENT", legs, 2) ? 0 : 6);
+      }
+      return 6;
+    });
+  committer.EndOp(res == 0, ForgetOnRollback(idempotencyKey, onDurable));
+  return res == 0;
+}
+
+// Runs the cached debit or credit statement; both bind (amount, account,
+// amount) and touch no row when their guard fails.
+bool VaultDB::ApplyBalanceDelta(StmtId id, const string &num, Money amount) {
+  CachedStmt s(Stmt(id));
+  if (!s)
+    return false;
+  sqlite3_bind_int64(s, 1, amount.Paise());
+  sqlite3_bind_text(s, 2, num.c_str(), -1, SQLITE_TRANSIENT);
+  sqlite3_bind_int64(s, 3, amount.Paise());
+  if (sqlite3_step(s) != SQLITE_DONE || sqlite3_changes(db) == 0)
+    return false;
+  accountsVersion++;
+  return true;
+}
+
+bool VaultDB::Deposit(const string &num, Money amount,
+                      const DurableCallback &onDurable,
+                      const string &idempotencyKey) {
+  int res = committer.BeginOp()
+                ? keys.Run(idempotencyKey,
+                           [&] { return ApplyCash(STMT_CREDIT, num, amount); })
+                : 6;
+  committer.EndOp(res == 0, ForgetOnRollback(idempotencyKey, onDurable));
+  return res == 0;
+}
+
+bool VaultDB::Withdraw(const string &num, Money amount,
+                       const DurableCallback &onDurable,
+                       const string &idempotencyKey) {
+  int res = committer.BeginOp()
+                ? keys.Run(idempotencyKey,
+                           [&] { return ApplyCash(STMT_DEBIT, num, amount); })
+                : 6;
+  committer.EndOp(res == 0, ForgetOnRollback(idempotencyKey, onDurable));
+  return res == 0;
+}
+
+// Closes the "op" savepoint, rolling it back unless res is 0. Returns res,
+// or 6 if a successful operation could not be released.
+int VaultDB::EndSavepoint(int res) {
+  if (res != 0)
+    Exec(STMT_ROLLBACK_TO);
+  if (!Exec(STMT_RELEASE) && res == 0) {
+    Exec(STMT_ROLLBACK_TO);
+    Exec(STMT_RELEASE);
+    res = 6;
+  }
+  // A rollback may have undone writes already counted.
+  if (res != 0) {
+    portfolioVersion++;
+    accountsVersion++;
+  }
+  return res;
+}
+
+// A deposit (STMT_CREDIT) or withdrawal (STMT_DEBIT) booked against cash.
+int VaultDB::ApplyCash(StmtId id, const string &num, Money amount) {
+  if (!amount.IsPositive())
+    return 5;
+  if (!Exec(STMT_SAVEPOINT))
+    return 6;
+  Money signedAmount = id == STMT_CREDIT ? amount : amount.Negated();
+  Posting legs[2] = {{num, signedAmount},
+                     {Ledger::kCash, signedAmount.Negated()}};
+  int res = 0;
+  if (!ApplyBalanceDelta(id, num, amount))
+    res = !GetBalance(num, nullptr) ? 4 : id == STMT_DEBIT ? 3 : 5;
+  else if (!ledger.Post(id == STMT_CREDIT ? "DEPOSIT" : "WITHDRAW", legs, 2))
+    res = 6;
+  return EndSavepoint(res);
+}
+
+int VaultDB::Transfer(const string &from, const string &toAccNum,
+                      Money amount, const DurableCallback &onDurable,
+                      const string &idempotencyKey) {
+  int res = committer.BeginOp()
+                ? keys.Run(idempotencyKey,
+                           [&] {
+                             return ApplyTransfer(from, toAccNum, amount);
+                           })
+                : 6;
+  committer.EndOp(res == 0, ForgetOnRollback(idempotencyKey, onDurable));
+  return res;
+}
+
+int VaultDB::ApplyTransfer(const string &from, const string &toAccNum,
+                           Money amount) {
+  if (!amount.IsPositive())
+    return 5;
+  if (toAccNum == from)
+    return 2;
+
+  // A savepoint rather than BEGIN so the transfer nests inside a group
+  // commit batch; on its own it behaves like BEGIN/COMMIT.
+  if (!Exec(STMT_SAVEPOINT))
+    return 6;
+  // Both legs are primary-key updates. Crediting first means a missing
+  // recipient is reported as such even when the sender is also short.
+  Posting legs[2] = {{from, amount.Negated()}, {toAccNum, amount}};
+  int res = 0;
+  if (!ApplyBalanceDelta(STMT_CREDIT, toAccNum, amount))
+    res = 4; // Crediting receiver
+  else if (!ApplyBalanceDelta(STMT_DEBIT, from, amount))
+    res = 3; // Debiting sender
+  else if (!ledger.Post("TRANSFER", legs, 2))
+    res = 6;
+  return EndSavepoint(res);
+}
+
+bool VaultDB::TransferBatch(const vector<TransferRequest> &requests,
+                            vector<int> *results,
+                            const DurableCallback &onDurable) {
+  vector<string> recorded;
+  int res = 6;
+  if (committer.BeginOp()) {
+    // A retry means a key was found on disk; it is in memory now, so the
+    // next attempt answers it without applying it.
+    do
+      res = ApplyTransferBatch(requests, results, &recorded);
+    while (res == 1);
+  }
+  if (res != 0)
+    results->assign(requests.size(), 6);
+  DurableCallback done = onDurable;
+  if (!recorded.empty() && committer.Enabled())
+    done = [this, recorded, onDurable](bool durable) {
+      if (!durable)
+        for (auto &key : recorded)
+          keys.Forget(key);
+      if (onDurable)
+        onDurable(durable);
+    };
+  committer.EndOp(res == 0, done);
+  return res == 0;
+}
+
+// One attempt at TransferBatch inside its own savepoint: 0 written, 1 undone
+// because a key was already on disk, 6 failed.
+int VaultDB::ApplyTransferBatch(const vector<TransferRequest> &requests,
+                                vector<int> *results,
+                                vector<string> *recorded) {
+  results->assign(requests.size(), 6);
+  recorded->clear();
+  if (!Exec(STMT_SAVEPOINT))
+    return 6;
+
+  // Running balance of every account the batch touches, read once.
+  struct Touched {
+    bool exists;
+    Money opening, balance;
+  };
+  unordered_map<string, Touched> touched;
+  touched.reserve(requests.size());
+  auto lookup = [&](const string &num) -> Touched & {
+    auto it = touched.find(num);
+    if (it == touched.end()) {
+      Touched t;
+      t.exists = GetBalance(num, &t.opening);
+      t.balance = t.opening;
+      it = touched.emplace(num, t).first;
+    }
+    return it->second;
+  };
+
+  // Same checks, in the same order, as ApplyTransfer. A key seen before,
+  // or earlier in this batch, gets the earlier result and is not applied.
+  unordered_map<string, size_t> firstWithKey;
+  vector<char> applied(requests.size(), 0);
+  for (size_t i = 0; i < requests.size(); i++) {
+    const TransferRequest &r = requests[i];
+    int &res = (*results)[i];
+    if (!r.key.empty()) {
+      if (keys.Lookup(r.key, &res))
+        continue;
+      auto first = firstWithKey.emplace(r.key, i);
+      if (!first.second) {
+        res = (*results)[first.first->second];
+        continue;
+      }
+    }
+    if (!r.amount.IsPositive()) {
+      res = 5;
+      continue;
+    }
+    if (r.to == r.from) {
+      res = 2;
+      continue;
+    }
+    Touched &to = lookup(r.to);
+    Money credited, debited;
+    if (!to.exists || !to.balance.Add(r.amount, &credited)) {
+      res = 4;
+      continue;
+    }
+    Touched &from = lookup(r.from);
+    if (!from.exists || from.balance < r.amount ||
+        !from.balance.Sub(r.amount, &debited)) {
+      res = 3;
+      continue;
+    }
+    to.balance = credited;
+    from.balance = debited;
+    res = 0;
+    applied[i] = 1;
+  }
+
+  int res = 0;
+  for (auto it = touched.begin(); res == 0 && it != touched.end(); ++it) {
+    Money delta;
+    it->second.balance.Sub(it->second.opening, &delta);
+    if (delta.IsPositive() &&
+        !ApplyBalanceDelta(STMT_CREDIT, it->first, delta))
+      res = 6;
+    else if (delta.IsNegative() &&
+             !ApplyBalanceDelta(STMT_DEBIT, it->first, delta.Negated()))
+      res = 6;
+  }
+  for (size_t i = 0; res == 0 && i < requests.size(); i++) {
+    if (!applied[i])
+      continue;
+    const TransferRequest &r = requests[i];
+    Posting legs[2] = {{r.from, r.amount.Negated()}, {r.to, r.amount}};
+    if (!ledger.Post("TRANSFER", legs, 2))
+      res = 6;
+  }
+  for (auto it = firstWithKey.begin(); res == 0 && it != firstWithKey.end();
+       ++it) {
+    int stored, r = keys.Record(it->first, (*results)[it->second], &stored);
+    if (r == 0)
+      recorded->push_back(it->first);
+    else
+      res = r == 1 ? 1 : 6;
+  }
+
+  if (EndSavepoint(res) != 0) {
+    for (auto &key : *recorded)
+      keys.Forget(key);
+    recorded->clear();
+    return res == 0 ? 6 : res;
+  }
+  return 0;
+}
+
+int VaultDB::GetOwnedStocks(const string &accNum, const string &symbol,
+                            double *avgPrice) {
+  CachedStmt s(Stmt(STMT_GET_STOCKS));
+  if (!s)
+    return 0;
+  sqlite3_bind_text(s, 1, accNum.c_str(), -1, SQLITE_TRANSIENT);
+  sqlite3_bind_text(s, 2, symbol.c_str(), -1, SQLITE_TRANSIENT);
+  int qty = 0;
+  if (sqlite3_step(s) == SQLITE_ROW) {
+    qty = sqlite3_column_int(s, 0);
+    if (avgPrice)
+      *avgPrice = sqlite3_column_double(s, 1);
+  }
+  return qty;
+}
+
+bool VaultDB::GetPortfolio(const string &accNum, vector<Position> *out) {
+  out->clear();
+  CachedStmt s(Stmt(STMT_GET_PORTFOLIO));
+  if (!s)
+    return false;
+  sqlite3_bind_text(s, 1, accNum.c_str(), -1, SQLITE_TRANSIENT);
+  int rc;
+  while ((rc = sqlite3_step(s)) == SQLITE_ROW) {
+    const char *sym = (const char *)sqlite3_column_text(s, 0);
+    out->push_back(Position{sym ? sym : "", sqlite3_column_int(s, 1),
+                            sqlite3_column_double(s, 2)});
+  }
+  return rc == SQLITE_DONE;
+}
+
+bool VaultDB::GetAllPositions(vector<Holding> *out) {
+  out->clear();
+  CachedStmt s(Stmt(STMT_GET_ALL_POSITIONS));
+  if (!s)
+    return false;
+  int rc;
+  while ((rc = sqlite3_step(s)) == SQLITE_ROW) {
+    const char *acc = (const char *)sqlite3_column_text(s, 0);
+    const char *sym = (const char *)sqlite3_column_text(s, 1);
+    out->push_back(Holding{acc ? acc : "", sym ? sym : "",
+                           sqlite3_column_int(s, 2),
+                           sqlite3_column_double(s, 3)});
+  }
+  return rc == SQLITE_DONE;
+}
+
+bool VaultDB::UpdateStocks(const string &accNum, const string &symbol,
+                           int delta, double price,
+                           const DurableCallback &onDurable,
+                           const string &idempotencyKey) {
+  int res = committer.BeginOp()
+                ? keys.Run(idempotencyKey,
+                           [&] {
+                             return ApplyStocks(accNum, symbol, delta, price);
+                           })
+                : 6;
+  committer.EndOp(res == 0, ForgetOnRollback(idempotencyKey, onDurable));
+  return res == 0;
+}
+
+// One statement either way. A buy upserts the position, folding its price
+// into the average in SQL; a sell decrements it only while enough shares
+// remain. 3 if they do not.
+int VaultDB::ApplyStocks(const string &accNum, const string &symbol,
+                         int delta, double price) {
+  if (delta == 0)
+    return 0;
+  CachedStmt s(Stmt(delta > 0 ? STMT_BUY_STOCKS : STMT_SELL_STOCKS));
+  if (!s)
+    return 6;
+  if (delta > 0) {
+    sqlite3_bind_text(s, 1, accNum.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_text(s, 2, symbol.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_int(s, 3, delta);
+    sqlite3_bind_double(s, 4, price);
+  } else {
+    sqlite3_bind_int64(s, 1, -(int64_t)delta);
+    sqlite3_bind_text(s, 2, accNum.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_text(s, 3, symbol.c_str(), -1, SQLITE_TRANSIENT);
+  }
+  if (sqlite3_step(s) != SQLITE_DONE)
+    return 6;
+  if (sqlite3_changes(db) == 0)
+    return 3;
+  portfolioVersion++;
+  return 0;
+}
+
+bool VaultDB::BeginBatch() {
+  batchKeys.clear();
+  return committer.Flush() && Exec(STMT_BEGIN);
+}
+
+bool VaultDB::CommitBatch() {
+  if (Exec(STMT_COMMIT))
+    return true;
+  Exec(STMT_ROLLBACK);
+  portfolioVersion++;
+  accountsVersion++;
+  for (auto &key : batchKeys)
+    keys.Forget(key);
+  return false;
+}
+
+int VaultDB::Apply(const Command &cmd) {
+  if (!cmd.key.empty())
+    batchKeys.push_back(cmd.key);
+  return keys.Run(cmd.key, [&] {
+    switch (cmd.kind) {
+    case Command::DEPOSIT:
+      return ApplyCash(STMT_CREDIT, cmd.account, cmd.amount);
+    case Command::WITHDRAW:
+      return ApplyCash(STMT_DEBIT, cmd.account, cmd.amount);
+    case Command::TRANSFER:
+      return ApplyTransfer(cmd.account, cmd.target, cmd.amount);
+    case Command::TRADE:
+      return ApplyTrade(cmd.account, cmd.symbol, cmd.quantity, cmd.price);
+    }
+    return 7;
+  });
+}
+
+int VaultDB::ApplyTrade(const string &accNum, const string &symbol,
+                        int quantity, double price) {
+  OrderLeg leg = {symbol, quantity, price};
+  return ApplyBasket(accNum, &leg, 1);
+}
+
+// Cash, positions, fill rows and ledger entry under one savepoint, each a
+// single guarded statement with nothing read first. The legs are netted so
+// the balance is checked and written once: 3 covers both too little cash
+// for the net buy and too few shares for any sell.
+int VaultDB::ApplyBasket(const string &accNum, const OrderLeg *legs,
+                         size_t n) {
+  if (n == 0)
+    return 5;
+  vector<Money> units(n), cash(n);
+  Money net;
+  bool anyBuy = false;
+  for (size_t i = 0; i < n; i++) {
+    int q = legs[i].quantity;
+    Money cost;
+    if (q == 0 || legs[i].symbol.empty() ||
+        !Money::FromRupees(legs[i].price, &units[i]) ||
+        !units[i].IsPositive() ||
+        !units[i].Mul(q < 0 ? -(int64_t)q : q, &cost))
+      return 5;
+    cash[i] = q > 0 ? cost.Negated() : cost;
+    if (!net.Add(cash[i], &net))
+      return 5;
+    anyBuy = anyBuy || q > 0;
+  }
+  if (!Exec(STMT_SAVEPOINT))
+    return 6;
+  int res = 0;
+  // One write for the net cash; a flat basket only needs the account.
+  bool applied;
+  if (net.IsNegative())
+    applied = ApplyBalanceDelta(STMT_DEBIT, accNum, net.Negated());
+  else if (net.IsPositive())
+    applied = ApplyBalanceDelta(STMT_CREDIT, accNum, net);
+  else
+    applied = GetBalance(accNum, nullptr);
+  if (!applied)
+    res = !GetBalance(accNum, nullptr) ? 4 : net.IsNegative() ? 3 : 5;
+  for (size_t i = 0; res == 0 && i < n; i++) {
+    res = ApplyStocks(accNum, legs[i].symbol, legs[i].quantity,
+                      legs[i].price);
+    if (res != 0)
+      break;
+    CachedStmt s(Stmt(STMT_INSERT_FILL));
+    if (!s) {
+      res = 6;
+      break;
+    }
+    sqlite3_bind_text(s, 1, accNum.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_text(s, 2, legs[i].symbol.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_int(s, 3, legs[i].quantity);
+    sqlite3_bind_int64(s, 4, units[i].Paise());
+    sqlite3_bind_int64(s, 5, cash[i].Paise());
+    if (sqlite3_step(s) != SQLITE_DONE)
+      res = 6;
+  }
+  // A basket whose sells exactly pay for its buys moves no cash.
+  const char *kind = n > 1 ? "BASKET" : anyBuy ? "BUY" : "SELL";
+  Posting post[2] = {{accNum, net}, {Ledger::kMarket, net.Negated()}};
+  if (res == 0 && net != Money() && !ledger.Post(kind, post, 2))
+    res = 6;
+  return EndSavepoint(res);
+}
+
+int VaultDB::ApplyCross(const string &buyer, const string &seller,
+                        const string &symbol, int quantity, double price) {
+  if (quantity <= 0)
+    return 5;
+  if (!Exec(STMT_SAVEPOINT))
+    return 6;
+  OrderLeg buy = {symbol, quantity, price}, sell = {symbol, -quantity, price};
+  int res = ApplyBasket(buyer, &buy, 1);
+  if (res == 0)
+    res = ApplyBasket(seller, &sell, 1);
+  return EndSavepoint(res);
+}
+
+vector<Fill> VaultDB::GetFills(const string &accNum, size_t limit) {
+  vector<Fill> list;
+  CachedStmt s(Stmt(STMT_GET_FILLS));
+  if (!s)
+    return list;
+  sqlite3_bind_text(s, 1, accNum.c_str(), -1, SQLITE_TRANSIENT);
+  sqlite3_bind_int64(s, 2, (sqlite3_int64)limit);
+  while (sqlite3_step(s) == SQLITE_ROW) {
+    Fill f;
+    const char *sym = (const char *)sqlite3_column_text(s, 1);
+    const char *at = (const char *)sqlite3_column_text(s, 5);
+    f.id = sqlite3_column_int64(s, 0);
+    f.symbol = sym ? sym : "";
+    f.quantity = sqlite3_column_int(s, 2);
+    Money::FromPaise(sqlite3_column_int64(s, 3), &f.price);
+    Money::FromPaise(sqlite3_column_int64(s, 4), &f.amount);
+    f.createdAt = at ? at : "";
+    list.push_back(f);
+  }
+  return list;
+}
+
+int VaultDB::Trade(const string &accNum, const string &symbol, int quantity,
+                   double price, const DurableCallback &onDurable,
+                   const string &idempotencyKey) {
+  int res = committer.BeginOp()
+                ? keys.Run(idempotencyKey,
+                           [&] {
+                             return ApplyTrade(accNum, symbol, quantity, price);
+                           })
+                : 6;
+  committer.EndOp(res == 0, ForgetOnRollback(idempotencyKey, onDurable));
+  return res;
+}
+
+int VaultDB::ExecuteBasket(const string &accNum,
+                           const vector<OrderLeg> &legs,
+                           const DurableCallback &onDurable,
+                           const string &idempotencyKey) {
+  int res = committer.BeginOp()
+                ? keys.Run(idempotencyKey,
+                           [&] {
+                             return ApplyBasket(accNum, legs.data(),
+                                                legs.size());
+                           })
+                : 6;
+  committer.EndOp(res == 0, ForgetOnRollback(idempotencyKey, onDurable));
+  return res;
+}
+
+int VaultDB::Cross(const string &buyer, const string &seller,
+                   const string &symbol, int quantity, double price,
+                   const DurableCallback &onDurable,
+                   const string &idempotencyKey) {
+  int res = committer.BeginOp()
+                ? keys.Run(idempotencyKey,
+                           [&] {
+                             return ApplyCross(buyer, seller, symbol,
+                                               quantity, price);
+                           })
+                : 6;
+  committer.EndOp(res == 0, ForgetOnRollback(idempotencyKey, onDurable));
+  return res;
+}
+
+bool VaultDB::VerifyLedger(unsigned threads, LedgerReport *report) {
+  // An open write transaction on this connection keeps every other writer
+  // out while the read connections scan a stable snapshot.
+  if (!committer.Flush() || !Exec(STMT_BEGIN))
+    return false;
+  bool ok = ledger.Verify(threads, report);
+  Exec(STMT_ROLLBACK);
+  return ok;
+}
+
+} // namespace Core
@@ -0,0 +1,254 @@
+#pragma once
+
+#include "CommandQueue.h"
+#include "GroupCommit.h"
+#include "Idempotency.h"
+#include "Ledger.h"
+#include "Money.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct sqlite3;
+struct sqlite3_stmt;
+
+namespace Core {
+
+// Strings are UTF-8; the Win32 front end converts at its own boundary.
+struct Account {
+  std::string accNum, name, pin;
+  Money balance;
+};
+
+// One line of a settlement run: move amount from one account number to
+// another. key is an optional idempotency key; see VaultDB.
+struct TransferRequest {
+  std::string from, to;
+  Money amount;
+  std::string key;
+};
+
+// One executed trade, as recorded in the fills table. quantity is negative
+// for sells; amount is the cash that moved, negative for buys.
+struct Fill {
+  int64_t id;
+  std::string symbol;
+  int quantity;
+  Money price, amount;
+  std::string createdAt;
+};
+
+// One line of a basket order: buy (quantity > 0) or sell (quantity < 0)
+// quantity shares of symbol at price rupees each.
+struct OrderLeg {
+  std::string symbol;
+  int quantity;
+  double price;
+};
+
+// One holding, as read by GetPortfolio.
+struct Position {
+  std::string symbol;
+  int quantity;
+  double avgPrice;
+};
+
+// Any account's position, as read by GetAllPositions.
+struct Holding {
+  std::string accNum, symbol;
+  int quantity;
+  double avgPrice;
+};
+
+struct StmtCacheStats {
+  unsigned long long hits, misses;
+};
+
+class VaultDB : public CommandSink {
+private:
+  sqlite3 *db;
+  bool useNewSchema = true;
+
+  // Every statement the vault runs, compiled once per schema variant and
+  // reused. Rows in kSql must stay in this order.
+  enum StmtId {
+    STMT_SAVEPOINT,
+    STMT_RELEASE,
+    STMT_ROLLBACK_TO,
+    STMT_BEGIN,
+    STMT_COMMIT,
+    STMT_ROLLBACK,
+    STMT_CREATE_ACCOUNT,
+    STMT_LOAD_ACCOUNTS,
+    STMT_GET_BALANCE,
+    STMT_UPDATE_BALANCE,
+    STMT_FIND_BY_NAME,
+    STMT_DEBIT,
+    STMT_CREDIT,
+    STMT_GET_STOCKS,
+    STMT_BUY_STOCKS,
+    STMT_SELL_STOCKS,
+    STMT_INSERT_FILL,
+    STMT_GET_FILLS,
+    STMT_GET_PORTFOLIO,
+    STMT_GET_ALL_POSITIONS,
+    STMT_COUNT
+  };
+  static const char *const kSql[2][STMT_COUNT];
+  sqlite3_stmt *stmtCache[2][STMT_COUNT] = {};
+  StmtCacheStats stmtStats = {0, 0};
+  unsigned long long casRetries = 0;
+  uint64_t portfolioVersion = 0; // see PortfolioVersion
+  uint64_t accountsVersion = 0;  // see AccountsVersion
+  GroupCommitter committer;
+  Ledger ledger;
+  IdempotencyStore keys;
+  std::vector<std::string> batchKeys; // recorded since BeginBatch
+
+  sqlite3_stmt *Stmt(StmtId id);
+  bool Exec(StmtId id);
+  void FinalizeStatements();
+  int EndSavepoint(int res);
+  DurableCallback ForgetOnRollback(const std::string &key,
+                                   const DurableCallback &onDurable);
+  bool ApplyBalanceDelta(StmtId id, const std::string &num, Money amount);
+  int ApplyCash(StmtId id, const std::string &num, Money amount);
+  int ApplyTransfer(const std::string &from, const std::string &toAccNum,
+                    Money amount);
+  bool ReadBalance(const std::string &num, Money *balance, int64_t *version);
+  int ApplyStocks(const std::string &accNum, const std::string &symbol,
+                  int delta, double price);
+  int ApplyTrade(const std::string &accNum, const std::string &symbol,
+                 int quantity, double price);
+  int ApplyBasket(const std::string &accNum, const OrderLeg *legs, size_t n);
+  int ApplyCross(const std::string &buyer, const std::string &seller,
+                 const std::string &symbol, int quantity, double price);
+  int ApplyTransferBatch(const std::vector<TransferRequest> &requests,
+                         std::vector<int> *results,
+                         std::vector<std::string> *recorded);
+
+public:
+  VaultDB() : db(nullptr) {}
+  ~VaultDB() override;
+  VaultDB(const VaultDB &) = delete;
+  VaultDB &operator=(const VaultDB &) = delete;
+
+  // Opens (or creates) the database in WAL mode.
+  bool Init(const std::string &path = "evault.db");
+  StmtCacheStats GetStmtCacheStats() const { return stmtStats; }
+  // Off by default; see GroupCommitter. Mutations take an optional callback
+  // that fires once the change is durable (or is known to have failed).
+  GroupCommitter &GroupCommit() { return committer; }
+  IdempotencyStats GetIdempotencyStats() const { return keys.Stats(); }
+  // Compare-and-swap writes that lost to another writer and were retried.
+  unsigned long long GetCasRetries() const { return casRetries; }
+
+  // Every mutation takes an optional client idempotency key. A key repeated
+  // within IdempotencyConfig::windowSeconds returns the first call's result
+  // without applying anything; see IdempotencyStore. Bool calls report a
+  // repeat of a successful call as true.
+
+  bool CreateAccount(const std::string &num, const std::string &name,
+                     const std::string &pin, Money bal,
+                     const DurableCallback &onDurable = nullptr,
+                     const std::string &idempotencyKey = "");
+  std::vector<Account> LoadAccounts();
+  // As PortfolioVersion, for the accounts table: moves on whenever an
+  // account is created or a balance written through this connection, and on
+  // rollbacks. See AccountDirectory.
+  uint64_t AccountsVersion() const { return accountsVersion; }
+  // Every account whose holder name matches case-insensitively (ASCII), in
+  // account-number order, via the name_key index. Names are not unique, so
+  // callers must handle zero or several matches.
+  std::vector<Account> FindAccountsByName(const std::string &name);
+  bool GetBalance(const std::string &num, Money *balance);
+  // Every balance change below appends a balanced entry to the ledger in
+  // the same savepoint; see Ledger. UpdateBalance books the difference as
+  // an adjustment and exists for callers that only know the target value.
+  bool UpdateBalance(const std::string &num, Money newBal,
+                     const DurableCallback &onDurable = nullptr,
+                     const std::string &idempotencyKey = "");
+  // Relative balance changes; Withdraw fails without touching the row when
+  // funds are short.
+  bool Deposit(const std::string &num, Money amount,
+               const DurableCallback &onDurable = nullptr,
+               const std::string &idempotencyKey = "");
+  bool Withdraw(const std::string &num, Money amount,
+                const DurableCallback &onDurable = nullptr,
+                const std::string &idempotencyKey = "");
+  // Moves money to the account numbered toAccNum; resolve names with
+  // FindAccountsByName first. 0 ok, 2 self, 3 insufficient funds,
+  // 4 no recipient, 5 bad amount, 6 database error.
+  int Transfer(const std::string &from, const std::string &toAccNum,
+               Money amount, const DurableCallback &onDurable = nullptr,
+               const std::string &idempotencyKey = "");
+  // Applies many transfers in one savepoint. Requests are checked in order
+  // against running balances, so (*results)[i] is exactly what Transfer
+  // would have returned had the requests run one after another. Deltas are
+  // netted per account and written with one UPDATE each, plus one ledger
+  // entry per applied request. Keyed requests are deduplicated against
+  // earlier calls and within the batch. False (and every result 6) if the
+  // batch could not be written.
+  bool TransferBatch(const std::vector<TransferRequest> &requests,
+                     std::vector<int> *results,
+                     const DurableCallback &onDurable = nullptr);
+
+  int GetOwnedStocks(const std::string &accNum, const std::string &symbol,
+                     double *avgPrice = nullptr);
+  // Every nonzero position of the account in one query, by symbol.
+  bool GetPortfolio(const std::string &accNum, std::vector<Position> *out);
+  // Every nonzero position of every account, in one scan.
+  bool GetAllPositions(std::vector<Holding> *out);
+  // Moves on whenever a position may have changed through this connection,
+  // rollbacks included, so a copy of GetPortfolio is current for as long as
+  // this still returns what it did before the copy was read. A counter;
+  // reading it never touches SQLite. Other connections' writes are not
+  // counted.
+  uint64_t PortfolioVersion() const { return portfolioVersion; }
+  // Moves only the position; no cash changes hands. Use Trade for orders.
+  bool UpdateStocks(const std::string &accNum, const std::string &symbol,
+                    int delta, double price,
+                    const DurableCallback &onDurable = nullptr,
+                    const std::string &idempotencyKey = "");
+  // Buys (quantity > 0) or sells quantity shares at price rupees each. Cash,
+  // position, a fills row and the ledger entry are written in one savepoint
+  // and one commit, so they never disagree. Codes as for Transfer; 3 also
+  // means too few shares.
+  int Trade(const std::string &accNum, const std::string &symbol,
+            int quantity, double price,
+            const DurableCallback &onDurable = nullptr,
+            const std::string &idempotencyKey = "");
+  // Executes every leg or none, in one savepoint and one commit. The legs'
+  // cash is netted, so sells in the basket fund its buys and the balance is
+  // checked and written once; each leg gets its own fills row, and the net
+  // cash one ledger entry. Legs run in order, so a symbol may appear more
+  // than once. Codes as for Trade; 5 also means an empty basket.
+  int ExecuteBasket(const std::string &accNum,
+                    const std::vector<OrderLeg> &legs,
+                    const DurableCallback &onDurable = nullptr,
+                    const std::string &idempotencyKey = "");
+  // Settles one match between two accounts: buyer pays seller quantity *
+  // price and receives the shares, in one savepoint. Each side gets its
+  // fills row and ledger entry as for Trade, netting to zero at
+  // Ledger::kMarket. Codes as for Trade, from whichever side failed first.
+  int Cross(const std::string &buyer, const std::string &seller,
+            const std::string &symbol, int quantity, double price,
+            const DurableCallback &onDurable = nullptr,
+            const std::string &idempotencyKey = "");
+  // Most recent fills first.
+  std::vector<Fill> GetFills(const std::string &accNum, size_t limit = 50);
+
+  // Checks every projected balance against the ledger postings; see
+  // Ledger::Verify. threads == 0 runs on this connection alone.
+  bool VerifyLedger(unsigned threads, LedgerReport *report);
+
+  // CommandSink, for driving the vault from a CommandWriter. A batch is one
+  // BEGIN IMMEDIATE ... COMMIT; any open group commit batch is flushed
+  // first. Trades move the position and the cash together.
+  bool BeginBatch() override;
+  int Apply(const Command &cmd) override;
+  bool CommitBatch() override;
+};
+
+} // namespace Core
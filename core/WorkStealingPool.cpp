@@ -0,0 +1,115 @@
+#include "WorkStealingPool.h"
+
+using namespace std;
+
+namespace Core {
+
+WorkStealingPool::WorkStealingPool(unsigned n) {
+  if (n == 0)
+    n = max(thread::hardware_concurrency(), 1u);
+  for (unsigned w = 0; w < n; w++)
+    slices.emplace_back(new Slice);
+  for (unsigned w = 1; w < n; w++)
+    threads.emplace_back(&WorkStealingPool::Run, this, w);
+}
+
+WorkStealingPool::~WorkStealingPool() {
+  {
+    lock_guard<mutex> guard(lock);
+    stopping = true;
+  }
+  wake.notify_all();
+  for (auto &t : threads)
+    t.join();
+}
+
+bool WorkStealingPool::Take(unsigned worker, size_t *item) {
+  {
+    Slice &own = *slices[worker];
+    lock_guard<mutex> guard(own.lock);
+    if (own.next < own.end) {
+      *item = own.next++;
+      return true;
+    }
+  }
+  // The victim may have moved on between the scan and the steal, so the
+  // steal rechecks; it always leaves the thief at least one item.
+  for (;;) {
+    unsigned victim = worker;
+    size_t most = 0;
+    for (unsigned w = 0; w < slices.size(); w++) {
+      Slice &s = *slices[w];
+      lock_guard<mutex> guard(s.lock);
+      if (s.end - s.next > most) {
+        most = s.end - s.next;
+        victim = w;
+      }
+    }
+    if (most == 0)
+      return false;
+    size_t lo, hi;
+    {
+      Slice &s = *slices[victim];
+      lock_guard<mutex> guard(s.lock);
+      if (s.next == s.end)
+        continue;
+      hi = s.end;
+      lo = s.next + (s.end - s.next) / 2;
+      s.end = lo;
+    }
+    steals.fetch_add(1, memory_order_relaxed);
+    Slice &own = *slices[worker];
+    lock_guard<mutex> guard(own.lock);
+    *item = lo;
+    own.next = lo + 1;
+    own.end = hi;
+    return true;
+  }
+}
+
+void WorkStealingPool::Work(unsigned worker) {
+  for (size_t item; Take(worker, &item);)
+    (*body)(item, worker);
+}
+
+void WorkStealingPool::Run(unsigned worker) {
+  uint64_t seen = 0;
+  for (;;) {
+    {
+      unique_lock<mutex> guard(lock);
+      wake.wait(guard, [&] { return stopping || generation != seen; });
+      if (stopping)
+        return;
+      seen = generation;
+    }
+    Work(worker);
+    lock_guard<mutex> guard(lock);
+    if (--running == 0)
+      done.notify_all();
+  }
+}
+
+void WorkStealingPool::ParallelFor(size_t items,
+                                   const function<void(size_t, unsigned)> &fn) {
+  size_t n = slices.size();
+  for (size_t w = 0; w < n; w++) {
+    Slice &s = *slices[w];
+    lock_guard<mutex> guard(s.lock);
+    s.next = items * w / n;
+    s.end = items * (w + 1) / n;
+  }
+  body = &fn;
+  {
+    lock_guard<mutex> guard(lock);
+    running = (unsigned)n;
+    generation++;
+  }
+  wake.notify_all();
+  Work(0);
+  unique_lock<mutex> guard(lock);
+  running--;
+  done.wait(guard, [&] { return running == 0; });
+  body = nullptr;
+}
+
+} // namespace Core
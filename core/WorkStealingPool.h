@@ -0,0 +1,57 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Core {
+
+// Runs parallel loops over item indices on a fixed set of threads. Each
+// ParallelFor deals every worker an equal contiguous slice; a worker takes
+// items from the front of its own slice and, once that is empty, steals the
+// back half of whichever slice has most left. Uneven items (accounts with
+// many positions, say) so even out without a shared counter being hit per
+// item. The calling thread is worker 0. One ParallelFor at a time.
+class WorkStealingPool {
+  struct Slice {
+    std::mutex lock;
+    size_t next = 0, end = 0;
+  };
+
+  std::vector<std::unique_ptr<Slice>> slices; // by worker
+  std::vector<std::thread> threads;
+  const std::function<void(size_t, unsigned)> *body = nullptr;
+  std::mutex lock;
+  std::condition_variable wake, done;
+  uint64_t generation = 0;
+  unsigned running = 0; // workers still in the current loop
+  bool stopping = false;
+  std::atomic<uint64_t> steals{0};
+
+  bool Take(unsigned worker, size_t *item);
+  void Work(unsigned worker);
+  void Run(unsigned worker);
+
+public:
+  // threads 0 uses every hardware thread.
+  explicit WorkStealingPool(unsigned threads = 0);
+  ~WorkStealingPool();
+  WorkStealingPool(const WorkStealingPool &) = delete;
+  WorkStealingPool &operator=(const WorkStealingPool &) = delete;
+
+  unsigned Threads() const { return (unsigned)slices.size(); }
+  // body(item, worker) for every item in [0, items), returning once all
+  // have run; worker is below Threads(), for per-thread scratch.
+  void ParallelFor(size_t items,
+                   const std::function<void(size_t, unsigned)> &body);
+  // Slices stolen so far, over all loops.
+  uint64_t Steals() const { return steals.load(std::memory_order_relaxed); }
+};
+
+} // namespace Core
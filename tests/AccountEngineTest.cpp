@@ -0,0 +1,130 @@
+#include "Check.h"
+
+#include "AccountEngine.h"
+
+#include <atomic>
+#include <cstdio>
+#include <random>
+#include <sqlite3.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using Core::Money;
+
+namespace {
+
+Money Rupees(double r) {
+  Money m;
+  Money::FromRupees(r, &m);
+  return m;
+}
+
+vector<string> OpenAccounts(Core::VaultDB &vault, int n, double rupees) {
+  vector<string> nums;
+  for (int i = 0; i < n; i++) {
+    char num[24];
+    snprintf(num, sizeof num, "%08d", 70000000 + i);
+    CHECK(vault.CreateAccount(num, "Holder", "1", Rupees(rupees)));
+    nums.push_back(num);
+  }
+  return nums;
+}
+
+// Threads transferring at random over few shards: no money is created or
+// lost in memory, and once flushed the database agrees account by account.
+void TestConcurrent() {
+  string path = Test::ScratchDb("engine");
+  Test::Cleanup(path);
+  {
+    Core::VaultDB vault;
+    CHECK(vault.Init(path));
+    vector<string> nums = OpenAccounts(vault, 32, 100);
+    Core::AccountEngine engine(vault, 4);
+    CHECK(engine.Load());
+    engine.Start(1);
+
+    const int kThreads = 4, kTransfers = 2000;
+    atomic<int> ok{0};
+    vector<thread> workers;
+    for (int t = 0; t < kThreads; t++)
+      workers.emplace_back([&, t] {
+        mt19937 rng(t);
+        for (int i = 0; i < kTransfers; i++) {
+          const string &from = nums[rng() % nums.size()];
+          const string &to = nums[rng() % nums.size()];
+          int res = engine.Transfer(from, to, Rupees(1 + rng() % 30));
+          CHECK(res == 0 || res == 2 || res == 3);
+          if (res == 0)
+            ok++;
+        }
+      });
+    for (auto &w : workers)
+      w.join();
+    CHECK(engine.Transfer(nums[0], "79999999", Rupees(1)) == 4);
+    CHECK(engine.Transfer(nums[0], nums[1], Money()) == 5);
+    engine.Flush();
+
+    Core::AccountEngineStats st = engine.Stats();
+    CHECK(ok > 0 && st.transfers == (unsigned long long)ok);
+    CHECK(st.persisted == st.transfers && st.diverged == 0 &&
+          st.retries == 0);
+    Money total;
+    for (auto &n : nums) {
+      Money inMemory, onDisk;
+      CHECK(engine.GetBalance(n, &inMemory) && vault.GetBalance(n, &onDisk));
+      CHECK(inMemory == onDisk && !inMemory.IsNegative());
+      total.Add(inMemory, &total);
+    }
+    CHECK(total == Rupees(100 * nums.size()));
+    engine.Stop();
+    Core::LedgerReport r;
+    CHECK(vault.VerifyLedger(0, &r) && r.Ok());
+  }
+  Test::Cleanup(path);
+}
+
+// While another connection holds the write lock every flush fails as a
+// whole. The transfers are kept, not counted as diverged, and written in
+// order once the lock is gone.
+void TestFailedFlush() {
+  string path = Test::ScratchDb("engine_retry");
+  Test::Cleanup(path);
+  {
+    Core::VaultDB vault;
+    CHECK(vault.Init(path));
+    vector<string> nums = OpenAccounts(vault, 2, 10);
+    Core::AccountEngine engine(vault);
+    CHECK(engine.Load());
+
+    sqlite3 *other;
+    sqlite3_open(path.c_str(), &other);
+    CHECK(sqlite3_exec(other, "BEGIN IMMEDIATE;", 0, 0, 0) == SQLITE_OK);
+    CHECK(engine.Transfer(nums[0], nums[1], Rupees(10)) == 0);
+    engine.Flush();
+    Core::AccountEngineStats st = engine.Stats();
+    CHECK(st.persisted == 0 && st.diverged == 0 && st.retries > 0);
+    sqlite3_exec(other, "COMMIT;", 0, 0, 0);
+    sqlite3_close(other);
+
+    // More than the recipient had, so the database refuses it unless the
+    // kept transfer is written first.
+    CHECK(engine.Transfer(nums[1], nums[0], Rupees(15)) == 0);
+    engine.Flush();
+    st = engine.Stats();
+    CHECK(st.persisted == 2 && st.diverged == 0);
+    Money bal;
+    CHECK(vault.GetBalance(nums[0], &bal) && bal == Rupees(15));
+    CHECK(vault.GetBalance(nums[1], &bal) && bal == Rupees(5));
+  }
+  Test::Cleanup(path);
+}
+
+} // namespace
+
+int main() {
+  TestConcurrent();
+  TestFailedFlush();
+  return Test::Failures() != 0;
+}
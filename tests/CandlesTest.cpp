@@ -0,0 +1,226 @@
+#include "Check.h"
+
+#include "Candles.h"
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+namespace {
+
+const long kHeader = 8, kTick = 21, kCandle = 41;
+
+struct Record {
+  bool tick;
+  uint32_t symbol;
+  int64_t time; // tick time or bar period
+  float price, volume;
+  Core::Candle c;
+};
+
+bool Same(const Core::Candle &a, const Core::Candle &b) {
+  return a.start == b.start && a.open == b.open && a.high == b.high &&
+         a.low == b.low && a.close == b.close && a.volume == b.volume &&
+         a.ticks == b.ticks;
+}
+
+bool Same(const Record &a, const Record &b) {
+  if (a.tick != b.tick || a.symbol != b.symbol || a.time != b.time)
+    return false;
+  return a.tick ? a.price == b.price && a.volume == b.volume
+                : Same(a.c, b.c);
+}
+
+bool ReadAll(const string &path, vector<Record> *out) {
+  out->clear();
+  return Core::CandleStore::Read(
+      path,
+      [&](uint32_t s, int64_t t, float p, float v) {
+        Record r = {};
+        r.tick = true;
+        r.symbol = s;
+        r.time = t;
+        r.price = p;
+        r.volume = v;
+        out->push_back(r);
+      },
+      [&](uint32_t s, int64_t period, const Core::Candle &c) {
+        Record r = {};
+        r.symbol = s;
+        r.time = period;
+        r.c = c;
+        out->push_back(r);
+      });
+}
+
+bool Append(Core::CandleStore &store, const Record &r) {
+  return r.tick ? store.AppendTick(r.symbol, r.time, r.price, r.volume)
+                : store.AppendCandle(r.symbol, r.time, r.c);
+}
+
+long FileSize(const string &path) {
+  FILE *f = fopen(path.c_str(), "rb");
+  if (!f)
+    return -1;
+  fseek(f, 0, SEEK_END);
+  long n = ftell(f);
+  fclose(f);
+  return n;
+}
+
+bool CutTo(const string &path, long size) {
+#ifdef _WIN32
+  FILE *f = fopen(path.c_str(), "r+b");
+  bool ok = f && _chsize_s(_fileno(f), size) == 0;
+  if (f)
+    fclose(f);
+  return ok;
+#else
+  return truncate(path.c_str(), size) == 0;
+#endif
+}
+
+bool SameRecords(const vector<Record> &a, const vector<Record> &b) {
+  if (a.size() != b.size())
+    return false;
+  for (size_t i = 0; i < a.size(); i++)
+    if (!Same(a[i], b[i]))
+      return false;
+  return true;
+}
+
+// A write cut short leaves a partial record at the end. Reading skips it,
+// and reopening cuts it off so new records land on a record boundary and
+// read back with everything before them.
+void TestTornTail() {
+  string path = Test::ScratchDb("candles");
+  Test::Cleanup(path);
+  vector<Record> written;
+  for (uint32_t i = 0; i < 6; i++) {
+    Record r = {};
+    r.tick = i % 3 != 2;
+    r.symbol = i;
+    r.time = 1000 * i;
+    r.price = 100.5f + i;
+    r.volume = 10.0f * i;
+    r.c = {60000 * (int64_t)i, 1.0f, 2.0f, 0.5f, 1.5f, 7.0f, i};
+    written.push_back(r);
+  }
+
+  Core::CandleStore store;
+  CHECK(store.Open(path));
+  for (const Record &r : written)
+    CHECK(Append(store, r));
+  store.Close();
+  long full = kHeader + 4 * kTick + 2 * kCandle;
+  CHECK(FileSize(path) == full);
+  vector<Record> read;
+  CHECK(ReadAll(path, &read) && SameRecords(read, written));
+
+  // The last record (a bar) loses its tail.
+  CHECK(CutTo(path, full - 10));
+  written.pop_back();
+  CHECK(ReadAll(path, &read) && SameRecords(read, written));
+
+  Record more = {};
+  more.tick = true;
+  more.symbol = 42;
+  more.time = 99000;
+  more.price = 7.25f;
+  more.volume = 3.0f;
+  CHECK(store.Open(path));
+  CHECK(Append(store, more));
+  store.Close();
+  written.push_back(more);
+  CHECK(FileSize(path) == full - kCandle + kTick);
+  CHECK(ReadAll(path, &read) && SameRecords(read, written));
+
+  // Cut a byte into the second record, right after the first, and down to
+  // the header.
+  for (long cut : {kHeader + kTick + 1, kHeader + kTick, kHeader}) {
+    CHECK(CutTo(path, cut));
+    CHECK(store.Open(path));
+    store.Close();
+    CHECK(FileSize(path) == (cut == kHeader ? kHeader : kHeader + kTick));
+  }
+  CHECK(ReadAll(path, &read) && read.size() == 0);
+
+  // Something that is not a store is left alone.
+  FILE *f = fopen(path.c_str(), "wb");
+  fputs("not a candle store", f);
+  fclose(f);
+  CHECK(!store.Open(path));
+  CHECK(FileSize(path) == (long)strlen("not a candle store"));
+  Test::Cleanup(path);
+}
+
+// Bars logged by an aggregator replay into a fresh one identically, and the
+// bars stored as closed are the ones the aggregator still holds.
+void TestReplay() {
+  string path = Test::ScratchDb("candles_replay");
+  Test::Cleanup(path);
+  const size_t kSymbols = 3;
+  Core::CandleConfig cfg;
+  cfg.periodsMillis = {1000, 5000};
+  cfg.depth = 64;
+  Core::CandleAggregator logged(kSymbols, cfg);
+  Core::CandleStore store;
+  CHECK(store.Open(path));
+  logged.SetSink(&store);
+  double prices[kSymbols] = {100, 50, 10}, volumes[kSymbols] = {1, 2, 3};
+  for (int t = 0; t < 200; t++) {
+    for (size_t s = 0; s < kSymbols; s++)
+      prices[s] *= 1 + 0.001 * ((t * 7 + (int)s * 3) % 11 - 5);
+    logged.OnTicks(t * 250, prices, kSymbols, volumes);
+  }
+  store.Close();
+
+  Core::CandleAggregator replayed(kSymbols, cfg);
+  vector<Record> closed;
+  CHECK(Core::CandleStore::Read(
+      path,
+      [&](uint32_t s, int64_t t, float p, float v) {
+        replayed.OnTick(s, t, p, v);
+      },
+      [&](uint32_t s, int64_t period, const Core::Candle &c) {
+        Record r = {};
+        r.symbol = s;
+        r.time = period;
+        r.c = c;
+        closed.push_back(r);
+      }));
+  vector<Core::Candle> a, b;
+  for (size_t s = 0; s < kSymbols; s++)
+    for (size_t p = 0; p < logged.Periods(); p++) {
+      logged.Window(s, p, cfg.depth, &a);
+      replayed.Window(s, p, cfg.depth, &b);
+      CHECK(a.size() > 1 && a.size() == b.size());
+      bool same = a.size() == b.size();
+      for (size_t i = 0; same && i < a.size(); i++)
+        same = Same(a[i], b[i]);
+      CHECK(same);
+      const Record *last = nullptr;
+      for (const Record &r : closed)
+        if (r.symbol == s && r.time == logged.PeriodMillis(p))
+          last = &r;
+      CHECK(last && a.size() > 1 && Same(last->c, a[a.size() - 2]));
+    }
+  Test::Cleanup(path);
+}
+
+} // namespace
+
+int main() {
+  TestTornTail();
+  TestReplay();
+  return Test::Failures() != 0;
+}
@@ -0,0 +1,69 @@
+#include "Check.h"
+
+#include "VaultDB.h"
+
+#include <chrono>
+#include <future>
+#include <string>
+#include <thread>
+
+using namespace std;
+using Core::Money;
+
+namespace {
+
+Money Rupees(double r) {
+  Money m;
+  Money::FromRupees(r, &m);
+  return m;
+}
+
+// Another connection commits a deposit between UpdateBalance reading the
+// balance and writing it. The stale version matches no row, so the write
+// is retried against the new balance, and the adjustment booked is the
+// difference from that one.
+void TestLostRace() {
+  string path = Test::ScratchDb("cas");
+  Test::Cleanup(path);
+  {
+    Core::VaultDB vault, other;
+    CHECK(vault.Init(path) && other.Init(path));
+    CHECK(vault.CreateAccount("80000001", "Asha", "1", Rupees(100)));
+
+    promise<void> locked;
+    thread writer([&] {
+      Core::Command deposit;
+      deposit.kind = Core::Command::DEPOSIT;
+      deposit.account = "80000001";
+      deposit.amount = Rupees(25);
+      CHECK(other.BeginBatch());
+      CHECK(other.Apply(deposit) == 0);
+      locked.set_value();
+      // Long enough for UpdateBalance to read 100 and block on the lock.
+      this_thread::sleep_for(chrono::milliseconds(200));
+      CHECK(other.CommitBatch());
+    });
+    locked.get_future().wait();
+    CHECK(vault.UpdateBalance("80000001", Rupees(40)));
+    writer.join();
+
+    CHECK(vault.GetCasRetries() == 1);
+    Money bal;
+    CHECK(vault.GetBalance("80000001", &bal) && bal == Rupees(40));
+    Core::LedgerReport r;
+    CHECK(vault.VerifyLedger(0, &r) && r.Ok());
+
+    // Uncontended, the first attempt goes through.
+    CHECK(vault.UpdateBalance("80000001", Rupees(41)));
+    CHECK(vault.GetCasRetries() == 1);
+    CHECK(!vault.UpdateBalance("89999999", Rupees(1)));
+  }
+  Test::Cleanup(path);
+}
+
+} // namespace
+
+int main() {
+  TestLostRace();
+  return Test::Failures() != 0;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstdio>
+#include <string>
+
+// Just enough of a test harness for the core tests: CHECK reports a failed
+// condition and carries on, and each test program returns Failures() from
+// main so ctest sees it.
+namespace Test {
+
+inline int &Failures() {
+  static int failures = 0;
+  return failures;
+}
+
+inline void Fail(const char *file, int line, const char *what) {
+  fprintf(stderr, "%s:%d: CHECK(%s) failed\n", file, line, what);
+  Failures()++;
+}
+
+// A scratch database path in the working directory, removed along with its
+// WAL files by Cleanup.
+inline std::string ScratchDb(const char *name) {
+  return std::string(name) + ".test.db";
+}
+
+inline void Cleanup(const std::string &path) {
+  for (const char *suffix : {"", "-wal", "-shm", "-journal"})
+    remove((path + suffix).c_str());
+}
+
+} // namespace Test
+
+#define CHECK(cond)                                                            \
+  do {                                                                         \
+    if (!(cond))                                                               \
+      Test::Fail(__FILE__, __LINE__, #cond);                                   \
+  } while (0)
@@ -0,0 +1,152 @@
+#include "Check.h"
+
+#include "Idempotency.h"
+#include "VaultDB.h"
+
+#include <sqlite3.h>
+#include <string>
+#include <vector>
+
+using namespace std;
+using Core::Money;
+
+namespace {
+
+Money Rupees(double r) {
+  Money m;
+  Money::FromRupees(r, &m);
+  return m;
+}
+
+Money Balance(Core::VaultDB &vault, const string &num) {
+  Money m;
+  vault.GetBalance(num, &m);
+  return m;
+}
+
+int64_t Rows(sqlite3 *db) {
+  sqlite3_stmt *s;
+  sqlite3_prepare_v2(db, "SELECT count(*) FROM applied;", -1, &s, 0);
+  sqlite3_step(s);
+  int64_t n = sqlite3_column_int64(s, 0);
+  sqlite3_finalize(s);
+  return n;
+}
+
+// The store on its own, with a map small enough that keys fall out of it
+// and have to be found on disk.
+void TestStore() {
+  sqlite3 *db;
+  sqlite3_open(":memory:", &db);
+  sqlite3_exec(db, "CREATE TABLE applied (key TEXT);", 0, 0, 0);
+  Core::IdempotencyStore keys;
+  Core::IdempotencyConfig cfg;
+  cfg.maxEntries = 1;
+  CHECK(keys.Attach(db, cfg));
+  int undone = 0;
+  auto apply = [&](const char *key, int result) {
+    return keys.Run(
+        key,
+        [&] {
+          string sql = string("INSERT INTO applied VALUES ('") + key + "');";
+          sqlite3_exec(db, sql.c_str(), 0, 0, 0);
+          return result;
+        },
+        [&] { undone++; });
+  };
+
+  CHECK(apply("a", 0) == 0);
+  CHECK(apply("a", 5) == 0); // from memory: not applied
+  CHECK(Rows(db) == 1);
+  CHECK(apply("b", 3) == 3); // pushes a out of memory
+  CHECK(apply("a", 5) == 0); // from disk: applied, then rolled back
+  CHECK(Rows(db) == 2 && undone == 1);
+  Core::IdempotencyStats st = keys.Stats();
+  CHECK(st.recorded == 2 && st.hits == 1 && st.replayed == 1);
+
+  // Database errors and unsupported are not remembered, so a retry runs.
+  CHECK(apply("c", 6) == 6);
+  CHECK(apply("c", 0) == 0);
+  CHECK(apply("d", 7) == 7);
+  CHECK(apply("d", 0) == 0);
+  // No key, no deduplication.
+  CHECK(apply("", 0) == 0 && apply("", 0) == 0);
+  CHECK(Rows(db) == 8);
+  keys.Detach();
+  sqlite3_close(db);
+}
+
+// Retried VaultDB calls return the first result and move money once, in the
+// same session, in a batch and after the database is reopened.
+void TestVaultReplay() {
+  string path = Test::ScratchDb("idempotency");
+  Test::Cleanup(path);
+  {
+    Core::VaultDB vault;
+    CHECK(vault.Init(path));
+    CHECK(vault.CreateAccount("30000001", "Asha", "1", Rupees(100), nullptr,
+                              "open-1"));
+    CHECK(vault.CreateAccount("30000001", "Asha", "1", Rupees(100), nullptr,
+                              "open-1"));
+    CHECK(vault.CreateAccount("30000002", "Ravi", "2", Money()));
+
+    CHECK(vault.Transfer("30000001", "30000002", Rupees(30), nullptr, "t-1") ==
+          0);
+    CHECK(vault.Transfer("30000001", "30000002", Rupees(30), nullptr, "t-1") ==
+          0);
+    CHECK(Balance(vault, "30000001") == Rupees(70));
+    CHECK(Balance(vault, "30000002") == Rupees(30));
+
+    // A refusal is an answer too: the retry is refused even though it would
+    // now go through.
+    CHECK(vault.Transfer("30000002", "30000001", Rupees(50), nullptr, "t-2") ==
+          3);
+    CHECK(vault.Deposit("30000002", Rupees(100), nullptr, "d-1"));
+    CHECK(vault.Deposit("30000002", Rupees(100), nullptr, "d-1"));
+    CHECK(vault.Transfer("30000002", "30000001", Rupees(50), nullptr, "t-2") ==
+          3);
+    CHECK(Balance(vault, "30000002") == Rupees(130));
+
+    vector<Core::TransferRequest> batch(3);
+    for (auto &r : batch) {
+      r.from = "30000002";
+      r.to = "30000001";
+      r.amount = Rupees(10);
+    }
+    batch[0].key = batch[1].key = "b-1"; // repeated inside the batch
+    batch[2].key = "t-1";                // and from before
+    batch[2].from = "30000001";
+    batch[2].to = "30000002";
+    vector<int> results;
+    CHECK(vault.TransferBatch(batch, &results));
+    CHECK(results == vector<int>({0, 0, 0}));
+    CHECK(Balance(vault, "30000001") == Rupees(80));
+    CHECK(Balance(vault, "30000002") == Rupees(120));
+    CHECK(vault.Trade("30000001", "TCS", 2, 10, nullptr, "buy-1") == 0);
+    CHECK(vault.Trade("30000001", "TCS", 2, 10, nullptr, "buy-1") == 0);
+    CHECK(vault.GetOwnedStocks("30000001", "TCS") == 2);
+  }
+  {
+    Core::VaultDB vault;
+    CHECK(vault.Init(path));
+    CHECK(vault.Transfer("30000001", "30000002", Rupees(30), nullptr, "t-1") ==
+          0);
+    CHECK(vault.Transfer("30000002", "30000001", Rupees(50), nullptr, "t-2") ==
+          3);
+    CHECK(vault.Trade("30000001", "TCS", 2, 10, nullptr, "buy-1") == 0);
+    CHECK(Balance(vault, "30000001") == Rupees(60));
+    CHECK(Balance(vault, "30000002") == Rupees(120));
+    CHECK(vault.GetOwnedStocks("30000001", "TCS") == 2);
+    Core::LedgerReport r;
+    CHECK(vault.VerifyLedger(0, &r) && r.Ok());
+  }
+  Test::Cleanup(path);
+}
+
+} // namespace
+
+int main() {
+  TestStore();
+  TestVaultReplay();
+  return Test::Failures() != 0;
+}
@@ -0,0 +1,152 @@
+#include "Check.h"
+
+#include "Indicators.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+bool Near(double a, double b) {
+  return fabs(a - b) <= 1e-9 * max(1.0, fabs(b));
+}
+
+bool Near(const Core::IndicatorValues &a, const Core::IndicatorValues &b) {
+  return Near(a.sma, b.sma) && Near(a.ema, b.ema) && Near(a.vwap, b.vwap) &&
+         Near(a.upper, b.upper) && Near(a.lower, b.lower) &&
+         Near(a.rsi, b.rsi) && a.low == b.low && a.high == b.high;
+}
+
+// A random walk long enough to wrap the window many times.
+void Walk(size_t ticks, uint32_t seed, vector<double> *prices,
+          vector<double> *volumes) {
+  mt19937 rng(seed);
+  normal_distribution<double> step(0, 0.01);
+  double p = 100;
+  for (size_t t = 0; t < ticks; t++) {
+    p *= exp(step(rng));
+    prices->push_back(p);
+    volumes->push_back(1 + rng() % 50);
+  }
+}
+
+// Every indicator recomputed from its definition over the ticks so far.
+Core::IndicatorValues Expected(const Core::IndicatorConfig &cfg,
+                               const vector<double> &p,
+                               const vector<double> &v, size_t upTo) {
+  Core::IndicatorValues e;
+  size_t from = upTo > cfg.window ? upTo - cfg.window : 0, k = upTo - from;
+  double sum = 0, sq = 0;
+  e.low = e.high = p[from];
+  for (size_t t = from; t < upTo; t++) {
+    sum += p[t];
+    e.low = min(e.low, p[t]);
+    e.high = max(e.high, p[t]);
+  }
+  e.sma = sum / k;
+  for (size_t t = from; t < upTo; t++)
+    sq += (p[t] - e.sma) * (p[t] - e.sma);
+  double sd = sqrt(sq / k);
+  e.upper = e.sma + cfg.bandWidth * sd;
+  e.lower = e.sma - cfg.bandWidth * sd;
+
+  double pv = 0, vol = 0, alpha = 2.0 / (cfg.emaPeriod + 1);
+  e.ema = p[0];
+  for (size_t t = 0; t < upTo; t++) {
+    pv += p[t] * v[t];
+    vol += v[t];
+    if (t)
+      e.ema = alpha * p[t] + (1 - alpha) * e.ema;
+  }
+  e.vwap = pv / vol;
+
+  // Plain means of the first rsiPeriod moves, then Wilder's smoothing.
+  double gain = 0, loss = 0, n = (double)cfg.rsiPeriod;
+  for (size_t t = 1; t < upTo; t++) {
+    double up = max(p[t] - p[t - 1], 0.0), down = max(p[t - 1] - p[t], 0.0);
+    if (t <= cfg.rsiPeriod) {
+      gain += (up - gain) / t;
+      loss += (down - loss) / t;
+    } else {
+      gain = (gain * (n - 1) + up) / n;
+      loss = (loss * (n - 1) + down) / n;
+    }
+  }
+  e.rsi = gain + loss > 0 ? 100 * gain / (gain + loss) : 50;
+  return e;
+}
+
+void TestDefinitions() {
+  Core::IndicatorConfig cfg;
+  cfg.window = 10;
+  cfg.emaPeriod = 5;
+  cfg.rsiPeriod = 7;
+  vector<double> p, v;
+  Walk(300, 1, &p, &v);
+  Core::SymbolIndicators ind(cfg);
+  bool same = true;
+  for (size_t t = 0; t < p.size(); t++) {
+    ind.Update(p[t], v[t]);
+    same = same && Near(ind.Values(), Expected(cfg, p, v, t + 1));
+  }
+  CHECK(same);
+  CHECK(ind.Ticks() == p.size());
+
+  // No move yet, then only rises.
+  Core::SymbolIndicators flat(cfg);
+  flat.Update(10, 0);
+  CHECK(flat.Values().rsi == 50 && flat.Values().vwap == 10);
+  for (int i = 1; i <= 5; i++)
+    flat.Update(10 + i);
+  CHECK(flat.Values().rsi == 100 && flat.Values().low == 10);
+  flat.ResetVwap();
+  flat.Update(20, 2);
+  CHECK(flat.Values().vwap == 20);
+}
+
+// The vectorized universe gives every symbol what a SymbolIndicators fed
+// the same ticks gives.
+void TestUniverse() {
+  const size_t kSymbols = 5, kTicks = 250;
+  Core::IndicatorConfig cfg;
+  cfg.window = 8;
+  vector<vector<double>> p(kSymbols), v(kSymbols);
+  for (size_t s = 0; s < kSymbols; s++)
+    Walk(kTicks, 10 + s, &p[s], &v[s]);
+
+  Core::IndicatorUniverse universe(kSymbols, cfg);
+  vector<Core::SymbolIndicators> each(kSymbols,
+                                      Core::SymbolIndicators(cfg));
+  vector<double> prices(kSymbols), volumes(kSymbols);
+  bool same = true;
+  for (size_t t = 0; t < kTicks; t++) {
+    if (t == kTicks / 2) {
+      universe.ResetVwap();
+      for (auto &ind : each)
+        ind.ResetVwap();
+    }
+    for (size_t s = 0; s < kSymbols; s++) {
+      prices[s] = p[s][t];
+      volumes[s] = v[s][t];
+      each[s].Update(prices[s], volumes[s]);
+    }
+    universe.Tick(prices.data(), volumes.data());
+    for (size_t s = 0; s < kSymbols; s++)
+      same = same && Near(universe.Values(s), each[s].Values()) &&
+             universe.Sma()[s] == universe.Values(s).sma;
+  }
+  CHECK(same);
+  CHECK(universe.Ticks() == kTicks && universe.Symbols() == kSymbols);
+}
+
+} // namespace
+
+int main() {
+  TestDefinitions();
+  TestUniverse();
+  return Test::Failures() != 0;
+}
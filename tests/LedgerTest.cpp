@@ -0,0 +1,235 @@
+#include "Check.h"
+
+#include "Backend.h"
+#include "CommandQueue.h"
+#include "Ledger.h"
+#include "VaultDB.h"
+
+#include <sqlite3.h>
+#include <string>
+#include <vector>
+
+using namespace std;
+using Core::Money;
+
+namespace {
+
+Money Rupees(double r) {
+  Money m;
+  Money::FromRupees(r, &m);
+  return m;
+}
+
+int64_t Count(sqlite3 *db, const char *sql) {
+  sqlite3_stmt *s;
+  int64_t n = -1;
+  if (sqlite3_prepare_v2(db, sql, -1, &s, 0) != SQLITE_OK)
+    return n;
+  if (sqlite3_step(s) == SQLITE_ROW)
+    n = sqlite3_column_int64(s, 0);
+  sqlite3_finalize(s);
+  return n;
+}
+
+// Entries whose legs do not sum to zero, read straight from the tables.
+int64_t UnbalancedEntries(sqlite3 *db) {
+  return Count(db, "SELECT count(*) FROM (SELECT entry_id FROM "
+                   "ledger_postings GROUP BY entry_id HAVING sum(amount) "
+                   "!= 0);");
+}
+
+void TestBareLedger() {
+  sqlite3 *db;
+  sqlite3_open(":memory:", &db);
+  sqlite3_exec(db,
+               "CREATE TABLE accounts (num TEXT PRIMARY KEY, balance "
+               "INTEGER);"
+               "INSERT INTO accounts VALUES ('A', 1000), ('B', 0), ('C', "
+               "-250);",
+               0, 0, 0);
+  Core::Ledger ledger;
+  CHECK(ledger.Attach(db, "SELECT num, balance FROM accounts;"));
+  // Opening entries for the nonzero balances.
+  CHECK(Count(db, "SELECT count(*) FROM ledger_entries;") == 2);
+  Core::LedgerReport r;
+  CHECK(ledger.Verify(1, &r) && r.Ok() && r.entries == 2);
+
+  Core::Posting unbalanced[2] = {{"A", Rupees(5)}, {"B", Rupees(-4)}};
+  CHECK(!ledger.Post("TRANSFER", unbalanced, 2));
+  CHECK(Count(db, "SELECT count(*) FROM ledger_entries;") == 2);
+
+  // Posted but not yet projected: the verifier names the account.
+  Core::Posting legs[3] = {{"A", Rupees(-3)},
+                           {"B", Rupees(2)},
+                           {Core::Ledger::kCash, Rupees(1)}};
+  CHECK(ledger.Post("TRANSFER", legs, 3));
+  CHECK(ledger.Verify(1, &r) && !r.Ok());
+  CHECK(r.mismatched == vector<string>({"A", "B"}));
+  sqlite3_exec(db,
+               "UPDATE accounts SET balance = balance - 300 WHERE num = 'A';"
+               "UPDATE accounts SET balance = balance + 200 WHERE num = 'B';",
+               0, 0, 0);
+  CHECK(ledger.Verify(1, &r) && r.Ok() && r.entries == 3 &&
+        r.postings == 7);
+  CHECK(UnbalancedEntries(db) == 0);
+  ledger.Detach();
+  sqlite3_close(db);
+}
+
+// Every kind of balance change VaultDB makes keeps the journal balanced and
+// the projection equal to it, however many threads verify.
+void TestVaultDB() {
+  string path = Test::ScratchDb("ledger_vault");
+  Test::Cleanup(path);
+  {
+    Core::VaultDB vault;
+    CHECK(vault.Init(path));
+    CHECK(vault.CreateAccount("10000001", "Asha", "1", Rupees(1000)));
+    CHECK(vault.CreateAccount("10000002", "Ravi", "2", Money()));
+    CHECK(vault.CreateAccount("10000003", "Meera", "3", Rupees(50)));
+    CHECK(vault.Deposit("10000002", Rupees(300.25)));
+    CHECK(vault.Withdraw("10000001", Rupees(100)));
+    CHECK(!vault.Withdraw("10000003", Rupees(51)));
+    CHECK(vault.Transfer("10000001", "10000003", Rupees(25.5)) == 0);
+    CHECK(vault.Transfer("10000003", "10000001", Rupees(1000)) == 3);
+    CHECK(vault.Trade("10000001", "TCS", 3, 100) == 0);
+    CHECK(vault.Trade("10000001", "TCS", -1, 120) == 0);
+    CHECK(vault.ExecuteBasket("10000002", {{"INFY", 2, 10}, {"TCS", 1, 20}}) ==
+          0);
+    CHECK(vault.Cross("10000002", "10000001", "TCS", 2, 110) == 0);
+    CHECK(vault.UpdateBalance("10000003", Rupees(7)));
+    vector<Core::TransferRequest> batch(2);
+    batch[0].from = "10000001";
+    batch[0].to = "10000002";
+    batch[0].amount = Rupees(1);
+    batch[1].from = "10000002";
+    batch[1].to = "10000003";
+    batch[1].amount = Rupees(2);
+    vector<int> results;
+    CHECK(vault.TransferBatch(batch, &results));
+
+    for (unsigned threads : {0u, 1u, 4u}) {
+      Core::LedgerReport r;
+      CHECK(vault.VerifyLedger(threads, &r) && r.Ok());
+      CHECK(r.entries >= 12 && r.accounts == vault.LoadAccounts().size());
+    }
+  }
+
+  sqlite3 *db;
+  sqlite3_open(path.c_str(), &db);
+  CHECK(UnbalancedEntries(db) == 0);
+  // Which makes the whole journal sum to zero too.
+  CHECK(Count(db, "SELECT sum(amount) FROM ledger_postings;") == 0);
+  // A balance written behind the ledger's back is caught.
+  sqlite3_exec(db,
+               "UPDATE accounts SET balance = balance + 1 WHERE acc_num = "
+               "'10000002';",
+               0, 0, 0);
+  sqlite3_close(db);
+  {
+    Core::VaultDB vault;
+    CHECK(vault.Init(path));
+    Core::LedgerReport r;
+    CHECK(vault.VerifyLedger(2, &r) && !r.Ok());
+    CHECK(r.mismatched == vector<string>({"10000002"}));
+  }
+  Test::Cleanup(path);
+}
+
+// The legacy Database posts the same entries, so a database it shares with
+// VaultDB still verifies.
+void TestBackend() {
+  string path = Test::ScratchDb("ledger_backend");
+  Test::Cleanup(path);
+  {
+    EvaultApp::Database legacy;
+    CHECK(legacy.init(path));
+    EvaultApp::Account a("20000001", "Asha", "1", Rupees(500));
+    EvaultApp::Account b("20000002", "Ravi", "2", Money());
+    CHECK(legacy.saveAccount(a) && legacy.saveAccount(b));
+    CHECK(a.deposit(Rupees(250)) && legacy.updateAccount(a));
+    CHECK(!legacy.updateAccount(EvaultApp::Account("20000009", "No", "9",
+                                                   Rupees(1))));
+
+    Core::Command cmds[4];
+    cmds[0].kind = Core::Command::DEPOSIT;
+    cmds[0].account = "20000002";
+    cmds[0].amount = Rupees(40);
+    cmds[1].kind = Core::Command::WITHDRAW;
+    cmds[1].account = "20000001";
+    cmds[1].amount = Rupees(10);
+    cmds[2].kind = Core::Command::TRANSFER;
+    cmds[2].account = "20000001";
+    cmds[2].target = "20000002";
+    cmds[2].amount = Rupees(90);
+    cmds[3].kind = Core::Command::TRANSFER;
+    cmds[3].account = "20000002";
+    cmds[3].target = "20000001";
+    cmds[3].amount = Rupees(1000);
+    CHECK(legacy.BeginBatch());
+    CHECK(legacy.Apply(cmds[0]) == 0);
+    CHECK(legacy.Apply(cmds[1]) == 0);
+    CHECK(legacy.Apply(cmds[2]) == 0);
+    CHECK(legacy.Apply(cmds[3]) == 3);
+    CHECK(legacy.CommitBatch());
+    CHECK(legacy.findAccount("20000001")->getBalance() == Rupees(650));
+    CHECK(legacy.findAccount("20000002")->getBalance() == Rupees(130));
+  }
+  Core::VaultDB vault;
+  CHECK(vault.Init(path));
+  Core::LedgerReport r;
+  CHECK(vault.VerifyLedger(0, &r) && r.Ok() && r.accounts == 2);
+  // An opening, the adjustment and three commands.
+  CHECK(r.entries == 5);
+  Test::Cleanup(path);
+}
+
+// VaultDB and the legacy Database writing the same rows in turn: neither
+// overwrites the other's change, and the ledger still matches.
+void TestShared() {
+  string path = Test::ScratchDb("ledger_shared");
+  Test::Cleanup(path);
+  {
+    EvaultApp::Database legacy;
+    CHECK(legacy.init(path));
+    EvaultApp::Account a("20000011", "Asha", "1", Rupees(100));
+    EvaultApp::Account b("20000012", "Ravi", "2", Rupees(20));
+    CHECK(legacy.saveAccount(a) && legacy.saveAccount(b));
+    Core::VaultDB vault;
+    CHECK(vault.Init(path));
+    {
+      Core::CommandWriter writer(legacy);
+      CHECK(vault.Deposit("20000011", Rupees(50)));
+      CHECK(writer.Deposit("20000011", Rupees(10)).get() == 0);
+      CHECK(vault.Withdraw("20000012", Rupees(15)));
+      // The cache still says 20; the row says 5.
+      CHECK(writer.Transfer("20000012", "20000011", Rupees(10)).get() == 3);
+      CHECK(writer.Transfer("20000011", "20000012", Rupees(30)).get() == 0);
+      CHECK(vault.Transfer("20000012", "20000011", Rupees(35)) == 0);
+      CHECK(writer.Withdraw("20000011", Rupees(5)).get() == 0);
+    }
+    legacy.refreshAccounts();
+    CHECK(legacy.findAccount("20000011")->getBalance() == Rupees(160));
+    CHECK(legacy.findAccount("20000012")->getBalance() == Money());
+
+    // An overwrite from a stale copy books its difference from the row.
+    CHECK(vault.Deposit("20000012", Rupees(7)));
+    EvaultApp::Account stale = *legacy.findAccount("20000012");
+    CHECK(stale.deposit(Rupees(1)) && legacy.updateAccount(stale));
+    Money bal;
+    CHECK(vault.GetBalance("20000012", &bal) && bal == Rupees(1));
+    Core::LedgerReport r;
+    CHECK(vault.VerifyLedger(0, &r) && r.Ok() && r.accounts == 2);
+  }
+  Test::Cleanup(path);
+}
+
+} // namespace
+
+int main() {
+  TestBareLedger();
+  TestVaultDB();
+  TestBackend();
+  TestShared();
+  return Test::Failures() != 0;
+}
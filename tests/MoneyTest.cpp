@@ -0,0 +1,100 @@
+#include "Check.h"
+
+#include "Money.h"
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+using namespace std;
+using Core::Money;
+
+namespace {
+
+void TestRange() {
+  Money m;
+  CHECK(Money::FromPaise(Money::kMaxPaise, &m));
+  CHECK(m.Paise() == Money::kMaxPaise);
+  CHECK(Money::FromPaise(-Money::kMaxPaise, &m));
+  CHECK(!Money::FromPaise(Money::kMaxPaise + 1, &m));
+  CHECK(!Money::FromPaise(-Money::kMaxPaise - 1, &m));
+  CHECK(m.Paise() == -Money::kMaxPaise); // untouched on failure
+
+  Money max, one, out;
+  Money::FromPaise(Money::kMaxPaise, &max);
+  Money::FromPaise(1, &one);
+  CHECK(!max.Add(one, &out));
+  CHECK(!max.Negated().Sub(one, &out));
+  CHECK(max.Sub(one, &out) && out.Paise() == Money::kMaxPaise - 1);
+  CHECK(!max.Mul(2, &out));
+  CHECK(!one.Mul(INT64_MAX, &out));
+  CHECK(!max.Mul(INT64_MIN, &out));
+  CHECK(one.Mul(-5, &out) && out.Paise() == -5);
+  CHECK(max.Negated().Negated() == max);
+}
+
+void TestRupees() {
+  Money m;
+  CHECK(Money::FromRupees(10.004, &m) && m.Paise() == 1000);
+  CHECK(Money::FromRupees(10.006, &m) && m.Paise() == 1001);
+  CHECK(Money::FromRupees(-0.5, &m) && m.Paise() == -50);
+  CHECK(!Money::FromRupees(NAN, &m));
+  CHECK(!Money::FromRupees(INFINITY, &m));
+  CHECK(!Money::FromRupees(1e14, &m));
+}
+
+void TestParse() {
+  Money m;
+  CHECK(Money::Parse("12.34", &m) && m.Paise() == 1234);
+  CHECK(Money::Parse("12.3", &m) && m.Paise() == 1230);
+  CHECK(Money::Parse("7", &m) && m.Paise() == 700);
+  CHECK(Money::Parse("-0.05", &m) && m.Paise() == -5);
+  CHECK(Money::Parse(".5", &m) && m.Paise() == 50);
+  CHECK(Money::Parse("90071992547409.91", &m) &&
+        m.Paise() == Money::kMaxPaise);
+  for (const char *bad : {"", "-", ".", "1.234", "1e3", "+1", " 1", "1 ",
+                          "1,000", "abc", "--1", "90071992547409.92",
+                          "99999999999999999999"})
+    CHECK(!Money::Parse(bad, &m));
+}
+
+void TestToString() {
+  Money m;
+  Money::FromPaise(-123450, &m);
+  CHECK(m.ToString() == "-1234.50");
+  Money::FromPaise(5, &m);
+  CHECK(m.ToString() == "0.05");
+  CHECK(Money().ToString() == "0.00");
+  Money back;
+  Money::FromPaise(-Money::kMaxPaise, &m);
+  CHECK(Money::Parse(m.ToString(), &back) && back == m);
+}
+
+void TestSum() {
+  // More than one block, so the carry between blocks is exercised.
+  vector<Money> values(3000);
+  for (size_t i = 0; i < values.size(); i++)
+    Money::FromPaise((int64_t)i - 1000, &values[i]);
+  Money total;
+  CHECK(Core::SumMoney(values.data(), values.size(), &total));
+  CHECK(total.Paise() == 3000LL * 2999 / 2 - 3000LL * 1000);
+
+  Money::FromPaise(Money::kMaxPaise, &values[0]);
+  Money::FromPaise(Money::kMaxPaise, &values[1]);
+  CHECK(!Core::SumMoney(values.data(), 2, &total));
+  // Inside a block only the block's total has to be in range.
+  Money::FromPaise(-Money::kMaxPaise, &values[2]);
+  CHECK(Core::SumMoney(values.data(), 3, &total) &&
+        total.Paise() == Money::kMaxPaise);
+}
+
+} // namespace
+
+int main() {
+  TestRange();
+  TestRupees();
+  TestParse();
+  TestToString();
+  TestSum();
+  return Test::Failures() != 0;
+}
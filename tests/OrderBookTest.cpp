@@ -0,0 +1,130 @@
+#include "Check.h"
+
+#include "Exchange.h"
+#include "OrderBook.h"
+
+#include <string>
+#include <vector>
+
+using namespace std;
+using Core::BUY;
+using Core::SELL;
+
+namespace {
+
+void TestMatching() {
+  Core::OrderBook book(100);
+  vector<Core::BookMatch> m;
+  uint32_t left, tick;
+  uint64_t tq;
+  CHECK(!book.BestBid(&tick) && !book.BestAsk(&tick));
+
+  uint64_t a = book.Limit(SELL, 1, 50, 10, &m, &left);
+  uint64_t b = book.Limit(SELL, 2, 50, 5, &m, &left);
+  uint64_t c = book.Limit(SELL, 3, 52, 7, &m, &left);
+  CHECK(a && b > a && c > b && m.empty() && left == 7);
+  CHECK(book.BestAsk(&tick) && tick == 50);
+  CHECK(book.Depth(SELL, 50) == 15 && book.Resting() == 3);
+  CHECK(book.Sweep(BUY, 51, 100, &tq) == 15 && tq == 15 * 50);
+
+  // Best price first, then arrival order within the level, always at the
+  // maker's price; nothing crosses beyond the limit.
+  uint64_t d = book.Limit(BUY, 9, 51, 12, &m, &left);
+  CHECK(d > c && left == 0 && m.size() == 2);
+  CHECK(m[0].maker == a && m[0].taker == d && m[0].quantity == 10 &&
+        m[0].makerLeft == 0 && m[0].tick == 50 && m[0].makerOwner == 1 &&
+        m[0].takerOwner == 9 && m[0].takerSide == BUY);
+  CHECK(m[1].maker == b && m[1].quantity == 2 && m[1].makerLeft == 3);
+  CHECK(book.Resting() == 2 && book.Depth(SELL, 50) == 3);
+
+  m.clear();
+  uint64_t e = book.Limit(BUY, 9, 53, 20, &m, &left);
+  CHECK(m.size() == 2 && m[0].maker == b && m[0].quantity == 3 &&
+        m[1].maker == c && m[1].tick == 52 && m[1].quantity == 7);
+  CHECK(left == 10 && !book.BestAsk(&tick));
+  CHECK(book.BestBid(&tick) && tick == 53);
+
+  m.clear();
+  CHECK(book.Market(SELL, 4, 15, &m) == 10);
+  CHECK(m.size() == 1 && m[0].maker == e && m[0].makerLeft == 0 &&
+        m[0].takerSide == SELL);
+  CHECK(book.Resting() == 0 && !book.BestBid(&tick));
+  m.clear();
+  CHECK(book.Market(BUY, 4, 5, &m) == 0 && m.empty());
+  CHECK(!book.Cancel(e, &left));
+
+  // A cancelled order gives up its place; the next one keeps its own.
+  uint64_t f = book.Limit(SELL, 1, 60, 4, &m, &left);
+  uint64_t g = book.Limit(SELL, 2, 60, 6, &m, &left);
+  CHECK(book.Cancel(f, &left) && left == 4);
+  CHECK(!book.Cancel(f, &left));
+  CHECK(book.Depth(SELL, 60) == 6);
+  m.clear();
+  CHECK(book.Market(BUY, 5, 1, &m) == 1 && m[0].maker == g &&
+        m[0].makerLeft == 5);
+
+  CHECK(book.Limit(BUY, 1, 100, 1, &m, &left) == 0);
+  CHECK(book.Limit(BUY, 1, 10, 0, &m, &left) == 0);
+}
+
+Core::Money Balance(Core::VaultDB &vault, const string &num) {
+  Core::Money m;
+  vault.GetBalance(num, &m);
+  return m;
+}
+
+// Matches settle through VaultDB: cash and shares move between the two
+// accounts and orders are held to what each can cover.
+void TestExchange() {
+  string path = Test::ScratchDb("orderbook");
+  Test::Cleanup(path);
+  {
+    Core::VaultDB vault;
+    CHECK(vault.Init(path));
+    vector<Core::Stock> market = Core::DefaultMarket(16);
+    const Core::Stock &s = market[0];
+    Core::Money cash;
+    Core::Money::FromRupees(s.price * 4, &cash);
+    CHECK(vault.CreateAccount("40000001", "Seller", "1", Core::Money()));
+    CHECK(vault.CreateAccount("40000002", "Buyer", "2", cash));
+    CHECK(vault.UpdateStocks("40000001", s.symbol, 10, s.price));
+
+    Core::Exchange ex(vault, market);
+    uint64_t ask = 0, bid = 0;
+    CHECK(ex.Submit("40000001", s.symbol, -5, s.price, &ask) == 0 && ask);
+    // Five of the ten are on offer already.
+    CHECK(ex.Submit("40000001", s.symbol, -6, s.price) == 3);
+    CHECK(ex.Submit("40000002", s.symbol, 5, s.price) == 3);
+
+    vector<Core::Execution> execs;
+    CHECK(ex.Submit("40000002", s.symbol, 3, s.price, &bid, &execs) == 0);
+    CHECK(bid == 0 && execs.size() == 1);
+    CHECK(execs[0].buyer == "40000002" && execs[0].seller == "40000001" &&
+          execs[0].quantity == 3);
+    Core::Money paid, left;
+    CHECK(execs[0].price.Mul(3, &paid) && cash.Sub(paid, &left));
+    CHECK(Balance(vault, "40000002") == left);
+    CHECK(Balance(vault, "40000001") == paid);
+    CHECK(vault.GetOwnedStocks("40000002", s.symbol) == 3);
+    CHECK(vault.GetOwnedStocks("40000001", s.symbol) == 7);
+
+    // The two still resting are withdrawn and the shares free to sell.
+    CHECK(ex.Cancel(ask) && !ex.Cancel(ask));
+    double bidPx, askPx;
+    CHECK(!ex.Quote(s.symbol, &bidPx, &askPx));
+    CHECK(ex.Submit("40000001", s.symbol, -7, s.price) == 0);
+    CHECK(ex.Stats().matches == 1 && ex.Stats().refused == 0);
+
+    Core::LedgerReport r;
+    CHECK(vault.VerifyLedger(0, &r) && r.Ok());
+  }
+  Test::Cleanup(path);
+}
+
+} // namespace
+
+int main() {
+  TestMatching();
+  TestExchange();
+  return Test::Failures() != 0;
+}
@@ -0,0 +1,85 @@
+#include "Check.h"
+
+#include "RingBuffer.h"
+
+#include <algorithm>
+#include <deque>
+#include <random>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+// Contents, spans and extremes against a deque holding the same values,
+// at capacities around the wrap and over values with many ties.
+void TestAgainstDeque() {
+  for (size_t cap : {1, 2, 3, 7, 64}) {
+    Core::RingBuffer<int> ring(cap);
+    deque<int> model;
+    mt19937 rng(cap);
+    bool same = true;
+    for (int i = 0; i < 500; i++) {
+      int v = (int)(rng() % 10);
+      ring.Push(v);
+      model.push_back(v);
+      if (model.size() > cap)
+        model.pop_front();
+
+      same = same && ring.Size() == model.size() && ring.Back() == v;
+      for (size_t j = 0; same && j < model.size(); j++)
+        same = ring[j] == model[j];
+      same = same &&
+             ring.Min() == *min_element(model.begin(), model.end()) &&
+             ring.Max() == *max_element(model.begin(), model.end());
+
+      Core::RingBuffer<int>::Span a, b;
+      ring.Spans(&a, &b);
+      vector<int> joined(a.data, a.data + a.size);
+      joined.insert(joined.end(), b.data, b.data + b.size);
+      same = same && joined == vector<int>(model.begin(), model.end());
+    }
+    CHECK(same);
+    CHECK(ring.Capacity() == cap);
+  }
+}
+
+void TestEdges() {
+  Core::RingBuffer<int> none;
+  none.Push(1);
+  CHECK(none.Empty() && none.Capacity() == 0);
+
+  Core::RingBuffer<double> seeded = {3, 1, 2};
+  CHECK(seeded.Capacity() == 3 && seeded.Size() == 3);
+  CHECK(seeded.Min() == 1 && seeded.Max() == 3);
+  seeded.Push(0.5);
+  CHECK(seeded[0] == 1 && seeded.Back() == 0.5 && seeded.Max() == 2);
+  Core::RingBuffer<double>::Span a, b;
+  seeded.Spans(&a, &b);
+  CHECK(a.size + b.size == 3 && b.size == 1);
+
+  // Shrinking keeps the newest values; growing keeps them all.
+  seeded.Resize(2);
+  CHECK(seeded.Size() == 2 && seeded[0] == 2 && seeded[1] == 0.5);
+  CHECK(seeded.Min() == 0.5 && seeded.Max() == 2);
+  seeded.Resize(5);
+  seeded.Push(4);
+  CHECK(seeded.Size() == 3 && seeded[0] == 2 && seeded.Max() == 4);
+  seeded.Reset(4);
+  CHECK(seeded.Empty() && seeded.Capacity() == 4);
+
+  // Without extremes it is still the same ring.
+  Core::RingBuffer<int, false> plain(2);
+  plain.Push(1);
+  plain.Push(2);
+  plain.Push(3);
+  CHECK(plain.Size() == 2 && plain[0] == 2 && plain.Back() == 3);
+}
+
+} // namespace
+
+int main() {
+  TestAgainstDeque();
+  TestEdges();
+  return Test::Failures() != 0;
+}
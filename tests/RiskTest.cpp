@@ -0,0 +1,90 @@
+#include "Check.h"
+
+#include "Risk.h"
+
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+// A book of long and short positions over a few symbols.
+void Build(Core::ValuationEngine *book, vector<double> *prices) {
+  const size_t kSymbols = 9, kAccounts = 150;
+  vector<string> symbols;
+  for (size_t s = 0; s < kSymbols; s++)
+    symbols.push_back("S" + to_string(s));
+  book->Reset(symbols);
+  mt19937 rng(3);
+  for (size_t i = 0; i < kAccounts; i++) {
+    size_t a = book->AddAccount(to_string(30000000 + i), rng() % 10000);
+    for (int k = 0; k < 4; k++)
+      book->AddPosition(a, rng() % kSymbols, (int)(rng() % 100) - 30,
+                        10 + rng() % 300);
+  }
+  book->Finish();
+  prices->resize(kSymbols);
+  for (auto &p : *prices)
+    p = 10 + rng() % 300;
+}
+
+// Same seed, same report to the bit, whatever the pool's thread count.
+void TestThreadCounts() {
+  Core::ValuationEngine book;
+  vector<double> prices;
+  Build(&book, &prices);
+  Core::RiskConfig cfg;
+  cfg.seed = 42;
+  cfg.scenarios = 5000;
+  cfg.covariance = Core::UniformCovariance(vector<double>(9, 0.3), 0.4);
+
+  vector<Core::RiskReport> reports;
+  for (unsigned threads : {1, 2, 4}) {
+    Core::WorkStealingPool pool(threads);
+    Core::RiskEngine risk(pool);
+    Core::RiskReport r;
+    CHECK(risk.Run(book, prices.data(), cfg, &r));
+    reports.push_back(r);
+  }
+  const Core::RiskReport &one = reports[0];
+  CHECK(one.scenarios == 5000 && one.tail == 50);
+  CHECK(one.var > 0 && one.es >= one.var);
+  CHECK(one.accountVar.size() == book.Accounts());
+  for (const Core::RiskReport &r : reports) {
+    CHECK(r.var == one.var && r.es == one.es && r.tail == one.tail);
+    CHECK(r.accountVar == one.accountVar && r.accountEs == one.accountEs);
+  }
+
+  // Another seed draws other scenarios.
+  Core::WorkStealingPool pool(2);
+  Core::RiskEngine risk(pool);
+  Core::RiskReport other;
+  cfg.seed = 43;
+  CHECK(risk.Run(book, prices.data(), cfg, &other) && other.var != one.var);
+}
+
+// A covariance of the wrong size or not positive definite is refused.
+void TestBadCovariance() {
+  Core::ValuationEngine book;
+  vector<double> prices;
+  Build(&book, &prices);
+  Core::WorkStealingPool pool(1);
+  Core::RiskEngine risk(pool);
+  Core::RiskReport r;
+  Core::RiskConfig cfg;
+  cfg.scenarios = 100;
+  cfg.covariance = Core::UniformCovariance(vector<double>(8, 0.3), 0.4);
+  CHECK(!risk.Run(book, prices.data(), cfg, &r));
+  cfg.covariance = Core::UniformCovariance(vector<double>(9, 0.3), 1.5);
+  CHECK(!risk.Run(book, prices.data(), cfg, &r));
+}
+
+} // namespace
+
+int main() {
+  TestThreadCounts();
+  TestBadCovariance();
+  return Test::Failures() != 0;
+}
@@ -0,0 +1,154 @@
+#include "Check.h"
+
+#include "Schema.h"
+
+#include <sqlite3.h>
+#include <string>
+
+using namespace std;
+
+namespace {
+
+// The schema evault.db shipped with, rupees as REAL.
+const char *kBaseline =
+    "CREATE TABLE accounts (account_number TEXT PRIMARY KEY,holder_name TEXT "
+    "NOT NULL,pin TEXT NOT NULL,balance REAL DEFAULT 0.0,created_at DATETIME "
+    "DEFAULT CURRENT_TIMESTAMP);"
+    "CREATE TABLE transactions (id INTEGER PRIMARY KEY AUTOINCREMENT,"
+    "account_number TEXT NOT NULL,type TEXT NOT NULL,amount REAL NOT NULL,"
+    "target_account TEXT,timestamp DATETIME DEFAULT CURRENT_TIMESTAMP,FOREIGN "
+    "KEY (account_number) REFERENCES accounts(account_number));"
+    "CREATE TABLE portfolio (acc_num TEXT, symbol TEXT, quantity INTEGER, "
+    "PRIMARY KEY(acc_num, symbol));"
+    "INSERT INTO accounts (account_number, holder_name, pin, balance) VALUES "
+    "('11111111', 'Asha', '1234', 4900.0), ('22222222', 'Ravi', '0000', "
+    "0.1), ('33333333', 'Meera', '4321', 99997680.006);"
+    "INSERT INTO transactions (account_number, type, amount) VALUES "
+    "('11111111', 'DEPOSIT', 5000.0), ('11111111', 'WITHDRAW', 100.0), "
+    "('22222222', 'DEPOSIT', 0.1);";
+
+// First column of the first row as text, "" if there is none.
+string Scalar(sqlite3 *db, const string &sql) {
+  string out;
+  sqlite3_stmt *s;
+  if (sqlite3_prepare_v2(db, sql.c_str(), -1, &s, 0) != SQLITE_OK)
+    return "<error>";
+  if (sqlite3_step(s) == SQLITE_ROW && sqlite3_column_text(s, 0))
+    out = (const char *)sqlite3_column_text(s, 0);
+  sqlite3_finalize(s);
+  return out;
+}
+
+bool Exec(sqlite3 *db, const string &sql) {
+  return sqlite3_exec(db, sql.c_str(), 0, 0, 0) == SQLITE_OK;
+}
+
+void TestBaselineMigration(bool foreignKeys) {
+  sqlite3 *db;
+  sqlite3_open(":memory:", &db);
+  CHECK(Exec(db, kBaseline));
+  CHECK(Exec(db, "CREATE INDEX idx_tx_type ON transactions(type);"
+                 "CREATE VIEW rich AS SELECT * FROM accounts WHERE "
+                 "balance > 1000;"));
+  if (foreignKeys)
+    Exec(db, "PRAGMA foreign_keys = ON;");
+  string seq = Scalar(db, "SELECT seq FROM sqlite_sequence;");
+
+  CHECK(Core::MigrateMoneyColumns(db));
+  CHECK(Scalar(db, "SELECT type FROM pragma_table_info('accounts') WHERE "
+                   "name = 'balance';") == "INTEGER");
+  CHECK(Scalar(db, "SELECT type FROM pragma_table_info('transactions') "
+                   "WHERE name = 'amount';") == "INTEGER");
+  // Rupees became paise, rounded.
+  CHECK(Scalar(db, "SELECT group_concat(balance) FROM (SELECT balance FROM "
+                   "accounts ORDER BY account_number);") ==
+        "490000,10,9999768001");
+  CHECK(Scalar(db, "SELECT group_concat(amount) FROM (SELECT amount FROM "
+                   "transactions ORDER BY id);") == "500000,10000,10");
+  CHECK(Scalar(db, "SELECT count(*) FROM accounts WHERE typeof(balance) != "
+                   "'integer';") == "0");
+
+  // Every constraint, the default, the foreign key, the index and the view
+  // survive the rebuild.
+  CHECK(!Exec(db, "INSERT INTO accounts (account_number, pin) VALUES "
+                  "('44444444', '1');"));
+  CHECK(!Exec(db, "INSERT INTO accounts (account_number, holder_name) "
+                  "VALUES ('44444444', 'x');"));
+  CHECK(!Exec(db, "INSERT INTO accounts (account_number, holder_name, pin) "
+                  "VALUES ('11111111', 'x', '1');"));
+  CHECK(!Exec(db, "INSERT INTO transactions (account_number, type) VALUES "
+                  "('11111111', 'DEPOSIT');"));
+  CHECK(Exec(db, "INSERT INTO accounts (account_number, holder_name, pin) "
+                 "VALUES ('55555555', 'New', '1');"));
+  CHECK(Scalar(db, "SELECT balance FROM accounts WHERE account_number = "
+                   "'55555555';") == "0");
+  CHECK(Scalar(db, "SELECT \"table\" || '.' || \"to\" FROM "
+                   "pragma_foreign_key_list('transactions');") ==
+        "accounts.account_number");
+  CHECK(Scalar(db, "SELECT count(*) FROM sqlite_master WHERE name = "
+                   "'idx_tx_type';") == "1");
+  CHECK(Scalar(db, "SELECT count(*) FROM rich;") == "2");
+  CHECK(Scalar(db, "SELECT seq FROM sqlite_sequence;") == seq);
+  CHECK(Scalar(db, "SELECT count(*) FROM sqlite_master WHERE name LIKE "
+                   "'%_paise';") == "0");
+  CHECK(Scalar(db, "PRAGMA foreign_keys;") == (foreignKeys ? "1" : "0"));
+  if (foreignKeys)
+    CHECK(!Exec(db, "INSERT INTO transactions (account_number, type, "
+                    "amount) VALUES ('99999999', 'DEPOSIT', 1);"));
+
+  // Already converted: a second run changes nothing.
+  string before = Scalar(db, "SELECT group_concat(sql) FROM sqlite_master;");
+  CHECK(Core::MigrateMoneyColumns(db));
+  CHECK(Scalar(db, "SELECT group_concat(sql) FROM sqlite_master;") == before);
+  sqlite3_close(db);
+}
+
+// A rebuild that fails, or that would leave a reference dangling, is undone
+// and the table keeps its rupees.
+void TestUndo() {
+  sqlite3 *db;
+  sqlite3_open(":memory:", &db);
+  CHECK(Exec(db, "CREATE TABLE accounts (account_number TEXT PRIMARY KEY, "
+                 "balance REAL CHECK (balance < 1000));"
+                 "INSERT INTO accounts VALUES ('11111111', 20.0);"));
+  CHECK(!Core::MigrateMoneyColumns(db));
+  CHECK(Scalar(db, "SELECT type FROM pragma_table_info('accounts') WHERE "
+                   "name = 'balance';") == "REAL");
+  CHECK(Scalar(db, "SELECT balance FROM accounts;") == "20.0");
+  CHECK(Scalar(db, "SELECT count(*) FROM sqlite_master WHERE name LIKE "
+                   "'%_paise';") == "0");
+
+  // Keyed on the money column itself, the child no longer matches once the
+  // parent is in paise.
+  CHECK(Exec(db, "DROP TABLE accounts;"
+                 "CREATE TABLE accounts (account_number TEXT PRIMARY KEY, "
+                 "balance REAL UNIQUE);"
+                 "CREATE TABLE limits (amount REAL REFERENCES "
+                 "accounts(balance));"
+                 "INSERT INTO accounts VALUES ('11111111', 1.5);"
+                 "INSERT INTO limits VALUES (1.5);"));
+  CHECK(!Core::MigrateMoneyColumns(db));
+  CHECK(Scalar(db, "SELECT balance FROM accounts;") == "1.5");
+  CHECK(Scalar(db, "SELECT count(*) FROM pragma_foreign_key_check;") == "0");
+
+  // Violations that were there before are no reason to refuse.
+  CHECK(Exec(db, "DROP TABLE limits;"
+                 "CREATE TABLE transactions (id INTEGER PRIMARY KEY, "
+                 "account_number TEXT REFERENCES accounts(account_number), "
+                 "amount REAL);"
+                 "INSERT INTO transactions VALUES (1, '00000000', 2.5);"));
+  CHECK(Core::MigrateMoneyColumns(db));
+  CHECK(Scalar(db, "SELECT balance FROM accounts;") == "150");
+  CHECK(Scalar(db, "SELECT amount FROM transactions;") == "250");
+  CHECK(Scalar(db, "SELECT count(*) FROM pragma_foreign_key_check;") == "1");
+  sqlite3_close(db);
+}
+
+} // namespace
+
+int main() {
+  TestBaselineMigration(false);
+  TestBaselineMigration(true);
+  TestUndo();
+  return Test::Failures() != 0;
+}
@@ -0,0 +1,121 @@
+#include "Check.h"
+
+#include "VaultDB.h"
+
+#include <string>
+#include <vector>
+
+using namespace std;
+using Core::Money;
+
+namespace {
+
+Money Rupees(double r) {
+  Money m;
+  Money::FromRupees(r, &m);
+  return m;
+}
+
+Money Balance(Core::VaultDB &vault, const string &num) {
+  Money m;
+  vault.GetBalance(num, &m);
+  return m;
+}
+
+// A buy creates or grows the position in one upsert, folding its price
+// into the average; a sell only goes through while enough shares remain.
+// Every trade leaves one fill, and a refused one leaves nothing at all.
+void TestTrade() {
+  string path = Test::ScratchDb("trade");
+  Test::Cleanup(path);
+  {
+    Core::VaultDB vault;
+    CHECK(vault.Init(path));
+    CHECK(vault.CreateAccount("90000001", "Asha", "1", Rupees(1000)));
+    double avg = 0;
+
+    CHECK(vault.Trade("90000001", "TCS", 3, 100) == 0);
+    CHECK(vault.GetOwnedStocks("90000001", "TCS", &avg) == 3 && avg == 100);
+    CHECK(vault.Trade("90000001", "TCS", 1, 200) == 0);
+    CHECK(vault.GetOwnedStocks("90000001", "TCS", &avg) == 4 && avg == 125);
+    CHECK(vault.Trade("90000001", "TCS", -2, 150) == 0);
+    CHECK(vault.GetOwnedStocks("90000001", "TCS", &avg) == 2 && avg == 125);
+    CHECK(Balance(vault, "90000001") == Rupees(1000 - 300 - 200 + 300));
+
+    vector<Core::Fill> fills = vault.GetFills("90000001");
+    CHECK(fills.size() == 3);
+    CHECK(fills[0].symbol == "TCS" && fills[0].quantity == -2 &&
+          fills[0].price == Rupees(150) && fills[0].amount == Rupees(300));
+    CHECK(fills[2].quantity == 3 && fills[2].amount == Rupees(-300));
+
+    // Too few shares, too little cash, a bad order, no account.
+    CHECK(vault.Trade("90000001", "TCS", -3, 150) == 3);
+    CHECK(vault.Trade("90000001", "INFY", -1, 10) == 3);
+    CHECK(vault.Trade("90000001", "INFY", 9, 100) == 3);
+    CHECK(vault.Trade("90000001", "INFY", 1, 0) == 5);
+    CHECK(vault.Trade("90000001", "INFY", 0, 10) == 5);
+    CHECK(vault.Trade("99999999", "INFY", 1, 10) == 4);
+    CHECK(vault.GetOwnedStocks("90000001", "TCS") == 2);
+    CHECK(vault.GetOwnedStocks("90000001", "INFY") == 0);
+    CHECK(Balance(vault, "90000001") == Rupees(800));
+    CHECK(vault.GetFills("90000001").size() == 3);
+
+    // Selling out leaves no position behind in the portfolio.
+    CHECK(vault.Trade("90000001", "TCS", -2, 100) == 0);
+    vector<Core::Position> held;
+    CHECK(vault.GetPortfolio("90000001", &held) && held.empty());
+
+    Core::LedgerReport r;
+    CHECK(vault.VerifyLedger(0, &r) && r.Ok());
+  }
+  Test::Cleanup(path);
+}
+
+// A basket executes every leg or none. Its sells fund its buys, so it can
+// go through with no cash at all, and legs run in order.
+void TestBasket() {
+  string path = Test::ScratchDb("basket");
+  Test::Cleanup(path);
+  {
+    Core::VaultDB vault;
+    CHECK(vault.Init(path));
+    CHECK(vault.CreateAccount("90000002", "Ravi", "2", Money()));
+    CHECK(vault.UpdateStocks("90000002", "TCS", 2, 100));
+
+    // The last leg fails, so neither earlier one may stick.
+    CHECK(vault.ExecuteBasket("90000002", {{"TCS", -2, 100},
+                                           {"INFY", 1, 150},
+                                           {"WIPRO", -1, 10}}) == 3);
+    // Sells fund the buys only up to what they raise.
+    CHECK(vault.ExecuteBasket("90000002",
+                              {{"TCS", -2, 100}, {"INFY", 2, 150}}) == 3);
+    CHECK(vault.ExecuteBasket("90000002", {}) == 5);
+    CHECK(vault.ExecuteBasket("90000002", {{"INFY", 1, -1}}) == 5);
+    CHECK(vault.GetOwnedStocks("90000002", "TCS") == 2);
+    CHECK(vault.GetOwnedStocks("90000002", "INFY") == 0);
+    CHECK(Balance(vault, "90000002") == Money());
+    CHECK(vault.GetFills("90000002").empty());
+
+    CHECK(vault.ExecuteBasket("90000002", {{"TCS", -2, 100},
+                                           {"INFY", 1, 150},
+                                           {"INFY", -1, 160}}) == 0);
+    CHECK(vault.GetOwnedStocks("90000002", "TCS") == 0);
+    CHECK(vault.GetOwnedStocks("90000002", "INFY") == 0);
+    CHECK(Balance(vault, "90000002") == Rupees(210));
+    vector<Core::Fill> fills = vault.GetFills("90000002");
+    CHECK(fills.size() == 3 && fills[0].quantity == -1 &&
+          fills[0].price == Rupees(160) && fills[2].symbol == "TCS");
+
+    Core::LedgerReport r;
+    CHECK(vault.VerifyLedger(0, &r) && r.Ok());
+  }
+  Test::Cleanup(path);
+}
+
+} // namespace
+
+int main() {
+  TestTrade();
+  TestBasket();
+  return Test::Failures() != 0;
+}
@@ -0,0 +1,151 @@
+#include "Check.h"
+
+#include "VaultDB.h"
+
+#include <sqlite3.h>
+#include <string>
+#include <vector>
+
+using namespace std;
+using Core::Money;
+
+namespace {
+
+Money Rupees(double r) {
+  Money m;
+  Money::FromRupees(r, &m);
+  return m;
+}
+
+Money Balance(Core::VaultDB &vault, const string &num) {
+  Money m;
+  vault.GetBalance(num, &m);
+  return m;
+}
+
+Core::TransferRequest Request(const string &from, const string &to,
+                              double rupees) {
+  Core::TransferRequest r;
+  r.from = from;
+  r.to = to;
+  r.amount = Rupees(rupees);
+  return r;
+}
+
+int64_t Version(sqlite3 *db, const string &num) {
+  sqlite3_stmt *s;
+  sqlite3_prepare_v2(db, "SELECT version FROM accounts WHERE acc_num = ?;",
+                     -1, &s, 0);
+  sqlite3_bind_text(s, 1, num.c_str(), -1, SQLITE_TRANSIENT);
+  int64_t v = sqlite3_step(s) == SQLITE_ROW ? sqlite3_column_int64(s, 0) : -1;
+  sqlite3_finalize(s);
+  return v;
+}
+
+void Open(Core::VaultDB &vault, const string &path) {
+  CHECK(vault.Init(path));
+  CHECK(vault.CreateAccount("60000001", "Asha", "1", Rupees(100)));
+  CHECK(vault.CreateAccount("60000002", "Ravi", "2", Money()));
+  CHECK(vault.CreateAccount("60000003", "Meera", "3", Rupees(10)));
+}
+
+// Each request sees the balances the ones before it left, so a transfer
+// can spend money credited earlier in the batch, and the results are the
+// ones Transfer gives the same requests one at a time.
+void TestInOrder() {
+  vector<Core::TransferRequest> batch = {
+      Request("60000001", "60000002", 60), // 0
+      Request("60000002", "60000003", 50), // 0: funded by the first
+      Request("60000001", "60000003", 50), // 3: 40 left
+      Request("60000003", "60000003", 1),  // 2
+      Request("60000001", "69999999", 1),  // 4
+      Request("60000001", "60000002", 0),  // 5
+      Request("60000002", "60000001", 10), // 0
+  };
+  string batchPath = Test::ScratchDb("batch");
+  string onePath = Test::ScratchDb("batch_single");
+  Test::Cleanup(batchPath);
+  Test::Cleanup(onePath);
+  {
+    Core::VaultDB batched, single;
+    Open(batched, batchPath);
+    Open(single, onePath);
+    vector<int> results;
+    CHECK(batched.TransferBatch(batch, &results));
+    CHECK(results == vector<int>({0, 0, 3, 2, 4, 5, 0}));
+    vector<int> expected;
+    for (const auto &r : batch)
+      expected.push_back(single.Transfer(r.from, r.to, r.amount));
+    CHECK(results == expected);
+
+    for (const char *num : {"60000001", "60000002", "60000003"})
+      CHECK(Balance(batched, num) == Balance(single, num));
+    CHECK(Balance(batched, "60000001") == Rupees(50));
+    CHECK(Balance(batched, "60000002") == Money());
+    CHECK(Balance(batched, "60000003") == Rupees(60));
+
+    Core::LedgerReport r;
+    CHECK(batched.VerifyLedger(0, &r) && r.Ok());
+
+    CHECK(batched.TransferBatch({}, &results) && results.empty());
+  }
+  Test::Cleanup(batchPath);
+  Test::Cleanup(onePath);
+}
+
+// However many requests touch an account, its row is written once, with
+// the net of them; every applied request still gets its ledger entry.
+void TestNetting() {
+  string path = Test::ScratchDb("batch_net");
+  Test::Cleanup(path);
+  {
+    Core::VaultDB vault;
+    Open(vault, path);
+    vector<Core::TransferRequest> batch;
+    for (int i = 0; i < 20; i++) {
+      batch.push_back(Request("60000001", "60000002", 2));
+      batch.push_back(Request("60000002", "60000001", 1));
+    }
+    // Nets to nothing for the third account.
+    batch.push_back(Request("60000001", "60000003", 20));
+    batch.push_back(Request("60000003", "60000001", 20));
+
+    sqlite3 *db;
+    sqlite3_open(path.c_str(), &db);
+    int64_t before[3], entries;
+    const char *nums[3] = {"60000001", "60000002", "60000003"};
+    for (int i = 0; i < 3; i++)
+      before[i] = Version(db, nums[i]);
+    sqlite3_stmt *s;
+    sqlite3_prepare_v2(db, "SELECT count(*) FROM ledger_entries;", -1, &s, 0);
+    sqlite3_step(s);
+    entries = sqlite3_column_int64(s, 0);
+    sqlite3_reset(s);
+
+    vector<int> results;
+    CHECK(vault.TransferBatch(batch, &results));
+    CHECK(results == vector<int>(batch.size(), 0));
+    CHECK(Version(db, nums[0]) == before[0] + 1);
+    CHECK(Version(db, nums[1]) == before[1] + 1);
+    CHECK(Version(db, nums[2]) == before[2]);
+    sqlite3_step(s);
+    CHECK(sqlite3_column_int64(s, 0) == entries + (int64_t)batch.size());
+    sqlite3_finalize(s);
+    sqlite3_close(db);
+
+    CHECK(Balance(vault, "60000001") == Rupees(80));
+    CHECK(Balance(vault, "60000002") == Rupees(20));
+    CHECK(Balance(vault, "60000003") == Rupees(10));
+    Core::LedgerReport r;
+    CHECK(vault.VerifyLedger(0, &r) && r.Ok());
+  }
+  Test::Cleanup(path);
+}
+
+} // namespace
+
+int main() {
+  TestInOrder();
+  TestNetting();
+  return Test::Failures() != 0;
+}
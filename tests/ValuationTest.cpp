@@ -0,0 +1,106 @@
+#include "Check.h"
+
+#include "Valuation.h"
+
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+bool Near(double a, double b) {
+  return fabs(a - b) <= 1e-9 * max(1.0, fabs(b));
+}
+
+// Two accounts by hand: market value, equity and P&L from their
+// definitions. In a book this small any move is over a fifth of the
+// positions, so Update falls back to the full pass.
+void TestSmallBook() {
+  Core::ValuationEngine book;
+  book.Reset({"TCS", "INFY", "WIPRO"});
+  size_t a = book.AddAccount("10000001", 1000);
+  size_t b = book.AddAccount("10000002", 50);
+  // Added out of account order on purpose.
+  book.AddPosition(b, 1, 4, 20);
+  book.AddPosition(a, 0, 2, 100);
+  book.AddPosition(a, 1, -1, 30);
+  book.Finish();
+  CHECK(book.Accounts() == 2 && book.Positions() == 3);
+
+  double prices[3] = {110, 25, 7};
+  book.Value(prices);
+  CHECK(book.MarketValue()[a] == 2 * 110 - 25);
+  CHECK(book.Equity()[a] == 1000 + 2 * 110 - 25);
+  CHECK(book.Pnl()[a] == (2 * 110 - 25) - (2 * 100 - 30));
+  CHECK(book.MarketValue()[b] == 100 && book.Pnl()[b] == 20);
+  CHECK(book.TotalEquity() == 1195 + 150);
+
+  // A price nobody holds moves nothing; one held by both accounts does.
+  prices[2] = 8;
+  CHECK(book.Update(prices) == 0);
+  prices[1] = 26;
+  CHECK(book.Update(prices) == book.Positions());
+  CHECK(book.MarketValue()[a] == 2 * 110 - 26);
+  CHECK(book.MarketValue()[b] == 104 && book.Pnl()[b] == 24);
+}
+
+// A larger random book driven by ticks that move a few symbols each:
+// Update, whether incremental or falling back to the full pass, stays
+// within rounding of Value on a fresh book.
+void TestUpdateMatchesValue() {
+  const size_t kSymbols = 50, kAccounts = 400;
+  vector<string> symbols;
+  for (size_t s = 0; s < kSymbols; s++)
+    symbols.push_back("S" + to_string(s));
+  mt19937 rng(7);
+  Core::ValuationEngine live, fresh;
+  for (Core::ValuationEngine *book : {&live, &fresh})
+    book->Reset(symbols);
+  for (size_t i = 0; i < kAccounts; i++) {
+    string num = to_string(20000000 + i);
+    double cash = rng() % 100000;
+    size_t a = live.AddAccount(num, cash);
+    fresh.AddAccount(num, cash);
+    for (int k = 0; k < 5; k++) {
+      size_t s = rng() % kSymbols;
+      int q = (int)(rng() % 200) - 50;
+      double avg = 10 + rng() % 500;
+      live.AddPosition(a, s, q, avg);
+      fresh.AddPosition(a, s, q, avg);
+    }
+  }
+  live.Finish();
+  fresh.Finish();
+
+  vector<double> prices(kSymbols);
+  for (auto &p : prices)
+    p = 10 + rng() % 500;
+  CHECK(live.Update(prices.data()) == live.Positions()); // first: Value
+  bool same = true, incremental = false;
+  for (int tick = 0; tick < 200; tick++) {
+    // Usually a few symbols, now and then most of them.
+    size_t moves = tick % 25 == 0 ? kSymbols : 1 + rng() % 3;
+    for (size_t m = 0; m < moves; m++)
+      prices[rng() % kSymbols] *= 1 + ((int)(rng() % 21) - 10) / 1000.0;
+    size_t touched = live.Update(prices.data());
+    incremental = incremental || touched < live.Positions();
+    fresh.Value(prices.data());
+    for (size_t a = 0; a < kAccounts; a++)
+      same = same && Near(live.MarketValue()[a], fresh.MarketValue()[a]) &&
+             Near(live.Equity()[a], fresh.Equity()[a]) &&
+             Near(live.Pnl()[a], fresh.Pnl()[a]);
+  }
+  CHECK(same && incremental);
+  CHECK(Near(live.TotalPnl(), fresh.TotalPnl()));
+}
+
+} // namespace
+
+int main() {
+  TestSmallBook();
+  TestUpdateMatchesValue();
+  return Test::Failures() != 0;
+}